@@ -8,8 +8,10 @@
 #pragma once
 #include <new>
 #include "../DKInclude.h"
+#include "DKMemory.h"
 #include "DKTypeTraits.h"
 #include "DKFunction.h"
+#include "DKStaticArray.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // DKAVLTree
@@ -27,9 +29,15 @@
 // COPY: copy value function or function object.
 //   (used when Update() called, You can ignore this type if you don't call Update)
 //
+// Insert, Update with multiple values and Union are performed by merging
+// sorted values into tree and rebuilding balanced tree directly, O(n+m).
+// (instead of n times of insertion and balancing)
+//
 // Note:
 //  value's pointer will not be changed after balancing process.
-//  You can save pointer if you wish.
+//  You can save pointer if you wish. (rebuilding does not move values)
+//  nodes are allocated by ALLOC one by one. use DKMemoryPMAllocator
+//  (see DKMemoryPool.h) to allocate nodes from per-thread pool.
 ////////////////////////////////////////////////////////////////////////////////
 
 
@@ -117,6 +125,32 @@ namespace DKFoundation
 				return &node->value;
 			return NULL;
 		}
+		// Insert multiple values, returns number of inserted values.
+		// if there are duplicated values, first one is inserted.
+		size_t Insert(const Value* v, size_t n)
+		{
+			return SetValues(v, n, false);
+		}
+		// Update multiple values, returns number of inserted values.
+		// if there are duplicated values, last one is used.
+		size_t Update(const Value* v, size_t n)
+		{
+			return SetValues(v, n, true);
+		}
+		// Union: insert all values of tree (values of this tree are not changed
+		// if overwrite is false), returns number of inserted values.
+		size_t Union(const DKAVLTree& tree, bool overwrite = false)
+		{
+			if (this == &tree || tree.count == 0)
+				return 0;
+
+			const Value** values = static_cast<const Value**>(DKMemoryHeapAlloc(sizeof(Value*) * tree.count));
+			const Value** p = values;
+			tree.rootNode->EnumerateForward([&p](const Value& v) -> bool {*(p++) = &v; return false;});
+			size_t inserted = MergeSorted(values, tree.count, overwrite);
+			DKMemoryHeapFree(values);
+			return inserted;
+		}
 		void Remove(const Key& k)
 		{
 			Node* node = GetNode(k);
@@ -363,6 +397,14 @@ namespace DKFoundation
 				node->nodeHeight = nodeHeight;
 				return node;
 			}
+			void EnumerateNodes(Node**& p)
+			{
+				if (left)
+					left->EnumerateNodes(p);
+				*(p++) = this;
+				if (right)
+					right->EnumerateNodes(p);
+			}
 			template <typename R> bool EnumerateForward(R&& enumerator)
 			{
 				if (left && left->EnumerateForward(std::forward<R>(enumerator)))	return true;
@@ -533,6 +575,111 @@ namespace DKFoundation
 			}
 			return NULL;
 		}
+		size_t SetValues(const Value* v, size_t n, bool overwrite)
+		{
+			if (n == 0)
+				return 0;
+
+			size_t inserted = 0;
+			if (n * 16 < count)	// few values, insert one by one.
+			{
+				for (size_t i = 0; i < n; ++i)
+				{
+					bool created = false;
+					Node* node = SetNode(v[i], &created);
+					if (created)
+						inserted++;
+					else if (overwrite)
+						valueCopyFunc(node->value, v[i]);
+				}
+				return inserted;
+			}
+
+			// sort by value, same values are ordered by position.
+			const Value** values = static_cast<const Value**>(DKMemoryHeapAlloc(sizeof(Value*) * n));
+			for (size_t i = 0; i < n; ++i)
+				values[i] = &v[i];
+			const ValueCompare& cmp = valueCompareFunc;
+			DKStaticArray<const Value*>(values, n).Sort([&cmp](const Value* lhs, const Value* rhs) -> bool
+			{
+				int c = cmp(*lhs, *rhs);
+				return c < 0 || (c == 0 && lhs < rhs);
+			});
+			// remove duplicated values.
+			size_t unique = 1;
+			for (size_t i = 1; i < n; ++i)
+			{
+				if (valueCompareFunc(*values[unique-1], *values[i]) == 0)
+				{
+					if (overwrite)
+						values[unique-1] = values[i];
+				}
+				else
+					values[unique++] = values[i];
+			}
+			inserted = MergeSorted(values, unique, overwrite);
+			DKMemoryHeapFree(values);
+			return inserted;
+		}
+		// merge sorted, unique values with nodes, and rebuild tree.
+		// existing nodes are linked again, not reallocated.
+		size_t MergeSorted(const Value** values, size_t n, bool overwrite)
+		{
+			size_t numNodes = count;
+			size_t length = numNodes + n;
+			Node** nodes = static_cast<Node**>(DKMemoryHeapAlloc(sizeof(Node*) * length));
+			if (rootNode)
+			{
+				Node** p = nodes;
+				rootNode->EnumerateNodes(p);
+			}
+			// merge from back, merged nodes never overwrite unread nodes.
+			size_t inserted = 0;
+			size_t i = numNodes, k = n, m = length;
+			while (i > 0 || k > 0)
+			{
+				int cmp = 0;
+				if (i == 0)
+					cmp = -1;
+				else if (k == 0)
+					cmp = 1;
+				else
+					cmp = valueCompareFunc(nodes[i-1]->value, *values[k-1]);
+
+				if (cmp > 0)
+					nodes[--m] = nodes[--i];
+				else if (cmp < 0)
+				{
+					nodes[--m] = new(Allocator::Alloc(sizeof(Node))) Node(*values[--k], NULL);
+					inserted++;
+				}
+				else
+				{
+					--i;
+					--k;
+					if (overwrite)
+						valueCopyFunc(nodes[i]->value, *values[k]);
+					nodes[--m] = nodes[i];
+				}
+			}
+			rootNode = BuildTree(&nodes[m], length - m, NULL);
+			count = length - m;
+			DKMemoryHeapFree(nodes);
+			return inserted;
+		}
+		// build balanced tree with sorted nodes.
+		Node* BuildTree(Node** nodes, size_t n, Node* parent)
+		{
+			if (n == 0)
+				return NULL;
+			size_t mid = n / 2;
+			Node* node = nodes[mid];
+			node->parent = parent;
+			node->left = BuildTree(nodes, mid, node);
+			node->right = BuildTree(nodes + mid + 1, n - mid - 1, node);
+			UpdateHeight(node);
+			return node;
+		}
 		// find node 'k' and return. (return NULL if not exists)
 		Node* GetNode(const Key& k)
 		{
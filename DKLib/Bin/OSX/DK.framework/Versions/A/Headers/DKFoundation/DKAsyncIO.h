@@ -0,0 +1,692 @@
+//
+//  File: DKAsyncIO.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include <cerrno>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKStringU8.h"
+#include "DKFile.h"
+#include "DKMutex.h"
+#include "DKCondition.h"
+#include "DKCriticalSection.h"
+#include "DKThread.h"
+#include "DKFunction.h"
+#include "DKOperationQueue.h"
+#include "DKQueue.h"
+#include "DKArray.h"
+#include "DKFuture.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/file.h>
+#endif
+#if defined(DKLIB_LINUX) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define DKLIB_IO_URING_ENABLED
+#endif
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// DKAsyncIO, DKAsyncFile
+// asynchronous positional file I/O with batched submission.
+//
+// DKAsyncFile is file handle for asynchronous I/O, opened with path or
+// existing DKFile. (opens another handle with same path)
+// share mode is applied with advisory lock (flock) on POSIX, it excludes
+// only other handles which use flock also. (ModeShareRead: shared lock,
+// ModeShareExclusive: exclusive lock)
+// ReadAsync, WriteAsync read or write caller-provided buffer at offset, and
+// returns future of bytes transferred. ((size_t)-1 on error)
+// buffer must be valid until future is completed, cancelling future does not
+// abort I/O in progress.
+//
+// DKAsyncIO submits requests to kernel with io_uring (Linux), requests of
+// one Batch are submitted with one system call. if io_uring is not available,
+// requests are processed by thread pool. (DKOperationQueue)
+// requests exceeding queue depth are kept pending, submitted when previous
+// requests are completed. submission never blocks.
+//
+// future is completed on completion thread (io_uring) or worker thread,
+// use DKFuture::Then(runLoop, func) to receive result on DKRunLoop.
+//
+// Example:
+//  DKAsyncIO::Batch batch;
+//  for (Texture& t : textures)
+//      t.loaded = batch.Read(t.file, 0, t.data, t.length);
+//  batch.Submit();
+//  ...
+//  DKObject<DKAsyncFile> file = DKAsyncFile::Open(path, DKFile::ModeOpenReadOnly);
+//  file->ReadAsync(0, buffer, length).Then(runLoop, [](size_t n) {...});
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKAsyncIO;
+	class DKAsyncFile
+	{
+	public:
+		typedef DKFile::Position Position;
+
+		~DKAsyncFile(void)
+		{
+#ifndef _WIN32
+			if (fd >= 0)
+				::close(fd);
+#endif
+		}
+		static DKObject<DKAsyncFile> Open(const DKString& path, DKFile::ModeOpen mode, DKFile::ModeShare share = DKFile::ModeShareAll)
+		{
+#ifdef _WIN32
+			DKObject<DKFile> file = DKFile::Create(path, mode, share);
+			if (file)
+			{
+				DKObject<DKAsyncFile> af = DKOBJECT_NEW DKAsyncFile(path, mode != DKFile::ModeOpenReadOnly);
+				af->file = file;
+				return af;
+			}
+#else
+			int flags = O_RDWR;
+			switch (mode)
+			{
+			case DKFile::ModeOpenNew:		flags = O_RDWR | O_CREAT | O_TRUNC;	break;
+			case DKFile::ModeOpenCreate:	flags = O_RDWR | O_CREAT | O_EXCL;	break;
+			case DKFile::ModeOpenExisting:	flags = O_RDWR;						break;
+			case DKFile::ModeOpenReadOnly:	flags = O_RDONLY;					break;
+			case DKFile::ModeOpenAlways:	flags = O_RDWR | O_CREAT;			break;
+			}
+#ifdef O_CLOEXEC
+			flags |= O_CLOEXEC;
+#endif
+			DKStringU8 filename(path);
+			int fd = ::open((const char*)filename, flags, 0666);
+			if (fd >= 0)
+			{
+				int lockOp = 0;
+				if (share == DKFile::ModeShareRead)
+					lockOp = LOCK_SH;
+				else if (share == DKFile::ModeShareExclusive)
+					lockOp = LOCK_EX;
+				if (lockOp == 0 || ::flock(fd, lockOp | LOCK_NB) == 0)
+				{
+					DKObject<DKAsyncFile> af = DKOBJECT_NEW DKAsyncFile(path, mode != DKFile::ModeOpenReadOnly);
+					af->fd = fd;
+					return af;
+				}
+				::close(fd);
+			}
+#endif
+			return NULL;
+		}
+		// open another handle of file, writable if file is writable.
+		static DKObject<DKAsyncFile> Open(const DKFile* file)
+		{
+			if (file)
+				return Open(file->Path(), file->IsWritable() ? DKFile::ModeOpenExisting : DKFile::ModeOpenReadOnly);
+			return NULL;
+		}
+
+		DKFuture<size_t> ReadAsync(Position offset, void* buffer, size_t size);
+		DKFuture<size_t> ReadAsync(Position offset, void* buffer, size_t size, DKAsyncIO& io);
+		DKFuture<size_t> WriteAsync(Position offset, const void* buffer, size_t size);
+		DKFuture<size_t> WriteAsync(Position offset, const void* buffer, size_t size, DKAsyncIO& io);
+
+		// synchronous positional I/O, returns (size_t)-1 on error.
+		size_t Read(Position offset, void* buffer, size_t size)
+		{
+#ifdef _WIN32
+			DKCriticalSection<DKMutex> guard(lock);
+			if (file->SetPos(offset) != offset)
+				return (size_t)-1;
+			return file->Read(buffer, size);
+#else
+			size_t total = 0;
+			while (total < size)
+			{
+				ssize_t r = ::pread(fd, reinterpret_cast<char*>(buffer) + total, size - total, (off_t)(offset + total));
+				if (r < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return (size_t)-1;
+				}
+				if (r == 0)		// end of file
+					break;
+				total += (size_t)r;
+			}
+			return total;
+#endif
+		}
+		size_t Write(Position offset, const void* buffer, size_t size)
+		{
+#ifdef _WIN32
+			DKCriticalSection<DKMutex> guard(lock);
+			if (file->SetPos(offset) != offset)
+				return (size_t)-1;
+			return file->Write(buffer, size);
+#else
+			size_t total = 0;
+			while (total < size)
+			{
+				ssize_t r = ::pwrite(fd, reinterpret_cast<const char*>(buffer) + total, size - total, (off_t)(offset + total));
+				if (r < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return (size_t)-1;
+				}
+				if (r == 0)		// no progress, cannot write anymore.
+					return (size_t)-1;
+				total += (size_t)r;
+			}
+			return total;
+#endif
+		}
+		Position Length(void) const
+		{
+#ifdef _WIN32
+			DKCriticalSection<DKMutex> guard(lock);
+			return file->TotalLength();
+#else
+			struct stat st;
+			if (::fstat(fd, &st) == 0)
+				return (Position)st.st_size;
+			return -1;
+#endif
+		}
+		const DKString& Path(void) const	{return path;}
+		bool IsWritable(void) const			{return writable;}
+
+	private:
+		DKAsyncFile(const DKString& p, bool w) : path(p), writable(w)
+		{
+#ifndef _WIN32
+			fd = -1;
+#endif
+		}
+
+		DKString path;
+		bool writable;
+#ifdef _WIN32
+		DKObject<DKFile> file;
+		DKMutex lock;
+#else
+		int fd;
+#endif
+		friend class DKAsyncIO;
+
+		DKAsyncFile(const DKAsyncFile&);
+		DKAsyncFile& operator = (const DKAsyncFile&);
+	};
+
+	class DKAsyncIO
+	{
+		struct Request;
+	public:
+		typedef DKFile::Position Position;
+		enum
+		{
+			DefaultQueueDepth = 256,
+			DefaultThreads = 4,		// thread pool (if io_uring not available)
+		};
+
+		DKAsyncIO(size_t queueDepth = DefaultQueueDepth, size_t maxThreads = DefaultThreads)
+			: inflight(0)
+		{
+#ifdef DKLIB_IO_URING_ENABLED
+			// ReleaseRing() unmaps non-null members only.
+			memset(&ring, 0, sizeof(ring));
+			ring.fd = -1;
+			if (SetupRing(queueDepth))
+				completionThread = DKThread::Create(DKFunction(this, &DKAsyncIO::CompletionThreadProc)->Invocation());
+			if (completionThread == NULL)
+				ReleaseRing();
+#endif
+			workQueue.SetMaxConcurrentOperations(maxThreads > 0 ? maxThreads : 1);
+		}
+		// wait for completion of all requests.
+		~DKAsyncIO(void)
+		{
+#ifdef DKLIB_IO_URING_ENABLED
+			if (completionThread)
+			{
+				ringCond.Lock();
+				while (inflight > 0 || !pending.IsEmpty())
+					ringCond.Wait();
+				// wake completion thread to terminate.
+				struct io_uring_sqe* sqe = NextSQE();
+				sqe->opcode = IORING_OP_NOP;
+				sqe->user_data = 0;
+				Enter(1, 0, 0);
+				ringCond.Unlock();
+				completionThread->WaitTerminate();
+			}
+			ReleaseRing();
+#endif
+			workQueue.WaitForCompletion();
+		}
+
+		// shared instance, never destroyed.
+		static DKAsyncIO& Default(void)
+		{
+			DKAsyncIO* io = DefaultHolder<0>::instance.load(std::memory_order_acquire);
+			if (io == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(DKAsyncIO));
+				if (mem == NULL)
+					DKERROR_THROW("Out of memory");
+				DKAsyncIO* newIO = new(mem) DKAsyncIO();
+				if (DefaultHolder<0>::instance.compare_exchange_strong(io, newIO, std::memory_order_acq_rel))
+					io = newIO;
+				else
+				{
+					newIO->~DKAsyncIO();
+					DKMemoryHeapFree(newIO);
+				}
+			}
+			return *io;
+		}
+
+		// true if requests are submitted with io_uring.
+		bool IsKernelQueueEnabled(void) const
+		{
+#ifdef DKLIB_IO_URING_ENABLED
+			return completionThread != NULL;
+#else
+			return false;
+#endif
+		}
+
+		// collects requests, submits all together.
+		// requests not submitted are submitted when batch destroyed.
+		class Batch
+		{
+		public:
+			Batch(DKAsyncIO& io = DKAsyncIO::Default()) : engine(io) {}
+			~Batch(void)
+			{
+				Submit();
+			}
+			DKFuture<size_t> Read(DKAsyncFile* file, Position offset, void* buffer, size_t size)
+			{
+				return Add(file, offset, buffer, size, false);
+			}
+			DKFuture<size_t> Write(DKAsyncFile* file, Position offset, const void* buffer, size_t size)
+			{
+				return Add(file, offset, const_cast<void*>(buffer), size, true);
+			}
+			void Submit(void)
+			{
+				if (requests.Count() > 0)
+				{
+					engine.Submit(requests, requests.Count());
+					requests.Clear();
+				}
+			}
+			size_t Count(void) const	{return requests.Count();}
+
+		private:
+			DKFuture<size_t> Add(DKAsyncFile* file, Position offset, void* buffer, size_t size, bool write)
+			{
+				DKASSERT_DEBUG(file != NULL);
+				void* mem = DKMemoryHeapAlloc(sizeof(Request));
+				if (mem == NULL)
+					DKERROR_THROW("Out of memory");
+				Request* req = new(mem) Request();
+				req->file = file;
+				req->offset = offset;
+				req->buffer = buffer;
+				req->length = size;
+				req->write = write;
+				requests.Add(req);
+				return req->promise.Future();
+			}
+			DKAsyncIO& engine;
+			DKArray<Request*> requests;
+
+			Batch(const Batch&);
+			Batch& operator = (const Batch&);
+		};
+
+		DKFuture<size_t> Read(DKAsyncFile* file, Position offset, void* buffer, size_t size)
+		{
+			Batch batch(*this);
+			return batch.Read(file, offset, buffer, size);
+		}
+		DKFuture<size_t> Write(DKAsyncFile* file, Position offset, const void* buffer, size_t size)
+		{
+			Batch batch(*this);
+			return batch.Write(file, offset, buffer, size);
+		}
+
+	private:
+		struct Request
+		{
+			DKObject<DKAsyncFile> file;
+			Position offset;
+			void* buffer;
+			size_t length;
+			bool write;
+			DKPromise<size_t> promise;
+#ifdef DKLIB_IO_URING_ENABLED
+			struct iovec iov;
+#endif
+		};
+		template <int N> struct DefaultHolder
+		{
+			static std::atomic<DKAsyncIO*> instance;
+		};
+
+		static void Complete(Request* req, size_t result)
+		{
+			req->promise.SetValue(result);
+			req->~Request();
+			DKMemoryHeapFree(req);
+		}
+
+		void Submit(Request* const* reqs, size_t n)
+		{
+#ifdef DKLIB_IO_URING_ENABLED
+			if (completionThread)
+			{
+				DKArray<Request*> failed;
+				ringCond.Lock();
+				pending.PushBack(reqs, n);
+				FlushPendingNL(failed);
+				ringCond.Unlock();
+				for (Request* req : failed)
+					Complete(req, (size_t)-1);
+				return;
+			}
+#endif
+			for (size_t i = 0; i < n; ++i)
+				workQueue.Post(DKFunction(&DKAsyncIO::PerformRequest)->Invocation(reqs[i]));
+		}
+		// thread pool
+		static void PerformRequest(Request* req)
+		{
+			size_t result = (size_t)-1;
+			if (!req->promise.IsCancelled())
+			{
+				if (req->write)
+					result = req->file->Write(req->offset, req->buffer, req->length);
+				else
+					result = req->file->Read(req->offset, req->buffer, req->length);
+			}
+			Complete(req, result);
+		}
+
+		DKOperationQueue workQueue;
+		DKCondition ringCond;
+		DKQueue<Request*> pending;	// waiting for ring space
+		size_t inflight;
+
+#ifdef DKLIB_IO_URING_ENABLED
+		struct Ring
+		{
+			int fd;
+			unsigned int sqEntries;
+			unsigned int cqEntries;
+			void* sqMap;
+			size_t sqMapLength;
+			void* cqMap;
+			size_t cqMapLength;
+			struct io_uring_sqe* sqes;
+			size_t sqesLength;
+			unsigned int* sqHead;
+			unsigned int* sqTail;
+			unsigned int* sqMask;
+			unsigned int* sqArray;
+			unsigned int* cqHead;
+			unsigned int* cqTail;
+			unsigned int* cqMask;
+			struct io_uring_cqe* cqes;
+		};
+		Ring ring;
+		DKObject<DKThread> completionThread;
+
+		static unsigned int LoadAcquire(const unsigned int* p)
+		{
+			return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+		}
+		static void StoreRelease(unsigned int* p, unsigned int v)
+		{
+			__atomic_store_n(p, v, __ATOMIC_RELEASE);
+		}
+
+		bool SetupRing(size_t entries)
+		{
+			struct io_uring_params params;
+			memset(&params, 0, sizeof(params));
+			ring.fd = (int)syscall(__NR_io_uring_setup, (unsigned int)Max<size_t>(entries, 1), &params);
+			if (ring.fd < 0)
+				return false;
+
+			ring.sqEntries = params.sq_entries;
+			ring.cqEntries = params.cq_entries;
+			ring.sqMapLength = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+			ring.cqMapLength = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+			ring.sqesLength = params.sq_entries * sizeof(struct io_uring_sqe);
+			bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (singleMap)
+				ring.sqMapLength = ring.cqMapLength = Max(ring.sqMapLength, ring.cqMapLength);
+
+			ring.sqMap = ::mmap(NULL, ring.sqMapLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+			if (ring.sqMap == MAP_FAILED)
+			{
+				ring.sqMap = ring.cqMap = NULL;
+				return false;
+			}
+			if (singleMap)
+				ring.cqMap = ring.sqMap;
+			else
+			{
+				ring.cqMap = ::mmap(NULL, ring.cqMapLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+				if (ring.cqMap == MAP_FAILED)
+				{
+					ring.cqMap = NULL;
+					return false;
+				}
+			}
+			void* sqes = ::mmap(NULL, ring.sqesLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+			if (sqes == MAP_FAILED)
+				return false;
+			ring.sqes = reinterpret_cast<struct io_uring_sqe*>(sqes);
+
+			char* sq = reinterpret_cast<char*>(ring.sqMap);
+			char* cq = reinterpret_cast<char*>(ring.cqMap);
+			ring.sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+			ring.sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+			ring.sqMask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+			ring.sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+			ring.cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+			ring.cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+			ring.cqMask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+			ring.cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+			return true;
+		}
+		void ReleaseRing(void)
+		{
+			if (ring.fd >= 0)
+			{
+				if (ring.sqes)
+					::munmap(ring.sqes, ring.sqesLength);
+				if (ring.cqMap && ring.cqMap != ring.sqMap)
+					::munmap(ring.cqMap, ring.cqMapLength);
+				if (ring.sqMap)
+					::munmap(ring.sqMap, ring.sqMapLength);
+				::close(ring.fd);
+			}
+			memset(&ring, 0, sizeof(ring));
+			ring.fd = -1;
+		}
+		// next submission entry, ringCond should be locked.
+		struct io_uring_sqe* NextSQE(void)
+		{
+			unsigned int tail = *ring.sqTail;
+			unsigned int index = tail & *ring.sqMask;
+			struct io_uring_sqe* sqe = &ring.sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			ring.sqArray[index] = index;
+			StoreRelease(ring.sqTail, tail + 1);
+			return sqe;
+		}
+		int Enter(unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+		{
+			for (;;)
+			{
+				int r = (int)syscall(__NR_io_uring_enter, ring.fd, toSubmit, minComplete, flags, NULL, 0);
+				if (r >= 0 || (errno != EINTR && errno != EAGAIN && errno != EBUSY))
+					return r;
+				if (errno != EINTR)
+					DKThread::Yield();
+			}
+		}
+		// submit pending requests as many as ring can hold.
+		// requests could not be submitted are moved to 'failed', they should
+		// be completed after ringCond unlocked. ringCond should be locked.
+		void FlushPendingNL(DKArray<Request*>& failed)
+		{
+			unsigned int count = 0;
+			Request* req;
+			while (inflight < ring.cqEntries && count < ring.sqEntries && pending.PopFront(req))
+			{
+				struct io_uring_sqe* sqe = NextSQE();
+				req->iov.iov_base = req->buffer;
+				req->iov.iov_len = req->length;
+				sqe->opcode = req->write ? IORING_OP_WRITEV : IORING_OP_READV;
+				sqe->fd = req->file->fd;
+				sqe->off = (unsigned long long)req->offset;
+				sqe->addr = (unsigned long long)(uintptr_t)&req->iov;
+				sqe->len = 1;
+				sqe->user_data = (unsigned long long)(uintptr_t)req;
+				inflight++;
+				count++;
+			}
+			unsigned int submitted = 0;
+			while (submitted < count)
+			{
+				int r = Enter(count - submitted, 0, 0);
+				if (r <= 0)
+					break;
+				submitted += (unsigned int)r;
+			}
+			if (submitted < count)
+			{
+				// kernel did not consume last entries, remove them from ring.
+				// (entries are consumed only by Enter with toSubmit)
+				unsigned int tail = *ring.sqTail;
+				for (unsigned int i = submitted; i < count; ++i)
+				{
+					--tail;
+					const struct io_uring_sqe* sqe = &ring.sqes[ring.sqArray[tail & *ring.sqMask]];
+					failed.Add(reinterpret_cast<Request*>((uintptr_t)sqe->user_data));
+				}
+				StoreRelease(ring.sqTail, tail);
+				inflight -= count - submitted;
+				// nothing in flight, no completion will submit remaining.
+				if (inflight == 0)
+				{
+					while (pending.PopFront(req))
+						failed.Add(req);
+					ringCond.Broadcast();
+				}
+			}
+		}
+		void CompletionThreadProc(void)
+		{
+			DKArray<Request*> completed;
+			DKArray<size_t> results;
+			DKArray<Request*> failed;
+			bool terminate = false;
+			while (!terminate)
+			{
+				Enter(0, 1, IORING_ENTER_GETEVENTS);
+
+				unsigned int head = *ring.cqHead;
+				unsigned int tail = LoadAcquire(ring.cqTail);
+				for (; head != tail; ++head)
+				{
+					const struct io_uring_cqe* cqe = &ring.cqes[head & *ring.cqMask];
+					Request* req = reinterpret_cast<Request*>((uintptr_t)cqe->user_data);
+					if (req)
+					{
+						completed.Add(req);
+						results.Add(cqe->res >= 0 ? (size_t)cqe->res : (size_t)-1);
+					}
+					else
+						terminate = true;
+				}
+				StoreRelease(ring.cqHead, head);
+
+				if (completed.Count() > 0)
+				{
+					ringCond.Lock();
+					inflight -= completed.Count();
+					FlushPendingNL(failed);
+					if (inflight == 0)
+						ringCond.Broadcast();
+					ringCond.Unlock();
+
+					for (Request* req : failed)
+						Complete(req, (size_t)-1);
+					failed.Clear();
+
+					for (size_t i = 0; i < completed.Count(); ++i)
+					{
+						Request* req = completed.Value(i);
+						size_t result = results.Value(i);
+						// short read or write, continue synchronously.
+						if (result != (size_t)-1 && result > 0 && result < req->length)
+						{
+							size_t r = req->write ?
+								req->file->Write(req->offset + result, (char*)req->buffer + result, req->length - result) :
+								req->file->Read(req->offset + result, (char*)req->buffer + result, req->length - result);
+							if (r != (size_t)-1)
+								result += r;
+						}
+						Complete(req, result);
+					}
+					completed.Clear();
+					results.Clear();
+				}
+			}
+		}
+#endif
+		DKAsyncIO(const DKAsyncIO&);
+		DKAsyncIO& operator = (const DKAsyncIO&);
+	};
+	template <int N> std::atomic<DKAsyncIO*> DKAsyncIO::DefaultHolder<N>::instance(NULL);
+
+	inline DKFuture<size_t> DKAsyncFile::ReadAsync(Position offset, void* buffer, size_t size)
+	{
+		return DKAsyncIO::Default().Read(this, offset, buffer, size);
+	}
+	inline DKFuture<size_t> DKAsyncFile::ReadAsync(Position offset, void* buffer, size_t size, DKAsyncIO& io)
+	{
+		return io.Read(this, offset, buffer, size);
+	}
+	inline DKFuture<size_t> DKAsyncFile::WriteAsync(Position offset, const void* buffer, size_t size)
+	{
+		return DKAsyncIO::Default().Write(this, offset, buffer, size);
+	}
+	inline DKFuture<size_t> DKAsyncFile::WriteAsync(Position offset, const void* buffer, size_t size, DKAsyncIO& io)
+	{
+		return io.Write(this, offset, buffer, size);
+	}
+}
@@ -0,0 +1,307 @@
+//
+//  File: DKConcurrentQueue.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include <type_traits>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKConcurrentQueue, DKConcurrentSPSCQueue
+// lock-free bounded FIFO queues. (ring buffer)
+//
+// DKConcurrentQueue: multi-producer, multi-consumer.
+//  any threads can push or pop concurrently, each slot has sequence number
+//  to order producer and consumer which accessing same slot.
+//
+// DKConcurrentSPSCQueue: single-producer, single-consumer.
+//  only one thread can push and only one thread can pop at same time.
+//  (producer and consumer can be different threads)
+//  faster than DKConcurrentQueue, no compare-and-swap operation involved.
+//
+// capacity is fixed at construction, rounded up to power of 2.
+// Push() returns false if queue is full, Pop() returns false if queue is
+// empty. neither function blocks, caller should retry or wait by itself.
+//
+// Note:
+//  Count(), IsEmpty() are approximate values while other threads are
+//  pushing or popping items.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		enum {ConcurrentQueueCacheLineSize = 64};
+
+		inline size_t ConcurrentQueueCapacity(size_t c)
+		{
+			size_t n = 2;
+			while (n < c)
+				n = n * 2;
+			return n;
+		}
+	}
+
+	template <typename VALUE, typename ALLOC = DKMemoryDefaultAllocator>
+	class DKConcurrentQueue
+	{
+	public:
+		typedef ALLOC Allocator;
+
+		DKConcurrentQueue(size_t capacity)
+			: mask(Private::ConcurrentQueueCapacity(capacity) - 1)
+			, cells(NULL)
+			, enqueuePos(0)
+			, dequeuePos(0)
+		{
+			cells = static_cast<Cell*>(Allocator::Alloc(sizeof(Cell) * (mask + 1)));
+			DKASSERT_DEBUG(cells != NULL);
+			for (size_t i = 0; i <= mask; ++i)
+				::new(&cells[i]) Cell(i);
+		}
+		~DKConcurrentQueue(void)
+		{
+			Cell* cell;
+			while ((cell = Acquire()) != NULL)
+			{
+				if (cell->constructed)
+					cell->Value()->~VALUE();
+				Release(cell);
+			}
+			for (size_t i = 0; i <= mask; ++i)
+				cells[i].~Cell();
+			Allocator::Free(cells);
+		}
+		bool Push(const VALUE& value)
+		{
+			return Emplace(value);
+		}
+		bool Push(VALUE&& value)
+		{
+			return Emplace(static_cast<VALUE&&>(value));
+		}
+		// construct item at tail, returns false if queue is full.
+		template <typename... Args> bool Emplace(Args&&... args)
+		{
+			size_t pos = enqueuePos.load(std::memory_order_relaxed);
+			Cell* cell;
+			for (;;)
+			{
+				cell = &cells[pos & mask];
+				size_t seq = cell->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+				if (diff == 0)
+				{
+					if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+					return false;	// full
+				else
+					pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+			// slot is published even if constructor throws, as empty slot
+			// which consumers skip. otherwise queue stops at this slot.
+			PublishGuard guard = {cell, pos};
+			cell->constructed = false;
+			::new(cell->Value()) VALUE(std::forward<Args>(args)...);
+			cell->constructed = true;
+			return true;
+		}
+		// remove item from head, returns false if queue is empty.
+		bool Pop(VALUE& value)
+		{
+			Cell* cell;
+			while ((cell = Acquire()) != NULL)
+			{
+				if (cell->constructed)
+				{
+					VALUE* p = cell->Value();
+					value = static_cast<VALUE&&>(*p);
+					p->~VALUE();
+					Release(cell);
+					return true;
+				}
+				Release(cell);
+			}
+			return false;
+		}
+		size_t Capacity(void) const
+		{
+			return mask + 1;
+		}
+		size_t Count(void) const
+		{
+			size_t head = dequeuePos.load(std::memory_order_relaxed);
+			size_t tail = enqueuePos.load(std::memory_order_relaxed);
+			return tail > head ? tail - head : 0;
+		}
+		bool IsEmpty(void) const
+		{
+			return Count() == 0;
+		}
+
+	private:
+		struct Cell
+		{
+			Cell(size_t seq) : sequence(seq) {}
+			VALUE* Value(void) {return reinterpret_cast<VALUE*>(&storage);}
+
+			std::atomic<size_t> sequence;
+			bool constructed;	// false if constructor of item threw.
+			typename std::aligned_storage<sizeof(VALUE), alignof(VALUE)>::type storage;
+		};
+		struct PublishGuard
+		{
+			Cell* cell;
+			size_t pos;
+			~PublishGuard(void)
+			{
+				cell->sequence.store(pos + 1, std::memory_order_release);
+			}
+		};
+		// reserve head cell, returns NULL if empty.
+		// Release() should be called after value destroyed.
+		Cell* Acquire(void)
+		{
+			size_t pos = dequeuePos.load(std::memory_order_relaxed);
+			Cell* cell;
+			for (;;)
+			{
+				cell = &cells[pos & mask];
+				size_t seq = cell->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+				if (diff == 0)
+				{
+					if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+					return NULL;	// empty
+				else
+					pos = dequeuePos.load(std::memory_order_relaxed);
+			}
+			return cell;
+		}
+		// make cell available to producers.
+		void Release(Cell* cell)
+		{
+			size_t pos = cell->sequence.load(std::memory_order_relaxed) - 1;
+			cell->sequence.store(pos + mask + 1, std::memory_order_release);
+		}
+
+		const size_t mask;
+		Cell* cells;
+		char pad0[Private::ConcurrentQueueCacheLineSize];
+		std::atomic<size_t> enqueuePos;
+		char pad1[Private::ConcurrentQueueCacheLineSize - sizeof(std::atomic<size_t>)];
+		std::atomic<size_t> dequeuePos;
+		char pad2[Private::ConcurrentQueueCacheLineSize - sizeof(std::atomic<size_t>)];
+
+		DKConcurrentQueue(const DKConcurrentQueue&);
+		DKConcurrentQueue& operator = (const DKConcurrentQueue&);
+	};
+
+	template <typename VALUE, typename ALLOC = DKMemoryDefaultAllocator>
+	class DKConcurrentSPSCQueue
+	{
+	public:
+		typedef ALLOC Allocator;
+
+		DKConcurrentSPSCQueue(size_t capacity)
+			: mask(Private::ConcurrentQueueCapacity(capacity) - 1)
+			, data(NULL)
+			, tail(0)
+			, cachedHead(0)
+			, head(0)
+			, cachedTail(0)
+		{
+			data = static_cast<VALUE*>(Allocator::Alloc(sizeof(VALUE) * (mask + 1)));
+			DKASSERT_DEBUG(data != NULL);
+		}
+		~DKConcurrentSPSCQueue(void)
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			size_t t = tail.load(std::memory_order_relaxed);
+			for (; h != t; ++h)
+				data[h & mask].~VALUE();
+			Allocator::Free(data);
+		}
+		// producer only.
+		bool Push(const VALUE& value)
+		{
+			return Emplace(value);
+		}
+		bool Push(VALUE&& value)
+		{
+			return Emplace(static_cast<VALUE&&>(value));
+		}
+		// construct item at tail, returns false if queue is full. (producer only)
+		template <typename... Args> bool Emplace(Args&&... args)
+		{
+			size_t t = tail.load(std::memory_order_relaxed);
+			if (t - cachedHead > mask)
+			{
+				cachedHead = head.load(std::memory_order_acquire);
+				if (t - cachedHead > mask)
+					return false;	// full
+			}
+			::new(&data[t & mask]) VALUE(std::forward<Args>(args)...);
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+		// remove item from head, returns false if queue is empty. (consumer only)
+		bool Pop(VALUE& value)
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			if (h == cachedTail)
+			{
+				cachedTail = tail.load(std::memory_order_acquire);
+				if (h == cachedTail)
+					return false;	// empty
+			}
+			VALUE* p = &data[h & mask];
+			value = static_cast<VALUE&&>(*p);
+			p->~VALUE();
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+		size_t Capacity(void) const
+		{
+			return mask + 1;
+		}
+		size_t Count(void) const
+		{
+			size_t h = head.load(std::memory_order_relaxed);
+			size_t t = tail.load(std::memory_order_relaxed);
+			return t > h ? t - h : 0;
+		}
+		bool IsEmpty(void) const
+		{
+			return Count() == 0;
+		}
+
+	private:
+		const size_t mask;
+		VALUE* data;
+		char pad0[Private::ConcurrentQueueCacheLineSize];
+		// producer side
+		std::atomic<size_t> tail;
+		size_t cachedHead;
+		char pad1[Private::ConcurrentQueueCacheLineSize - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+		// consumer side
+		std::atomic<size_t> head;
+		size_t cachedTail;
+		char pad2[Private::ConcurrentQueueCacheLineSize - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+		DKConcurrentSPSCQueue(const DKConcurrentSPSCQueue&);
+		DKConcurrentSPSCQueue& operator = (const DKConcurrentSPSCQueue&);
+	};
+}
@@ -0,0 +1,229 @@
+//
+//  File: DKCoroutine.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKOperation.h"
+#include "DKRunLoop.h"
+#include "DKThread.h"
+#include "DKFuture.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKCoroutine
+// stackless coroutine (C++20) integration with DKRunLoop and DKFuture.
+// enabled only if compiler supports coroutines. (DKLIB_COROUTINE_ENABLED)
+//
+// a function returns DKFuture<T> can be a coroutine, by using co_await or
+// co_return. coroutine starts immediately on calling thread, and returned
+// future is completed with value of co_return.
+//
+// awaitables:
+//  co_await DKResumeOn(runLoop)
+//      resume on worker thread of runLoop (or queue).
+//  co_await DKResumeAfter(seconds), DKResumeAfter(runLoop, seconds)
+//      resume on runLoop after delay. (tick base)
+//      without runLoop, current RunLoop is used, and if calling thread is
+//      not a worker thread of RunLoop, thread will be blocked for delay.
+//  co_await future
+//      resume with value of future. if awaiting thread is worker thread
+//      of RunLoop, coroutine resumes on that RunLoop, otherwise resumes on
+//      the thread which completed future.
+//
+// cancellation:
+//  if awaited future cancelled or RunLoop revoked pending operation,
+//  coroutine is destroyed without resuming (local objects are destructed)
+//  and future of coroutine is cancelled.
+//  exception thrown from coroutine cancels future of coroutine.
+//
+// Example:
+//  DKFuture<void> FadeOut(DKRunLoop* runLoop, Sprite* sprite)
+//  {
+//      DKObject<Texture> tex = co_await LoadTextureAsync("fade.png");
+//      for (int i = 0; i < 30; ++i)
+//      {
+//          sprite->SetAlpha(1.0f - i / 30.0f);
+//          co_await DKResumeAfter(runLoop, 1.0 / 30.0);
+//      }
+//  }
+////////////////////////////////////////////////////////////////////////////////
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define DKLIB_COROUTINE_ENABLED
+#endif
+#endif
+
+#ifdef DKLIB_COROUTINE_ENABLED
+#include <coroutine>
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		// resumes coroutine when performed.
+		// destroys coroutine if released without performed. (revoked)
+		template <typename Promise> class CoroutineResumer : public DKOperation
+		{
+		public:
+			CoroutineResumer(std::coroutine_handle<Promise> h) : handle(h) {}
+			~CoroutineResumer(void)
+			{
+				if (handle)
+				{
+					handle.promise().Cancel();
+					handle.destroy();
+				}
+			}
+			void Perform(void) const
+			{
+				std::coroutine_handle<Promise> h = handle;
+				handle = nullptr;
+				if (h)
+					h.resume();
+			}
+		private:
+			mutable std::coroutine_handle<Promise> handle;
+		};
+
+		template <typename T> struct CoroutinePromiseBase
+		{
+			DKFuture<T> get_return_object(void)
+			{
+				return promise.Future();
+			}
+			std::suspend_never initial_suspend(void) noexcept {return {};}
+			std::suspend_never final_suspend(void) noexcept {return {};}
+			void unhandled_exception(void)
+			{
+				promise.Cancel();
+			}
+			void Cancel(void)
+			{
+				promise.Cancel();
+			}
+			DKPromise<T> promise;
+		};
+		template <typename T> struct CoroutinePromise : public CoroutinePromiseBase<T>
+		{
+			template <typename U> void return_value(U&& value)
+			{
+				this->promise.SetValue(std::forward<U>(value));
+			}
+		};
+		template <> struct CoroutinePromise<void> : public CoroutinePromiseBase<void>
+		{
+			void return_void(void)
+			{
+				this->promise.SetValue();
+			}
+		};
+
+		template <typename QUEUE> struct CoroutineResumeOn
+		{
+			QUEUE& queue;
+			bool await_ready(void) const noexcept {return false;}
+			template <typename Promise> void await_suspend(std::coroutine_handle<Promise> h)
+			{
+				DKObject<DKOperation> op = DKOBJECT_NEW CoroutineResumer<Promise>(h);
+				FutureExecutor<QUEUE>::Post(&queue, op);
+			}
+			void await_resume(void) const noexcept {}
+		};
+		template <> struct CoroutineResumeOn<DKRunLoop>
+		{
+			DKRunLoop& queue;
+			bool await_ready(void) const noexcept
+			{
+				return queue.IsWrokingThread();
+			}
+			template <typename Promise> void await_suspend(std::coroutine_handle<Promise> h)
+			{
+				DKObject<DKOperation> op = DKOBJECT_NEW CoroutineResumer<Promise>(h);
+				queue.PostOperation(op);
+			}
+			void await_resume(void) const noexcept {}
+		};
+
+		struct CoroutineResumeAfter
+		{
+			DKRunLoop* runLoop;
+			double delay;
+			bool await_ready(void) const noexcept {return false;}
+			template <typename Promise> bool await_suspend(std::coroutine_handle<Promise> h)
+			{
+				if (runLoop == NULL)
+				{
+					DKThread::Sleep(delay);
+					return false;
+				}
+				DKObject<DKOperation> op = DKOBJECT_NEW CoroutineResumer<Promise>(h);
+				runLoop->PostOperation(op, delay);
+				return true;
+			}
+			void await_resume(void) const noexcept {}
+		};
+
+		template <typename T> struct CoroutineFutureAwaiter
+		{
+			DKFuture<T> future;
+			bool await_ready(void) const noexcept
+			{
+				return future.IsReady();
+			}
+			template <typename Promise> void await_suspend(std::coroutine_handle<Promise> h)
+			{
+				DKObject<DKOperation> op = DKOBJECT_NEW CoroutineResumer<Promise>(h);
+				DKRunLoop* runLoop = DKRunLoop::CurrentRunLoop();
+				// release resumer without performing if cancelled.
+				future.Then([op, runLoop](const auto&...)
+				{
+					if (runLoop)
+						runLoop->PostOperation(op);
+					else
+						op->Perform();
+				});
+			}
+			typename DKFuture<T>::ValueRef await_resume(void) const
+			{
+				return future.Value();
+			}
+		};
+	}
+
+	template <typename QUEUE> Private::CoroutineResumeOn<QUEUE> DKResumeOn(QUEUE& queue)
+	{
+		return {queue};
+	}
+	template <typename QUEUE> Private::CoroutineResumeOn<QUEUE> DKResumeOn(QUEUE* queue)
+	{
+		return {*queue};
+	}
+	inline Private::CoroutineResumeAfter DKResumeAfter(DKRunLoop* runLoop, double seconds)
+	{
+		return {runLoop, seconds};
+	}
+	inline Private::CoroutineResumeAfter DKResumeAfter(double seconds)
+	{
+		return {DKRunLoop::CurrentRunLoop(), seconds};
+	}
+	template <typename T> Private::CoroutineFutureAwaiter<T> operator co_await (const DKFuture<T>& future)
+	{
+		return {future};
+	}
+}
+
+// function returns DKFuture<T> can be a coroutine.
+namespace std
+{
+	template <typename T, typename... Args> struct coroutine_traits<DKFoundation::DKFuture<T>, Args...>
+	{
+		typedef DKFoundation::Private::CoroutinePromise<T> promise_type;
+	};
+}
+
+#endif	// DKLIB_COROUTINE_ENABLED
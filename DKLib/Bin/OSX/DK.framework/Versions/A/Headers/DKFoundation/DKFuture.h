@@ -0,0 +1,551 @@
+//
+//  File: DKFuture.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include <type_traits>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKFunction.h"
+#include "DKInvocation.h"
+#include "DKOperation.h"
+#include "DKCondition.h"
+#include "DKArray.h"
+#include "DKRunLoop.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKFuture<T>, DKPromise<T>
+// typed result of asynchronous operation, with continuation chaining.
+//
+// DKPromise is producer side, DKFuture is consumer side of same state.
+// state can be completed once, with value or cancelled.
+//
+// DKAsync(queue, invocation): post invocation to queue, returns future of
+//  invocation result. (replacement of DKOperationQueue::ProcessAsync)
+//
+// Then(func), Then(queue, func): add continuation, returns future of
+//  continuation result. func takes value of completed future (or nothing
+//  for DKFuture<void>). without queue, func is called on the thread which
+//  completed future. with queue, func is posted to queue. queue can be
+//  DKOperationQueue, DKWorkStealingQueue, DKRunLoop or any type which has
+//  Post(DKOperation*). queue must be alive until continuation posted.
+//
+// DKWhenAll(futures): completed with values of all futures.
+// DKWhenAny(futures): completed with index of first completed future.
+//
+// cancellation:
+//  Cancel() cancels future which is not completed yet, and propagates to
+//  futures it depends on (source of Then, inputs of DKWhenAll, DKWhenAny),
+//  only if cancelled future is the last dependent of them. (other
+//  continuations of same source are not cancelled)
+//  cancelled future cancels all continuations, instead of calling them.
+//  pending future is cancelled also when its state destroyed. (promise
+//  and futures are released)
+//  DKAsync skips invocation cancelled before started, long operation can
+//  test DKPromise::IsCancelled() to stop early.
+//
+// Example:
+//  DKAsync(ioQueue, DKFunction(LoadFile)->Invocation(path))
+//    .Then(decodeQueue, [](const DKObject<DKData>& d) {return DecodeImage(d);})
+//    .Then(renderLoop, [](const DKObject<Image>& img) {UploadTexture(img);});
+//
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	template <typename T> class DKFuture;
+	template <typename T> class DKPromise;
+
+	namespace Private
+	{
+		class FutureStateBase
+		{
+		public:
+			enum State
+			{
+				StatePending = 0,
+				StateReady,
+				StateCancelled,
+			};
+			typedef DKObject<FutureStateBase>::Ref WeakRef;
+
+			FutureStateBase(void) : state(StatePending), dependents(0)
+			{
+			}
+			virtual ~FutureStateBase(void)
+			{
+				// dependents cannot be completed. (broken promise)
+				if (state.load(std::memory_order_acquire) == StatePending)
+				{
+					cond.Lock();
+					FinishNL(StateCancelled);
+				}
+			}
+			bool IsPending(void) const		{return state.load(std::memory_order_acquire) == StatePending;}
+			bool IsReady(void) const		{return state.load(std::memory_order_acquire) == StateReady;}
+			bool IsCancelled(void) const	{return state.load(std::memory_order_acquire) == StateCancelled;}
+
+			// wait until completed, returns true if value is ready.
+			bool Wait(void) const
+			{
+				cond.Lock();
+				while (state.load(std::memory_order_relaxed) == StatePending)
+					cond.Wait();
+				bool ready = state.load(std::memory_order_relaxed) == StateReady;
+				cond.Unlock();
+				return ready;
+			}
+			// returns false if timed out or cancelled.
+			bool WaitTimeout(double t) const
+			{
+				cond.Lock();
+				if (state.load(std::memory_order_relaxed) == StatePending)
+					cond.WaitTimeout(t);
+				bool ready = state.load(std::memory_order_relaxed) == StateReady;
+				cond.Unlock();
+				return ready;
+			}
+			// cancel and propagate to upstream, which has no other dependents.
+			bool Cancel(void)
+			{
+				if (SetCancelled())
+				{
+					for (WeakRef& ref : upstream)
+					{
+						DKObject<FutureStateBase> s = ref;
+						if (s && s->dependents.fetch_sub(1, std::memory_order_acq_rel) == 1)
+							s->Cancel();
+					}
+					return true;
+				}
+				return false;
+			}
+			// cancel without propagation. (cancelled by upstream)
+			bool SetCancelled(void)
+			{
+				cond.Lock();
+				if (state.load(std::memory_order_relaxed) != StatePending)
+				{
+					cond.Unlock();
+					return false;
+				}
+				FinishNL(StateCancelled);
+				return true;
+			}
+			// operation will be performed when completed, or performed
+			// immediately if completed already.
+			void AddContinuation(DKOperation* op)
+			{
+				cond.Lock();
+				if (state.load(std::memory_order_relaxed) == StatePending)
+				{
+					continuations.Add(op);
+					cond.Unlock();
+				}
+				else
+				{
+					cond.Unlock();
+					op->Perform();
+				}
+			}
+			// should be called before state shared.
+			void AddUpstream(FutureStateBase* s)
+			{
+				s->dependents.fetch_add(1, std::memory_order_relaxed);
+				upstream.Add(DKObject<FutureStateBase>(s));
+			}
+
+		protected:
+			// update state, perform continuations. (cond should be locked)
+			void FinishNL(State s)
+			{
+				state.store(s, std::memory_order_release);
+				cond.Broadcast();
+				DKArray<DKObject<DKOperation>> ops = static_cast<DKArray<DKObject<DKOperation>>&&>(continuations);
+				cond.Unlock();
+
+				for (DKObject<DKOperation>& op : ops)
+					op->Perform();
+			}
+
+			std::atomic<int> state;
+			DKCondition cond;
+		private:
+			DKArray<DKObject<DKOperation>> continuations;
+			DKArray<WeakRef> upstream;
+			std::atomic<int> dependents;	// number of states added this as upstream.
+
+			FutureStateBase(const FutureStateBase&);
+			FutureStateBase& operator = (const FutureStateBase&);
+		};
+
+		template <typename T> class FutureState : public FutureStateBase
+		{
+		public:
+			typedef const T& ValueRef;
+
+			~FutureState(void)
+			{
+				if (IsReady())
+					reinterpret_cast<T*>(&storage)->~T();
+			}
+			template <typename... Args> bool SetValue(Args&&... args)
+			{
+				cond.Lock();
+				if (state.load(std::memory_order_relaxed) != StatePending)
+				{
+					cond.Unlock();
+					return false;
+				}
+				::new(&storage) T(std::forward<Args>(args)...);
+				FinishNL(StateReady);
+				return true;
+			}
+			// wait until completed, value should be ready.
+			ValueRef Value(void) const
+			{
+				Wait();
+				DKASSERT_DEBUG(IsReady());
+				return *reinterpret_cast<const T*>(&storage);
+			}
+		private:
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		};
+		template <> class FutureState<void> : public FutureStateBase
+		{
+		public:
+			typedef void ValueRef;
+
+			bool SetValue(void)
+			{
+				cond.Lock();
+				if (state.load(std::memory_order_relaxed) != StatePending)
+				{
+					cond.Unlock();
+					return false;
+				}
+				FinishNL(StateReady);
+				return true;
+			}
+			ValueRef Value(void) const
+			{
+				Wait();
+				DKASSERT_DEBUG(IsReady());
+			}
+		};
+
+		// call function, store result to state.
+		template <typename R> struct FutureResult
+		{
+			template <typename Fn, typename... Args> static void Apply(FutureState<R>* state, Fn& fn, Args&&... args)
+			{
+				state->SetValue(fn(std::forward<Args>(args)...));
+			}
+		};
+		template <> struct FutureResult<void>
+		{
+			template <typename Fn, typename... Args> static void Apply(FutureState<void>* state, Fn& fn, Args&&... args)
+			{
+				fn(std::forward<Args>(args)...);
+				state->SetValue();
+			}
+		};
+		// call continuation with value of source.
+		template <typename T> struct FutureArgument
+		{
+			template <typename Fn> struct Result
+			{
+				typedef typename std::decay<decltype(std::declval<Fn&>()(std::declval<const T&>()))>::type Type;
+			};
+			template <typename R, typename Fn> static void Apply(FutureState<R>* state, Fn& fn, const FutureState<T>* source)
+			{
+				FutureResult<R>::Apply(state, fn, source->Value());
+			}
+		};
+		template <> struct FutureArgument<void>
+		{
+			template <typename Fn> struct Result
+			{
+				typedef typename std::decay<decltype(std::declval<Fn&>()())>::type Type;
+			};
+			template <typename R, typename Fn> static void Apply(FutureState<R>* state, Fn& fn, const FutureState<void>*)
+			{
+				FutureResult<R>::Apply(state, fn);
+			}
+		};
+		// collect values for DKWhenAll.
+		template <typename T> struct FutureCollect
+		{
+			typedef DKArray<T> Type;
+			static void Apply(FutureState<Type>* state, DKArray<DKObject<FutureState<T>>>& sources)
+			{
+				Type values;
+				values.Reserve(sources.Count());
+				for (DKObject<FutureState<T>>& s : sources)
+					values.Add(s->Value());
+				state->SetValue(static_cast<Type&&>(values));
+			}
+		};
+		template <> struct FutureCollect<void>
+		{
+			typedef void Type;
+			static void Apply(FutureState<void>* state, DKArray<DKObject<FutureState<void>>>&)
+			{
+				state->SetValue();
+			}
+		};
+		// access state of DKFuture.
+		struct FutureAccess
+		{
+			template <typename T> static FutureState<T>* StateOf(const DKFuture<T>& f)
+			{
+				return const_cast<FutureState<T>*>(f.state.Ptr());
+			}
+		};
+		// post continuation to queue.
+		template <typename QUEUE> struct FutureExecutor
+		{
+			static void Post(void* queue, DKOperation* op)
+			{
+				static_cast<QUEUE*>(queue)->Post(op);
+			}
+		};
+		template <> struct FutureExecutor<DKRunLoop>
+		{
+			static void Post(void* queue, DKOperation* op)
+			{
+				static_cast<DKRunLoop*>(queue)->PostOperation(op);
+			}
+		};
+	}
+
+	template <typename T> class DKFuture
+	{
+	public:
+		typedef Private::FutureState<T> State;
+		typedef typename State::ValueRef ValueRef;
+
+		DKFuture(void)
+		{
+		}
+		explicit DKFuture(State* s) : state(s)
+		{
+		}
+		bool IsValid(void) const		{return state != NULL;}
+		bool IsPending(void) const		{return state->IsPending();}
+		bool IsReady(void) const		{return state->IsReady();}
+		bool IsCancelled(void) const	{return state->IsCancelled();}
+
+		// wait until completed, returns true if value is ready,
+		// false if cancelled.
+		bool Wait(void) const
+		{
+			return state->Wait();
+		}
+		bool WaitTimeout(double t) const
+		{
+			return state->WaitTimeout(t);
+		}
+		// wait until completed. should not be called for cancelled future.
+		ValueRef Value(void) const
+		{
+			return state->Value();
+		}
+		// returns false if completed already.
+		bool Cancel(void)
+		{
+			return state->Cancel();
+		}
+
+		// call func on the thread which completes this future.
+		template <typename Fn> auto Then(Fn&& fn) const
+			-> DKFuture<typename Private::FutureArgument<T>::template Result<Fn>::Type>
+		{
+			return AddContinuation(std::forward<Fn>(fn), NULL, NULL);
+		}
+		// post func to queue when this future is completed.
+		template <typename QUEUE, typename Fn> auto Then(QUEUE& queue, Fn&& fn) const
+			-> DKFuture<typename Private::FutureArgument<T>::template Result<Fn>::Type>
+		{
+			return AddContinuation(std::forward<Fn>(fn), &queue, &Private::FutureExecutor<QUEUE>::Post);
+		}
+
+	private:
+		template <typename Fn> auto AddContinuation(Fn&& fn, void* queue, void (*post)(void*, DKOperation*)) const
+			-> DKFuture<typename Private::FutureArgument<T>::template Result<Fn>::Type>
+		{
+			typedef typename Private::FutureArgument<T>::template Result<Fn>::Type R;
+			typedef typename std::decay<Fn>::type Function;
+			DKASSERT_DEBUG(state != NULL);
+
+			DKObject<Private::FutureState<R>> next = DKOBJECT_NEW Private::FutureState<R>();
+			next->AddUpstream(const_cast<State*>(state.Ptr()));
+
+			// source holds continuation, continuation holds source weakly.
+			typename DKObject<State>::Ref sourceRef = state;
+			Function func(std::forward<Fn>(fn));
+			DKObject<DKInvocation<void>> continuation = DKFunction([sourceRef, next, func, queue, post]() mutable
+			{
+				DKObject<State> source = sourceRef;
+				if (source == NULL || !source->IsReady())
+				{
+					next->SetCancelled();
+					return;
+				}
+				DKObject<DKInvocation<void>> op = DKFunction([source, next, func]() mutable
+				{
+					if (next->IsPending())
+						Private::FutureArgument<T>::template Apply<R>(next, func, source);
+				})->Invocation();
+				if (post)
+					post(queue, op);
+				else
+					op->Perform();
+			})->Invocation();
+
+			const_cast<State*>(state.Ptr())->AddContinuation(continuation);
+			return DKFuture<R>(next);
+		}
+
+		DKObject<State> state;
+		friend struct Private::FutureAccess;
+	};
+
+	template <typename T> class DKPromise
+	{
+	public:
+		typedef Private::FutureState<T> State;
+
+		DKPromise(void) : state(DKOBJECT_NEW State())
+		{
+		}
+		DKFuture<T> Future(void) const
+		{
+			return DKFuture<T>(const_cast<State*>(state.Ptr()));
+		}
+		// returns false if completed already.
+		template <typename... Args> bool SetValue(Args&&... args)
+		{
+			return state->SetValue(std::forward<Args>(args)...);
+		}
+		bool Cancel(void)
+		{
+			return state->Cancel();
+		}
+		bool IsCancelled(void) const
+		{
+			return state->IsCancelled();
+		}
+	private:
+		DKObject<State> state;
+	};
+
+	// post function to queue, returns future of result.
+	template <typename QUEUE, typename Fn> auto DKAsync(QUEUE& queue, Fn&& fn)
+		-> DKFuture<typename std::decay<decltype(fn())>::type>
+	{
+		typedef typename std::decay<decltype(fn())>::type R;
+		typedef typename std::decay<Fn>::type Function;
+
+		DKObject<Private::FutureState<R>> state = DKOBJECT_NEW Private::FutureState<R>();
+		Function func(std::forward<Fn>(fn));
+		DKObject<DKInvocation<void>> op = DKFunction([state, func]() mutable
+		{
+			// skip if cancelled before started.
+			if (state->IsPending())
+				Private::FutureResult<R>::Apply(state, func);
+		})->Invocation();
+		Private::FutureExecutor<QUEUE>::Post(&queue, op);
+		return DKFuture<R>(state);
+	}
+	template <typename QUEUE, typename R> DKFuture<R> DKAsync(QUEUE& queue, DKInvocation<R>* invocation)
+	{
+		DKObject<DKInvocation<R>> inv(invocation);
+		return DKAsync(queue, [inv]() {return inv->Invoke();});
+	}
+	template <typename QUEUE, typename R> DKFuture<R> DKAsync(QUEUE& queue, const DKObject<DKInvocation<R>>& invocation)
+	{
+		return DKAsync(queue, const_cast<DKInvocation<R>*>(invocation.Ptr()));
+	}
+
+	// completed when all futures are ready, cancelled if one of them cancelled.
+	template <typename T> auto DKWhenAll(const DKArray<DKFuture<T>>& futures)
+		-> DKFuture<typename Private::FutureCollect<T>::Type>
+	{
+		typedef typename Private::FutureCollect<T>::Type R;
+		typedef Private::FutureState<T> Source;
+		struct Context
+		{
+			Context(size_t n) : remaining(n) {sources.Resize(n);}
+			DKArray<DKObject<Source>> sources;	// filled when completed.
+			std::atomic<size_t> remaining;
+		};
+
+		size_t count = futures.Count();
+		DKObject<Private::FutureState<R>> next = DKOBJECT_NEW Private::FutureState<R>();
+		for (const DKFuture<T>& f : futures)
+			next->AddUpstream(Private::FutureAccess::StateOf(f));
+		if (count == 0)
+		{
+			DKArray<DKObject<Source>> empty;
+			Private::FutureCollect<T>::Apply(next, empty);
+			return DKFuture<R>(next);
+		}
+
+		DKObject<Context> ctxt = DKOBJECT_NEW Context(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			Source* s = Private::FutureAccess::StateOf(futures.Value(i));
+			typename DKObject<Source>::Ref sourceRef = DKObject<Source>(s);
+			s->AddContinuation(DKFunction([sourceRef, ctxt, next, i]() mutable
+			{
+				DKObject<Source> source = sourceRef;
+				if (source == NULL || !source->IsReady())
+				{
+					next->SetCancelled();
+					return;
+				}
+				ctxt->sources.Value(i) = source;
+				if (ctxt->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					Private::FutureCollect<T>::Apply(next, ctxt->sources);
+			})->Invocation());
+		}
+		return DKFuture<R>(next);
+	}
+	// completed with index of first ready future, cancelled if all cancelled.
+	template <typename T> DKFuture<size_t> DKWhenAny(const DKArray<DKFuture<T>>& futures)
+	{
+		typedef Private::FutureState<T> Source;
+
+		size_t count = futures.Count();
+		DKObject<Private::FutureState<size_t>> next = DKOBJECT_NEW Private::FutureState<size_t>();
+		for (const DKFuture<T>& f : futures)
+			next->AddUpstream(Private::FutureAccess::StateOf(f));
+		if (count == 0)
+		{
+			next->SetCancelled();
+			return DKFuture<size_t>(next);
+		}
+
+		DKObject<std::atomic<size_t>> cancelled = DKOBJECT_NEW std::atomic<size_t>(0);
+		for (size_t i = 0; i < count; ++i)
+		{
+			Source* s = Private::FutureAccess::StateOf(futures.Value(i));
+			typename DKObject<Source>::Ref sourceRef = DKObject<Source>(s);
+			s->AddContinuation(DKFunction([sourceRef, cancelled, next, i, count]() mutable
+			{
+				DKObject<Source> source = sourceRef;
+				if (source && source->IsReady())
+					next->SetValue(i);
+				else if (cancelled->fetch_add(1) + 1 == count)
+					next->SetCancelled();
+			})->Invocation());
+		}
+		return DKFuture<size_t>(next);
+	}
+}
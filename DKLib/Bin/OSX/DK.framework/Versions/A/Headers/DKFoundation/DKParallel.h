@@ -0,0 +1,292 @@
+//
+//  File: DKParallel.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <thread>
+#include <atomic>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKObject.h"
+#include "DKFunction.h"
+#include "DKAtomicNumber32.h"
+#include "DKOperationQueue.h"
+#include "DKStaticArray.h"
+#include "DKArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKParallelFor, DKParallelSort
+// data parallel algorithms using shared DKOperationQueue.
+//
+// DKParallelFor(begin, end, func)
+//  call func(index) for all index in [begin, end), concurrently.
+//  range is divided into chunks which is not smaller than 'grain'.
+//  (if grain is zero, chunk size will be determined automatically)
+//  range smaller than grain is processed on calling thread. (serial)
+//
+// DKParallelSort(data, count, cmp)
+//  sort items in parallel, chunks are sorted individually and merged.
+//  items are moved by memcpy, and additional buffer (count * sizeof(VALUE))
+//  is required. not a stable sort.
+//  sorting fewer items than DKParallelSortCutoff, or items which are not
+//  trivially relocatable (see DKTypeTraits.h) is processed serially.
+//
+// DKParallelSort(array, cmp), DKParallelEnumerate(array, enumerator)
+//  same as above, with DKArray. array is locked while processing.
+//  enumerator (VALUE&) is called concurrently, order is not specified.
+//
+// Calling thread also performs tasks and waits until all tasks are done.
+// nested call (DKParallelFor inside of func) is allowed, pending tasks
+// which not started are cancelled and processed by calling thread.
+// shared queue is created when it used first time.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	enum {DKParallelSortCutoff = 0x4000};
+
+	namespace Private
+	{
+		class Parallel
+		{
+		public:
+			enum {MaxHelpers = 63};
+
+			// number of threads performing tasks (including calling thread)
+			static size_t NumThreads(void)
+			{
+				// calculated on first use, threads may store same value at once.
+				size_t n = NumThreadsHolder<0>::value.load(std::memory_order_relaxed);
+				if (n == 0)
+				{
+					n = Clamp<size_t>(std::thread::hardware_concurrency(), 1, MaxHelpers + 1);
+					NumThreadsHolder<0>::value.store(n, std::memory_order_relaxed);
+				}
+				return n;
+			}
+			// perform func(index) for index in [0, numTasks), returns when
+			// all tasks are done.
+			template <typename Func> static void Run(size_t numTasks, Func&& func)
+			{
+				size_t numHelpers = Min(numTasks, NumThreads()) - 1;
+				DKOperationQueue* queue = numHelpers > 0 ? Queue() : NULL;
+				if (queue == NULL)
+				{
+					for (size_t i = 0; i < numTasks; ++i)
+						func(i);
+					return;
+				}
+
+				DKAtomicNumber32 next(0);
+				auto perform = [&func, &next, numTasks](void)
+				{
+					for (size_t i = static_cast<size_t>(next.Increment()); i < numTasks; i = static_cast<size_t>(next.Increment()))
+						func(i);
+				};
+				DKObject<DKOperation> op = DKFunction(perform)->Invocation().template SafeCast<DKOperation>();
+				DKObject<DKOperationQueue::OperationSync> helpers[MaxHelpers];
+				for (size_t i = 0; i < numHelpers; ++i)
+					helpers[i] = queue->ProcessAsync(op);
+
+				perform();
+
+				// cancel helpers not started yet, wait for others.
+				for (size_t i = 0; i < numHelpers; ++i)
+				{
+					if (!helpers[i]->Cancel())
+						helpers[i]->Sync();
+				}
+			}
+			// merge two sorted ranges, partially. output range is [k0, k1)
+			template <typename VALUE, typename CompareFunc>
+			static void Merge(const VALUE* a, size_t lenA, const VALUE* b, size_t lenB, VALUE* output, size_t k0, size_t k1, CompareFunc& cmp)
+			{
+				size_t i = MergePath(a, lenA, b, lenB, k0, cmp);
+				size_t j = k0 - i;
+				size_t iEnd = MergePath(a, lenA, b, lenB, k1, cmp);
+				size_t jEnd = k1 - iEnd;
+				VALUE* out = &output[k0];
+				while (i < iEnd && j < jEnd)
+				{
+					if (cmp(b[j], a[i]))
+						memcpy(out++, &b[j++], sizeof(VALUE));
+					else
+						memcpy(out++, &a[i++], sizeof(VALUE));
+				}
+				if (i < iEnd)
+					memcpy(out, &a[i], sizeof(VALUE) * (iEnd - i));
+				else if (j < jEnd)
+					memcpy(out, &b[j], sizeof(VALUE) * (jEnd - j));
+			}
+			// number of items from 'a', in first k items of merged output.
+			template <typename VALUE, typename CompareFunc>
+			static size_t MergePath(const VALUE* a, size_t lenA, const VALUE* b, size_t lenB, size_t k, CompareFunc& cmp)
+			{
+				size_t lo = k > lenB ? k - lenB : 0;
+				size_t hi = Min(k, lenA);
+				while (lo < hi)
+				{
+					size_t mid = (lo + hi) / 2;
+					if (cmp(b[k - mid - 1], a[mid]))
+						hi = mid;
+					else
+						lo = mid + 1;
+				}
+				return lo;
+			}
+
+		private:
+			template <int N> struct NumThreadsHolder
+			{
+				static std::atomic<size_t> value;
+			};
+			template <int N> struct QueueHolder
+			{
+				static std::atomic<DKOperationQueue*> queue;
+			};
+			// queue is never destroyed, tasks can be performed while other
+			// global objects being destroyed. NULL if cannot be allocated.
+			static DKOperationQueue* Queue(void)
+			{
+				DKOperationQueue* queue = QueueHolder<0>::queue.load(std::memory_order_acquire);
+				if (queue == NULL)
+				{
+					void* mem = DKMemoryHeapAlloc(sizeof(DKOperationQueue));
+					if (mem == NULL)
+						return NULL;
+					DKOperationQueue* newQueue = new(mem) DKOperationQueue();
+					if (QueueHolder<0>::queue.compare_exchange_strong(queue, newQueue, std::memory_order_acq_rel))
+						queue = newQueue;
+					else
+					{
+						newQueue->~DKOperationQueue();
+						DKMemoryHeapFree(newQueue);
+					}
+				}
+				return queue;
+			}
+		};
+		template <int N> std::atomic<size_t> Parallel::NumThreadsHolder<N>::value(0);
+		template <int N> std::atomic<DKOperationQueue*> Parallel::QueueHolder<N>::queue(NULL);
+	}
+
+	template <typename Func> void DKParallelFor(size_t begin, size_t end, Func&& func, size_t grain = 0)
+	{
+		if (begin >= end)
+			return;
+
+		size_t count = end - begin;
+		size_t numThreads = Private::Parallel::NumThreads();
+		if (grain == 0)
+			grain = Max<size_t>(count / (numThreads * 8), 1);
+		if (count <= grain || numThreads < 2)
+		{
+			for (size_t i = begin; i < end; ++i)
+				func(i);
+			return;
+		}
+		size_t numChunks = (count + grain - 1) / grain;
+		Private::Parallel::Run(numChunks, [&](size_t chunk)
+		{
+			size_t first = begin + chunk * grain;
+			size_t last = Min(first + grain, end);
+			for (size_t i = first; i < last; ++i)
+				func(i);
+		});
+	}
+
+	template <typename VALUE, typename CompareFunc> void DKParallelSort(VALUE* data, size_t count, CompareFunc cmp)
+	{
+		size_t numThreads = Private::Parallel::NumThreads();
+		if (count < DKParallelSortCutoff || numThreads < 2 || !DKTriviallyRelocatable<VALUE>::Result)
+		{
+			DKStaticArray<VALUE>(data, count).template Sort<CompareFunc>(cmp);
+			return;
+		}
+		VALUE* buffer = static_cast<VALUE*>(DKMemoryHeapAlloc(sizeof(VALUE) * count));
+		if (buffer == NULL)
+		{
+			DKStaticArray<VALUE>(data, count).template Sort<CompareFunc>(cmp);
+			return;
+		}
+
+		// number of chunks, power of 2.
+		size_t numChunks = 2;
+		while (numChunks < numThreads && count / (numChunks * 2) >= DKParallelSortCutoff / 2)
+			numChunks = numChunks * 2;
+
+		// numChunks is not greater than (MaxHelpers + 1).
+		size_t bounds[Private::Parallel::MaxHelpers + 2];
+		for (size_t i = 0; i <= numChunks; ++i)
+			bounds[i] = count * i / numChunks;
+
+		Private::Parallel::Run(numChunks, [&](size_t chunk)
+		{
+			DKStaticArray<VALUE>(&data[bounds[chunk]], bounds[chunk+1] - bounds[chunk]).template Sort<CompareFunc>(cmp);
+		});
+
+		// merge pairs of sorted runs, each merge is divided into pieces.
+		VALUE* src = data;
+		VALUE* dst = buffer;
+		for (size_t runs = numChunks; runs > 1; runs = runs / 2)
+		{
+			size_t pieces = numChunks / (runs / 2);
+			Private::Parallel::Run(numChunks, [&](size_t task)
+			{
+				size_t pair = task / pieces;
+				size_t piece = task % pieces;
+				size_t begin = bounds[pair * 2];
+				size_t mid = bounds[pair * 2 + 1];
+				size_t end = bounds[pair * 2 + 2];
+				size_t length = end - begin;
+				Private::Parallel::Merge(&src[begin], mid - begin, &src[mid], end - mid, &dst[begin],
+										 length * piece / pieces, length * (piece + 1) / pieces, cmp);
+			});
+			for (size_t i = 0; i <= runs / 2; ++i)
+				bounds[i] = bounds[i * 2];
+
+			VALUE* tmp = src;
+			src = dst;
+			dst = tmp;
+		}
+		if (src != data)
+			memcpy(data, src, sizeof(VALUE) * count);
+
+		DKMemoryHeapFree(buffer);
+	}
+
+	template <typename VALUE, typename LOCK, typename ALLOC, typename CompareFunc>
+	void DKParallelSort(DKArray<VALUE, LOCK, ALLOC>& array, CompareFunc cmp)
+	{
+		typename DKArray<VALUE, LOCK, ALLOC>::CriticalSection guard(array.lock);
+		size_t count = array.CountNoLock();
+		if (count > 1)
+			DKParallelSort<VALUE, CompareFunc>((VALUE*)array, count, cmp);
+	}
+
+	template <typename VALUE, typename LOCK, typename ALLOC, typename T>
+	void DKParallelEnumerate(DKArray<VALUE, LOCK, ALLOC>& array, T&& enumerator)
+	{
+		static_assert(DKFunctionType<T&&>::Signature::template CanInvokeWithParameterTypes<VALUE&>(),
+					  "enumerator's parameter is not compatible with (VALUE&)");
+
+		typename DKArray<VALUE, LOCK, ALLOC>::CriticalSection guard(array.lock);
+		VALUE* p = array;
+		DKParallelFor(0, array.CountNoLock(), [p, &enumerator](size_t i) {enumerator(p[i]);});
+	}
+
+	template <typename VALUE, typename LOCK, typename ALLOC, typename T>
+	void DKParallelEnumerate(const DKArray<VALUE, LOCK, ALLOC>& array, T&& enumerator)
+	{
+		static_assert(DKFunctionType<T&&>::Signature::template CanInvokeWithParameterTypes<const VALUE&>(),
+					  "enumerator's parameter is not compatible with (const VALUE&)");
+
+		typename DKArray<VALUE, LOCK, ALLOC>::CriticalSection guard(array.lock);
+		const VALUE* p = array;
+		DKParallelFor(0, array.CountNoLock(), [p, &enumerator](size_t i) {enumerator(p[i]);});
+	}
+}
@@ -13,6 +13,7 @@
 #include "DKCriticalSection.h"
 #include "DKMemory.h"
 #include "DKFunction.h"
+#include "DKStaticArray.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // DKQueue
@@ -22,6 +23,9 @@
 //   PushFront() with multiple items: returns first item's pointer. (temporal)
 //   PushBack() with multiple items: returns last item's pointer. (temporal)
 //   Do not store pointer address returned by above functions!
+//
+//   Items are relocated by memmove if DKTriviallyRelocatable<VALUE> is true,
+//   otherwise items are moved by move-constructor. (see DKTypeTraits.h)
 ////////////////////////////////////////////////////////////////////////////////
 
 namespace DKFoundation
@@ -142,6 +146,21 @@ namespace DKFoundation
 		{
 			return PushFront(value, 1);
 		}
+		VALUE* PushFront(VALUE&& value)
+		{
+			return EmplaceFront(static_cast<VALUE&&>(value));
+		}
+		// construct one item at head with arguments.
+		template <typename... Args> VALUE* EmplaceFront(Args&&... args)
+		{
+			CriticalSection guard(lock);
+			ReserveFront(1);
+			::new(&data[begin-1]) VALUE(std::forward<Args>(args)...);
+			begin--;
+			count++;
+			Balance();
+			return &data[begin];
+		}
 		VALUE* PushFront(std::initializer_list<VALUE> il)
 		{
 			CriticalSection guard(lock);
@@ -194,6 +213,20 @@ namespace DKFoundation
 		{
 			return PushBack(value, 1);
 		}
+		VALUE* PushBack(VALUE&& value)
+		{
+			return EmplaceBack(static_cast<VALUE&&>(value));
+		}
+		// construct one item at tail with arguments.
+		template <typename... Args> VALUE* EmplaceBack(Args&&... args)
+		{
+			CriticalSection guard(lock);
+			ReserveBack(1);
+			::new(&data[begin+count]) VALUE(std::forward<Args>(args)...);
+			count++;
+			Balance();
+			return &data[begin+count-1];
+		}
 		VALUE* PushBack(std::initializer_list<VALUE> il)
 		{
 			CriticalSection guard(lock);
@@ -219,7 +252,7 @@ namespace DKFoundation
 
 			if (count > 0)
 			{
-				ret = data[begin];
+				ret = static_cast<VALUE&&>(data[begin]);
 				data[begin].~VALUE();
 				begin++;
 				count--;
@@ -233,7 +266,7 @@ namespace DKFoundation
 			CriticalSection guard(lock);
 			DKASSERT_DEBUG(count > 0);	// Error! queue is empty!
 
-			VALUE ret = data[begin];
+			VALUE ret = static_cast<VALUE&&>(data[begin]);
 			data[begin].~VALUE();
 			begin++;
 			count--;
@@ -246,7 +279,7 @@ namespace DKFoundation
 
 			if (count > 0)
 			{
-				ret = data[begin+count-1];
+				ret = static_cast<VALUE&&>(data[begin+count-1]);
 				data[begin+count-1].~VALUE();
 				count--;
 				Balance();
@@ -259,7 +292,7 @@ namespace DKFoundation
 			CriticalSection guard(lock);
 			DKASSERT_DEBUG(count > 0);	// Error! queue is empty!
 
-			VALUE ret = data[begin+count-1];
+			VALUE ret = static_cast<VALUE&&>(data[begin+count-1]);
 			data[begin+count-1].~VALUE();
 			count--;
 			Balance();
@@ -516,8 +549,7 @@ namespace DKFoundation
 			size_t offset = newSize - maxSize;
 			if (data)
 			{
-				if (count)
-					memcpy(&dataNew[begin+offset], &data[begin], sizeof(VALUE) * count);
+				Private::RelocateItems(&dataNew[begin+offset], &data[begin], count);
 				Allocator::Free(data);
 			}
 			maxSize += offset;
@@ -537,8 +569,7 @@ namespace DKFoundation
 			VALUE* dataNew = (VALUE*)Allocator::Alloc(sizeof(VALUE) * newSize);
 			if (data)
 			{
-				if (count)
-					memcpy(&dataNew[begin], &data[begin], sizeof(VALUE) * count);
+				Private::RelocateItems(&dataNew[begin], &data[begin], count);
 				Allocator::Free(data);
 			}
 			maxSize = newSize;
@@ -555,8 +586,7 @@ namespace DKFoundation
 
 			if (begin2 != begin)
 			{
-				if (count > 0)
-					memmove(&data[begin2], &data[begin], sizeof(VALUE) * count);
+				Private::RelocateItems(&data[begin2], &data[begin], count);
 				begin = begin2;
 			}
 		}
@@ -74,13 +74,11 @@ namespace DKFoundation
 		}
 		DKSet(const Value* v, size_t n)
 		{
-			for (size_t i = 0; i < n; ++i)
-				container.Insert(v[i]);
+			container.Insert(v, n);
 		}
 		DKSet(std::initializer_list<Value> il)
 		{
-			for (const Value& v : il)
-				container.Insert(v);
+			container.Insert(il.begin(), il.size());
 		}
 		~DKSet(void)
 		{
@@ -93,14 +91,12 @@ namespace DKFoundation
 		void Insert(const Value* v, size_t n)
 		{
 			CriticalSection guard(lock);
-			for (size_t i = 0; i < n; ++i)
-				container.Insert(v[i]);
+			container.Insert(v, n);
 		}
 		void Insert(std::initializer_list<Value> il)
 		{
 			CriticalSection guard(lock);
-			for (const Value& v : il)
-				container.Insert(v);
+			container.Insert(il.begin(), il.size());
 		}
 		template <typename L, typename C, typename A> DKSet& Union(const DKSet<VALUE,L,C,A>& s)
 		{
@@ -108,6 +104,17 @@ namespace DKFoundation
 			s.EnumerateForward([this](const VALUE& val) { container.Insert(val); });
 			return *this;
 		}
+		// same container type, merge trees directly.
+		template <typename L> DKSet& Union(const DKSet<VALUE,L,COMPARE,ALLOC>& s)
+		{
+			if (static_cast<const void*>(&s) != this)
+			{
+				// lock in order of address, other thread may merge in reverse.
+				DKOrderedCriticalSection<Lock, L> guard(lock, s.lock);
+				container.Union(s.container);
+			}
+			return *this;
+		}
 		template <typename L, typename C, typename A> DKSet& Intersect(const DKSet<VALUE,L,C,A>& s)
 		{
 			CriticalSection guard(lock);
@@ -165,8 +172,8 @@ namespace DKFoundation
 		{
 			if (this != &s)
 			{
-				CriticalSection guardOther(s.lock);
-				CriticalSection guardSelf(lock);
+				// lock in order of address, other thread may assign in reverse.
+				DKOrderedCriticalSection<Lock, Lock> guard(lock, s.lock);
 
 				container = s.container;
 			}
@@ -176,8 +183,7 @@ namespace DKFoundation
 		{
 			CriticalSection guard(lock);
 			container.Clear();
-			for (const Value& v : il)
-				container.Insert(v);
+			container.Insert(il.begin(), il.size());
 			return *this;
 		}
 		// lambda enumerator (const VALUE&) or (const VALUE&, bool*) are allowed.
@@ -225,6 +231,8 @@ namespace DKFoundation
 		}
 
 		Container container;
+
+		template <typename V, typename L, typename C, typename A> friend class DKSet;
 	};
 }
 
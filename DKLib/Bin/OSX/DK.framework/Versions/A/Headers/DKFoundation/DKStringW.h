@@ -23,6 +23,10 @@
 namespace DKFoundation
 {
 	class DKData;
+	class DKStringW;
+	// string object holds pointer to heap buffer only, can be relocated by memcpy.
+	template <> struct DKTriviallyRelocatable<DKStringW> {enum {Result = true};};
+
 	class DKLIB_API DKStringW
 	{
 	public:
@@ -0,0 +1,111 @@
+//
+//  File: DKThreadLocal.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+
+#ifdef _WIN32
+// Fiber-local storage functions (kernel32), declared here to avoid <windows.h>
+extern "C"
+{
+	__declspec(dllimport) unsigned long __stdcall FlsAlloc(void (__stdcall *)(void*));
+	__declspec(dllimport) int __stdcall FlsFree(unsigned long);
+	__declspec(dllimport) void* __stdcall FlsGetValue(unsigned long);
+	__declspec(dllimport) int __stdcall FlsSetValue(unsigned long, void*);
+}
+#else
+#include <pthread.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// DKThreadLocal<T>
+// holds one instance of T per thread.
+// instance created with default constructor when Value() called first time
+// on each thread, and destroyed when that thread terminates.
+//
+// DKThreadLocal object should be live longer than threads using it.
+// (declare as global or static member)
+//
+// Note:
+//  main thread's instance will not be destroyed if process exits without
+//  terminating main thread. (return from main, exit)
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	template <typename T> class DKThreadLocal
+	{
+	public:
+		DKThreadLocal(void)
+		{
+#ifdef _WIN32
+			key = ::FlsAlloc(&DestroyValue);
+#else
+			pthread_key_create(&key, &DestroyValue);
+#endif
+		}
+		~DKThreadLocal(void)
+		{
+#ifdef _WIN32
+			::FlsFree(key);
+#else
+			pthread_key_delete(key);
+#endif
+		}
+		// get instance of current thread, create if not exists.
+		// returns NULL if instance cannot be allocated.
+		T* Value(void)
+		{
+			T* p = ValueNoCreate();
+			if (p == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(T));
+				if (mem == NULL)
+					return NULL;
+				p = new(mem) T();
+#ifdef _WIN32
+				::FlsSetValue(key, p);
+#else
+				pthread_setspecific(key, p);
+#endif
+			}
+			return p;
+		}
+		// get instance of current thread, NULL if not exists.
+		T* ValueNoCreate(void) const
+		{
+#ifdef _WIN32
+			return static_cast<T*>(::FlsGetValue(key));
+#else
+			return static_cast<T*>(pthread_getspecific(key));
+#endif
+		}
+	private:
+#ifdef _WIN32
+		static void __stdcall DestroyValue(void* p)
+#else
+		static void DestroyValue(void* p)
+#endif
+		{
+			if (p)
+			{
+				static_cast<T*>(p)->~T();
+				DKMemoryHeapFree(p);
+			}
+		}
+#ifdef _WIN32
+		unsigned long key;
+#else
+		pthread_key_t key;
+#endif
+
+		DKThreadLocal(const DKThreadLocal&);
+		DKThreadLocal& operator = (const DKThreadLocal&);
+	};
+}
@@ -0,0 +1,399 @@
+//
+//  File: DKTimerWheel.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKOperation.h"
+#include "DKFunction.h"
+#include "DKRunLoop.h"
+#include "DKTimer.h"
+#include "DKArray.h"
+#include "DKSpinLock.h"
+#include "DKCriticalSection.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKTimerWheel<VALUE>
+// hierarchical timing wheel, schedules values by system tick.
+//
+// time is quantized by resolution (default 1ms), values are stored in
+// slots of levels, each level has 64 slots and each slot of level N covers
+// 64^N units. Schedule(), Revoke() are O(1). Advance() fires all values
+// due in batch, values in upper levels are moved to lower levels when
+// lower level wraps around. (cascade)
+// values are never fired before scheduled tick, can be fired up to one
+// resolution later.
+//
+// Schedule() returns handle which can be used to revoke value. handle of
+// fired or revoked value becomes invalid, and will not be reused.
+//
+// DKRunLoopTimerWheel
+// schedules delayed operations on RunLoop with timer wheel.
+// instead of posting each operation to RunLoop (ordered array insertion),
+// only one operation is posted to RunLoop for nearest expiration, and it
+// performs all operations due in batch. useful to manage large number of
+// delayed operations. (animations, timeouts)
+// object should be destroyed on RunLoop thread or after RunLoop terminated.
+//
+// Note:
+//  DKTimerWheel is not thread-safe, DKRunLoopTimerWheel is thread-safe.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	template <typename VALUE> class DKTimerWheel
+	{
+	public:
+		typedef DKTimer::Tick Tick;
+		typedef unsigned long long Handle;
+		enum {SlotBits = 6, NumSlots = 1 << SlotBits, NumLevels = 6};
+		static const Handle invalidHandle = 0;
+
+		DKTimerWheel(double resolution = 0.001, Tick start = DKTimer::SystemTick())
+			: startTick(start)
+			, ticksPerUnit(Max<Tick>(static_cast<Tick>(resolution * static_cast<double>(DKTimer::SystemTickFrequency())), 1))
+			, current(0)
+			, count(0)
+			, freeList(invalidIndex)
+		{
+			for (int i = 0; i < NumLevels; ++i)
+				bitmap[i] = 0;
+			for (int i = 0; i < NumLevels * NumSlots; ++i)
+				slots[i] = invalidIndex;
+		}
+		~DKTimerWheel(void)
+		{
+		}
+
+		// schedule value to be fired at tick.
+		Handle Schedule(const VALUE& value, Tick fire)
+		{
+			// round up, should not be fired before tick.
+			Unit expires = fire > startTick ? (fire - startTick + ticksPerUnit - 1) / ticksPerUnit : 0;
+			if (expires <= current)
+				expires = current + 1;
+
+			Index index = AllocNode();
+			Node& node = nodes.Value(index);
+			node.value = value;
+			node.expires = expires;
+			Insert(index);
+			count++;
+			return (static_cast<Handle>(node.generation) << 32) | (index + 1);
+		}
+		// schedule value to be fired after delay. (in seconds)
+		Handle ScheduleAfter(const VALUE& value, double delay)
+		{
+			Tick now = DKTimer::SystemTick();
+			return Schedule(value, now + static_cast<Tick>(Max(delay, 0.0) * static_cast<double>(DKTimer::SystemTickFrequency())));
+		}
+		// remove value not fired yet. returns false if handle is invalid.
+		bool Revoke(Handle handle, VALUE* value = NULL)
+		{
+			Index index = static_cast<Index>(handle & 0xffffffff) - 1;
+			unsigned int generation = static_cast<unsigned int>(handle >> 32);
+			if (handle == invalidHandle || index >= nodes.Count())
+				return false;
+			Node& node = nodes.Value(index);
+			if (node.generation != generation || node.slot == invalidIndex)
+				return false;
+
+			Unlink(index);
+			if (value)
+				*value = static_cast<VALUE&&>(node.value);
+			FreeNode(index);
+			count--;
+			return true;
+		}
+		bool IsScheduled(Handle handle) const
+		{
+			Index index = static_cast<Index>(handle & 0xffffffff) - 1;
+			if (handle == invalidHandle || index >= nodes.Count())
+				return false;
+			const Node& node = nodes.Value(index);
+			return node.generation == static_cast<unsigned int>(handle >> 32) && node.slot != invalidIndex;
+		}
+		// fire all values due until tick, returns number of values fired.
+		// fn(VALUE&) can schedule or revoke other values.
+		template <typename Fn> size_t Advance(Tick now, Fn&& fn)
+		{
+			Unit target = now > startTick ? (now - startTick) / ticksPerUnit : 0;
+			size_t fired = 0;
+			while (current < target)
+			{
+				if (count == 0)
+				{
+					current = target;
+					break;
+				}
+				if (bitmap[0] == 0)
+				{
+					// nothing to fire until next cascade.
+					Unit next = NextUnit();
+					if (next > target)
+					{
+						current = target;
+						break;
+					}
+					current = next - 1;
+				}
+				current++;
+
+				Unit c = current;
+				for (int level = 1; level < NumLevels && (c & (NumSlots - 1)) == 0; ++level)
+				{
+					c = c >> SlotBits;
+					Cascade(level, static_cast<int>(c & (NumSlots - 1)));
+				}
+
+				int slot = static_cast<int>(current & (NumSlots - 1));
+				Index index;
+				while ((index = slots[slot]) != invalidIndex)
+				{
+					Node& node = nodes.Value(index);
+					Unlink(index);
+					VALUE value = static_cast<VALUE&&>(node.value);
+					FreeNode(index);
+					count--;
+					fired++;
+					fn(value);
+				}
+			}
+			return fired;
+		}
+		// tick when Advance() should be called next.
+		// returns false if there is no value scheduled.
+		bool NextTick(Tick* tick) const
+		{
+			if (count == 0)
+				return false;
+			if (tick)
+				*tick = startTick + NextUnit() * ticksPerUnit;
+			return true;
+		}
+		size_t Count(void) const
+		{
+			return count;
+		}
+		double Resolution(void) const
+		{
+			return static_cast<double>(ticksPerUnit) / static_cast<double>(DKTimer::SystemTickFrequency());
+		}
+
+	private:
+		typedef unsigned long long Unit;
+		typedef unsigned int Index;
+		enum : Index {invalidIndex = 0xffffffff};
+
+		struct Node
+		{
+			Node(void) : expires(0), next(invalidIndex), prev(invalidIndex), slot(invalidIndex), generation(1) {}
+			VALUE value;
+			Unit expires;
+			Index next;
+			Index prev;
+			Index slot;		// invalidIndex if not scheduled.
+			unsigned int generation;
+		};
+
+		// first unit of level 0 slot to be fired, or level N slot to be cascaded.
+		Unit NextUnit(void) const
+		{
+			Unit next = static_cast<Unit>(-1);
+			for (int level = 0; level < NumLevels; ++level)
+			{
+				if (bitmap[level] == 0)
+					continue;
+				int shift = level * SlotBits;
+				Unit block = current >> shift;
+				int base = static_cast<int>(block & (NumSlots - 1));
+				for (int i = 1; i <= NumSlots; ++i)
+				{
+					if (bitmap[level] & (1ULL << ((base + i) & (NumSlots - 1))))
+					{
+						next = Min(next, (block + i) << shift);
+						break;
+					}
+				}
+			}
+			return next;
+		}
+		Index AllocNode(void)
+		{
+			if (freeList != invalidIndex)
+			{
+				Index index = freeList;
+				freeList = nodes.Value(index).next;
+				return index;
+			}
+			return static_cast<Index>(nodes.Add(Node()));
+		}
+		void FreeNode(Index index)
+		{
+			Node& node = nodes.Value(index);
+			node.value = VALUE();
+			node.generation++;
+			node.next = freeList;
+			freeList = index;
+		}
+		void Insert(Index index)
+		{
+			Node& node = nodes.Value(index);
+			Unit delta = node.expires - current;
+			int level = 0;
+			while (level < NumLevels - 1 && delta >= (1ULL << ((level + 1) * SlotBits)))
+				level++;
+			// clamp to top level, will be cascaded again.
+			Unit expires = Min<Unit>(node.expires, current + (1ULL << (NumLevels * SlotBits)) - 1);
+			int slot = static_cast<int>((expires >> (level * SlotBits)) & (NumSlots - 1));
+
+			Index s = static_cast<Index>(level * NumSlots + slot);
+			node.slot = s;
+			node.prev = invalidIndex;
+			node.next = slots[s];
+			if (node.next != invalidIndex)
+				nodes.Value(node.next).prev = index;
+			slots[s] = index;
+			bitmap[level] |= (1ULL << slot);
+		}
+		void Unlink(Index index)
+		{
+			Node& node = nodes.Value(index);
+			Index s = node.slot;
+			if (node.prev != invalidIndex)
+				nodes.Value(node.prev).next = node.next;
+			else
+				slots[s] = node.next;
+			if (node.next != invalidIndex)
+				nodes.Value(node.next).prev = node.prev;
+			if (slots[s] == invalidIndex)
+				bitmap[s / NumSlots] &= ~(1ULL << (s % NumSlots));
+			node.slot = invalidIndex;
+			node.next = invalidIndex;
+			node.prev = invalidIndex;
+		}
+		// move values to lower levels.
+		void Cascade(int level, int slot)
+		{
+			Index s = static_cast<Index>(level * NumSlots + slot);
+			Index index = slots[s];
+			slots[s] = invalidIndex;
+			bitmap[level] &= ~(1ULL << slot);
+			while (index != invalidIndex)
+			{
+				Index next = nodes.Value(index).next;
+				Insert(index);
+				index = next;
+			}
+		}
+
+		const Tick startTick;
+		const Tick ticksPerUnit;
+		Unit current;
+		size_t count;
+		Index freeList;
+		DKArray<Node> nodes;
+		Index slots[NumLevels * NumSlots];
+		unsigned long long bitmap[NumLevels];
+
+		DKTimerWheel(const DKTimerWheel&);
+		DKTimerWheel& operator = (const DKTimerWheel&);
+	};
+
+	class DKRunLoopTimerWheel
+	{
+	public:
+		typedef DKTimerWheel<DKObject<DKOperation>> TimerWheel;
+		typedef TimerWheel::Handle Handle;
+
+		DKRunLoopTimerWheel(DKRunLoop* rl, double resolution = 0.001)
+			: runLoop(rl), wheel(resolution), pumpTick(0), pumpGeneration(0)
+		{
+			DKASSERT_DEBUG(runLoop != NULL);
+			pump = DKFunction(this, &DKRunLoopTimerWheel::Pump);
+		}
+		~DKRunLoopTimerWheel(void)
+		{
+			DKCriticalSection<DKSpinLock> guard(lock);
+			if (pumpResult)
+				pumpResult->Revoke();
+			pumpResult = NULL;
+		}
+		// perform operation on RunLoop after delay.
+		Handle PostOperation(const DKOperation* operation, double delay)
+		{
+			DKCriticalSection<DKSpinLock> guard(lock);
+			Handle handle = wheel.ScheduleAfter(const_cast<DKOperation*>(operation), delay);
+			UpdatePumpNL();
+			return handle;
+		}
+		// returns false if operation has been performed or revoked.
+		bool Revoke(Handle handle)
+		{
+			DKObject<DKOperation> op;
+			DKCriticalSection<DKSpinLock> guard(lock);
+			return wheel.Revoke(handle, &op);
+		}
+		size_t Count(void) const
+		{
+			DKCriticalSection<DKSpinLock> guard(lock);
+			return wheel.Count();
+		}
+		DKRunLoop* RunLoop(void) const
+		{
+			return runLoop;
+		}
+
+	private:
+		// post pump operation for nearest expiration.
+		void UpdatePumpNL(void)
+		{
+			TimerWheel::Tick next;
+			if (!wheel.NextTick(&next))
+				return;
+			if (pumpResult && pumpResult->IsPending())
+			{
+				if (pumpTick <= next)
+					return;
+				pumpResult->Revoke();
+			}
+			TimerWheel::Tick now = DKTimer::SystemTick();
+			double delay = next > now ? static_cast<double>(next - now) / static_cast<double>(DKTimer::SystemTickFrequency()) : 0.0;
+			pumpTick = next;
+			pumpResult = runLoop->PostOperation(pump->Invocation(++pumpGeneration), delay);
+		}
+		// generation identifies posted pump, new pump can be posted while
+		// older one is running, pumpResult should not be cleared by it.
+		void Pump(unsigned int generation)
+		{
+			DKArray<DKObject<DKOperation>> operations;
+			lock.Lock();
+			if (generation == pumpGeneration)
+				pumpResult = NULL;
+			wheel.Advance(DKTimer::SystemTick(), [&operations](DKObject<DKOperation>& op)
+			{
+				operations.Add(static_cast<DKObject<DKOperation>&&>(op));
+			});
+			UpdatePumpNL();
+			lock.Unlock();
+
+			for (DKObject<DKOperation>& op : operations)
+				op->Perform();
+		}
+
+		DKRunLoop* runLoop;
+		TimerWheel wheel;
+		TimerWheel::Tick pumpTick;
+		unsigned int pumpGeneration;
+		DKObject<DKFunctionSignature<void (unsigned int)>> pump;
+		DKObject<DKRunLoop::OperationResult> pumpResult;	// last posted pump
+		DKSpinLock lock;
+
+		DKRunLoopTimerWheel(const DKRunLoopTimerWheel&);
+		DKRunLoopTimerWheel& operator = (const DKRunLoopTimerWheel&);
+	};
+}
@@ -105,3 +105,4 @@
 #include "DKFramework/DKVoxelPolygonizer.h"
 #include "DKFramework/DKVoxelVolume.h"
 #include "DKFramework/DKWindow.h"
+#include "DKFramework/DKZipResourceLocator.h"
@@ -0,0 +1,71 @@
+//
+//  File: DKZipResourceLocator.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "../DKFoundation.h"
+#include "DKResourcePool.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKZipResourceLocator
+// DKResourcePool locator for zip resource bundle, using
+// DKZipMappedUnarchiver. (memory-mapped)
+//
+// DKResourcePool loads resources with OpenStream(), entries are read through
+// stream. call OpenData() directly to get stored entries without copying.
+//
+// prefix is directory in archive, files are located with (prefix + name).
+//
+// Example:
+//  DKObject<DKZipResourceLocator> locator = DKZipResourceLocator::Create(L"/data/bundle.zip", L"textures/");
+//  if (locator)
+//      pool.AddLocator(locator, L"bundle.zip/textures/");
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFramework
+{
+	class DKZipResourceLocator : public DKResourcePool::Locator
+	{
+	public:
+		static DKFoundation::DKObject<DKZipResourceLocator> Create(const DKFoundation::DKString& file, const DKFoundation::DKString& prefix = L"", size_t seekIndexInterval = 0)
+		{
+			DKFoundation::DKObject<DKFoundation::DKZipMappedUnarchiver> zip = DKFoundation::DKZipMappedUnarchiver::Create(file, seekIndexInterval);
+			if (zip)
+				return DKOBJECT_NEW DKZipResourceLocator(zip, prefix);
+			return NULL;
+		}
+
+		DKZipResourceLocator(DKFoundation::DKZipMappedUnarchiver* zip, const DKFoundation::DKString& prefix)
+			: archive(zip), prefix(prefix)
+		{
+			DKASSERT_DEBUG(archive != NULL);
+		}
+
+		// file in archive has no system path.
+		DKFoundation::DKString FindSystemPath(const DKFoundation::DKString&) const
+		{
+			return L"";
+		}
+		DKFoundation::DKObject<DKFoundation::DKStream> OpenStream(const DKFoundation::DKString& name) const
+		{
+			return archive->OpenFileStream(prefix + name);
+		}
+		// content of file, without copying if entry is stored.
+		// not used by DKResourcePool, call directly.
+		DKFoundation::DKObject<DKFoundation::DKData> OpenData(const DKFoundation::DKString& name) const
+		{
+			return archive->OpenFileData(prefix + name);
+		}
+
+		DKFoundation::DKZipMappedUnarchiver* Archive(void) const	{return const_cast<DKFoundation::DKZipMappedUnarchiver*>(archive.Ptr());}
+		const DKFoundation::DKString& Prefix(void) const				{return prefix;}
+
+	private:
+		DKFoundation::DKObject<DKFoundation::DKZipMappedUnarchiver> archive;
+		DKFoundation::DKString prefix;
+	};
+}
@@ -10,7 +10,12 @@
 
 // basic object templates and memory management.
 #include "DKFoundation/DKMemory.h"
+#include "DKFoundation/DKMemoryPool.h"
+#include "DKFoundation/DKMemoryStatistics.h"
+#include "DKFoundation/DKMemoryHugePage.h"
+#include "DKFoundation/DKArena.h"
 #include "DKFoundation/DKObject.h"
+#include "DKFoundation/DKSharedObject.h"
 #include "DKFoundation/DKAllocator.h"
 #include "DKFoundation/DKTypeInfo.h"
 #include "DKFoundation/DKTypeList.h"
@@ -24,6 +29,7 @@
 
 // data collections
 #include "DKFoundation/DKArray.h"
+#include "DKFoundation/DKSmallArray.h"
 #include "DKFoundation/DKCircularQueue.h"
 #include "DKFoundation/DKList.h"
 #include "DKFoundation/DKMap.h"
@@ -33,10 +39,14 @@
 #include "DKFoundation/DKStaticArray.h"
 #include "DKFoundation/DKTuple.h"
 #include "DKFoundation/DKQueue.h"
+#include "DKFoundation/DKConcurrentQueue.h"
 
 // hash, UUID
 #include "DKFoundation/DKHash.h"
 #include "DKFoundation/DKUUID.h"
+#include "DKFoundation/DKHashTable.h"
+#include "DKFoundation/DKHashMap.h"
+#include "DKFoundation/DKHashSet.h"
 
 // thread, mutex, synchronization objects.
 #include "DKFoundation/DKAtomicNumber32.h"
@@ -49,7 +59,10 @@
 #include "DKFoundation/DKSharedLock.h"
 #include "DKFoundation/DKSpinLock.h"
 #include "DKFoundation/DKThread.h"
+#include "DKFoundation/DKThreadLocal.h"
 #include "DKFoundation/DKCondition.h"
+#include "DKFoundation/DKAdaptiveLock.h"
+#include "DKFoundation/DKShardedFence.h"
 
 // stream, file, buffer, directory (file-system)
 #include "DKFoundation/DKData.h"
@@ -57,11 +70,18 @@
 #include "DKFoundation/DKDataStream.h"
 #include "DKFoundation/DKBuffer.h"
 #include "DKFoundation/DKBufferStream.h"
+#include "DKFoundation/DKDataSlice.h"
+#include "DKFoundation/DKDataChain.h"
 #include "DKFoundation/DKDirectory.h"
 #include "DKFoundation/DKFile.h"
 #include "DKFoundation/DKFileMap.h"
 #include "DKFoundation/DKZipArchiver.h"
 #include "DKFoundation/DKZipUnarchiver.h"
+#include "DKFoundation/DKDeflater.h"
+#include "DKFoundation/DKInflater.h"
+#include "DKFoundation/DKZipMappedUnarchiver.h"
+#include "DKFoundation/DKZipParallelArchiver.h"
+#include "DKFoundation/DKCompressor.h"
 
 // XML
 #include "DKFoundation/DKXMLParser.h"
@@ -82,13 +102,22 @@
 // run-loop, operation queue, message-handler
 #include "DKFoundation/DKMessageQueue.h"
 #include "DKFoundation/DKOperationQueue.h"
+#include "DKFoundation/DKParallel.h"
+#include "DKFoundation/DKWorkStealingQueue.h"
+#include "DKFoundation/DKTaskGraph.h"
+#include "DKFoundation/DKFuture.h"
+#include "DKFoundation/DKAsyncIO.h"
+#include "DKFoundation/DKCoroutine.h"
 #include "DKFoundation/DKRunLoop.h"
 #include "DKFoundation/DKRunLoopTimer.h"
+#include "DKFoundation/DKTimerWheel.h"
 
 // etc
 #include "DKFoundation/DKEndianness.h"
 #include "DKFoundation/DKError.h"
 #include "DKFoundation/DKLog.h"
+#include "DKFoundation/DKBufferedLog.h"
+#include "DKFoundation/DKTrace.h"
 #include "DKFoundation/DKUtils.h"
 
 #endif //ifdef _MSC_VER
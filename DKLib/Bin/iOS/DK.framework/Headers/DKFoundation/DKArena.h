@@ -0,0 +1,368 @@
+//
+//  File: DKArena.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <atomic>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKThreadLocal.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKArena
+// a linear (bump-pointer) memory arena for temporary objects.
+//
+// Memory is allocated by moving pointer forward, individual deallocation is
+// not performed (except for the last allocated block). All memory can be
+// released at once by Reset() or Rewind(), in O(1) time.
+// Memory blocks are retained after reset and reused, so frame-scoped
+// temporaries can be built without heap calls after first frame.
+//
+// DKArena::Scope binds arena to current thread and rewinds arena when it is
+// destroyed. Scopes can be nested, the innermost scope is used by
+// DKMemoryArenaAllocator.
+//
+// DKMemoryArenaAllocator is allocator type for template classes
+// (DKArray, DKQueue, DKMap, DKAVLTree, ...), it allocates memory from arena
+// of current thread's innermost scope. If there is no arena bound to
+// current thread, heap memory is used instead.
+//
+// Example:
+//  typedef DKArray<DKVector3, DKDummyLock, DKMemoryArenaAllocator> TempArray;
+//  DKArena frameArena;
+//  ...
+//  {
+//      DKArena::Scope scope(frameArena);
+//      TempArray vertices;
+//      vertices.Add(...);		// no heap allocation.
+//  }   // vertices destroyed, arena rewound.
+//
+// Note:
+//  DKArena is not thread-safe, use one arena per thread.
+//  containers using DKMemoryArenaAllocator must be destroyed before
+//  the scope ends.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKArena
+	{
+		struct Block;
+		struct ThreadStack;
+		// header of each allocation, 16 bytes for alignment.
+		struct Header
+		{
+			DKArena* arena;		// NULL for heap allocated memory.
+			size_t size;
+		};
+		enum {HeaderSize = 16,};
+	public:
+		enum {DefaultBlockSize = 0x10000,};	// 64KB
+
+		// position of arena, can be used for rewinding.
+		struct Marker
+		{
+			Block* block;
+			size_t offset;
+		};
+
+		// bind arena to current thread, rewind when destroyed.
+		class Scope
+		{
+		public:
+			Scope(DKArena& a) : arena(a), marker(a.Mark()), stack(Stack()), prev(NULL)
+			{
+				// arena is not bound if thread stack cannot be allocated,
+				// allocator uses heap memory instead.
+				if (stack)
+				{
+					prev = stack->top;
+					stack->top = &arena;
+				}
+			}
+			~Scope(void)
+			{
+				if (stack)
+					stack->top = prev;
+				arena.Rewind(marker);
+			}
+		private:
+			Scope(const Scope&);
+			Scope& operator = (const Scope&);
+			DKArena& arena;
+			Marker marker;
+			ThreadStack* stack;
+			DKArena* prev;
+		};
+
+		DKArena(size_t size = DefaultBlockSize)
+			: blockSize(size), firstBlock(NULL), currentBlock(NULL), lastAlloc(NULL)
+		{
+		}
+		~DKArena(void)
+		{
+			Purge();
+		}
+
+		void* Alloc(size_t s)
+		{
+			size_t required = HeaderSize + Aligned(s);
+			if (currentBlock == NULL || currentBlock->capacity - currentBlock->offset < required)
+			{
+				if (!NextBlock(required))
+					return NULL;
+			}
+			Header* header = reinterpret_cast<Header*>(currentBlock->Data() + currentBlock->offset);
+			header->arena = this;
+			header->size = s;
+			currentBlock->offset += required;
+			lastAlloc = header;
+			return DataOf(header);
+		}
+		void* Realloc(void* p, size_t s)
+		{
+			if (p == NULL)
+				return Alloc(s);
+
+			Header* header = HeaderOf(p);
+			DKASSERT_DEBUG(header->arena == this);
+			if (s <= header->size)
+			{
+				header->size = s;
+				return p;
+			}
+			if (header == lastAlloc)	// last one, try to extend in place.
+			{
+				size_t begin = reinterpret_cast<unsigned char*>(header) - currentBlock->Data();
+				size_t required = HeaderSize + Aligned(s);
+				if (currentBlock->capacity - begin >= required)
+				{
+					currentBlock->offset = begin + required;
+					header->size = s;
+					return p;
+				}
+			}
+			void* p2 = Alloc(s);
+			if (p2)
+				memcpy(p2, p, header->size);
+			return p2;
+		}
+		// only last allocation can be released.
+		void Free(void* p)
+		{
+			if (p == NULL)
+				return;
+			Header* header = HeaderOf(p);
+			DKASSERT_DEBUG(header->arena == this);
+			if (header == lastAlloc)
+			{
+				currentBlock->offset = reinterpret_cast<unsigned char*>(header) - currentBlock->Data();
+				lastAlloc = NULL;
+			}
+		}
+		Marker Mark(void) const
+		{
+			Marker m = {currentBlock, currentBlock ? currentBlock->offset : 0};
+			return m;
+		}
+		// release all memory allocated after marker.
+		void Rewind(const Marker& m)
+		{
+			currentBlock = m.block;
+			if (currentBlock)
+				currentBlock->offset = m.offset;
+			else if (firstBlock)
+			{
+				currentBlock = firstBlock;
+				currentBlock->offset = 0;
+			}
+			lastAlloc = NULL;
+		}
+		// release all memory, memory blocks are retained for reuse.
+		void Reset(void)
+		{
+			currentBlock = firstBlock;
+			if (currentBlock)
+				currentBlock->offset = 0;
+			lastAlloc = NULL;
+		}
+		// release all memory and memory blocks.
+		void Purge(void)
+		{
+			Block* block = firstBlock;
+			while (block)
+			{
+				Block* next = block->next;
+				DKMemoryHeapFree(block);
+				block = next;
+			}
+			firstBlock = NULL;
+			currentBlock = NULL;
+			lastAlloc = NULL;
+		}
+		// total bytes of memory blocks.
+		size_t Capacity(void) const
+		{
+			size_t total = 0;
+			for (const Block* block = firstBlock; block; block = block->next)
+				total += block->capacity;
+			return total;
+		}
+
+		// innermost arena bound to current thread, NULL if not exists.
+		static DKArena* Current(void)
+		{
+			ThreadStackLocal* local = StackLocal();
+			ThreadStack* stack = local ? local->ValueNoCreate() : NULL;
+			return stack ? stack->top : NULL;
+		}
+
+		// used by DKMemoryArenaAllocator.
+		// allocate from current thread's arena, or heap if no arena.
+		static void* AllocCurrent(size_t s)
+		{
+			DKArena* arena = Current();
+			if (arena)
+				return arena->Alloc(s);
+			Header* header = static_cast<Header*>(DKMemoryHeapAlloc(HeaderSize + s));
+			if (header == NULL)
+				return NULL;
+			header->arena = NULL;
+			header->size = s;
+			return DataOf(header);
+		}
+		static void* ReallocOwner(void* p, size_t s)
+		{
+			if (p == NULL)
+				return AllocCurrent(s);
+			Header* header = HeaderOf(p);
+			if (header->arena)
+				return header->arena->Realloc(p, s);
+			header = static_cast<Header*>(DKMemoryHeapRealloc(header, HeaderSize + s));
+			if (header == NULL)
+				return NULL;
+			header->size = s;
+			return DataOf(header);
+		}
+		static void FreeOwner(void* p)
+		{
+			if (p == NULL)
+				return;
+			Header* header = HeaderOf(p);
+			if (header->arena)
+				header->arena->Free(p);
+			else
+				DKMemoryHeapFree(header);
+		}
+
+	private:
+		struct Block
+		{
+			Block* next;
+			size_t capacity;
+			size_t offset;
+			size_t reserved;	// for alignment
+			unsigned char* Data(void) { return reinterpret_cast<unsigned char*>(this + 1); }
+		};
+		struct ThreadStack
+		{
+			DKArena* top;
+			ThreadStack(void) : top(NULL) {}
+		};
+		typedef DKThreadLocal<ThreadStack> ThreadStackLocal;
+		// thread-local storage is created on first use and never destroyed,
+		// arena can be used while other global objects being constructed or
+		// destroyed.
+		template <int N> struct ThreadStackHolder
+		{
+			static std::atomic<ThreadStackLocal*> local;
+		};
+		static ThreadStackLocal* StackLocal(void)
+		{
+			ThreadStackLocal* local = ThreadStackHolder<0>::local.load(std::memory_order_acquire);
+			if (local == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(ThreadStackLocal));
+				if (mem == NULL)
+					return NULL;
+				ThreadStackLocal* newLocal = new(mem) ThreadStackLocal();
+				if (ThreadStackHolder<0>::local.compare_exchange_strong(local, newLocal, std::memory_order_acq_rel))
+					local = newLocal;
+				else
+				{
+					newLocal->~ThreadStackLocal();
+					DKMemoryHeapFree(newLocal);
+				}
+			}
+			return local;
+		}
+		// current thread's stack, NULL if cannot be allocated.
+		static ThreadStack* Stack(void)
+		{
+			ThreadStackLocal* local = StackLocal();
+			return local ? local->Value() : NULL;
+		}
+		static Header* HeaderOf(void* p)
+		{
+			return reinterpret_cast<Header*>(static_cast<unsigned char*>(p) - HeaderSize);
+		}
+		static void* DataOf(Header* h)
+		{
+			return reinterpret_cast<unsigned char*>(h) + HeaderSize;
+		}
+		static size_t Aligned(size_t s)
+		{
+			return (s + 15) & ~size_t(15);
+		}
+		// move to next block which has enough space, allocate if not exists.
+		// blocks after current block are free, new block is linked after current.
+		bool NextBlock(size_t required)
+		{
+			Block* block = currentBlock ? currentBlock->next : firstBlock;
+			while (block && block->capacity < required)
+				block = block->next;
+			if (block == NULL)
+			{
+				size_t capacity = Max(blockSize, required);
+				block = static_cast<Block*>(DKMemoryHeapAlloc(sizeof(Block) + capacity));
+				if (block == NULL)
+					return false;
+				block->capacity = capacity;
+				if (currentBlock)
+				{
+					block->next = currentBlock->next;
+					currentBlock->next = block;
+				}
+				else
+				{
+					block->next = firstBlock;
+					firstBlock = block;
+				}
+			}
+			block->offset = 0;
+			currentBlock = block;
+			return true;
+		}
+
+		size_t blockSize;
+		Block* firstBlock;
+		Block* currentBlock;
+		Header* lastAlloc;
+
+		DKArena(const DKArena&);
+		DKArena& operator = (const DKArena&);
+	};
+	template <int N> std::atomic<DKArena::ThreadStackLocal*> DKArena::ThreadStackHolder<N>::local(NULL);
+
+	// allocator type for template classes, uses arena of current thread.
+	struct DKMemoryArenaAllocator
+	{
+		enum {location = DKMemoryLocationCustom};
+		static void* Alloc(size_t s)			{return DKArena::AllocCurrent(s);}
+		static void* Realloc(void* p, size_t s)	{return DKArena::ReallocOwner(p, s);}
+		static void Free(void* p)				{DKArena::FreeOwner(p);}
+	};
+}
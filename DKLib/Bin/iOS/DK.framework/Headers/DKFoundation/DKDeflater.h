@@ -0,0 +1,681 @@
+//
+//  File: DKDeflater.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <string.h>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKStaticArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKDeflater
+// raw deflate (RFC 1951) encoder, compresses memory to memory.
+//
+// Deflate() compresses input into output buffer, returns compressed size.
+// output buffer should be at least Bound(inputLength) bytes.
+// level is 0 to 9, (0: stored, 1: fastest, 9: best compression)
+//
+// LZ77 with hash chains (lazy matching for level 4 and above), each block
+// is encoded as dynamic, fixed or stored block which is smallest.
+// every call is independent, can be used by multiple threads concurrently.
+//
+// Example:
+//  size_t bound = DKDeflater::Bound(length);
+//  void* compressed = DKMemoryHeapAlloc(bound);
+//  size_t size = DKDeflater::Deflate(data, length, compressed, bound, 6);
+//
+// Note:
+//  output can be decoded with DKInflater, or any zlib (raw deflate) decoder.
+//  allocates about 400KB of working memory for each call. (level 1~9)
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKDeflater
+	{
+	public:
+		enum
+		{
+			DefaultLevel = 6,
+		};
+
+		// maximum compressed size of input length.
+		static size_t Bound(size_t length)
+		{
+			return length + (length / MaxStoredLength + length / MaxSymbols + 2) * 5 + 16;
+		}
+
+		// returns compressed size, 0 if output buffer is too small.
+		static size_t Deflate(const void* input, size_t length, void* output, size_t outputSize, int level = DefaultLevel)
+		{
+			// encoder has hash tables, too large for stack.
+			void* mem = DKMemoryHeapAlloc(sizeof(Encoder));
+			if (mem == NULL)
+				return 0;
+			Encoder* enc = new(mem) Encoder(reinterpret_cast<const unsigned char*>(input), length, reinterpret_cast<unsigned char*>(output), outputSize, Clamp(level, 0, 9));
+			size_t result = enc->Encode();
+			enc->~Encoder();
+			DKMemoryHeapFree(enc);
+			return result;
+		}
+
+	private:
+		enum
+		{
+			WindowSize = 0x8000,
+			WindowMask = WindowSize - 1,
+			HashBits = 15,
+			HashSize = 1 << HashBits,
+			MinMatch = 3,
+			MaxMatch = 258,
+			MaxSymbols = 0x4000,		// symbols per block
+			MaxStoredLength = 0xffff,
+			LitLenCodes = 286,
+			FixedLitLenCodes = 288,		// 286, 287 are not used, but part of fixed code.
+			DistCodes = 30,
+			CodeLenCodes = 19,
+			MaxBits = 15,
+			MaxCodeLenBits = 7,
+		};
+
+		struct Huffman
+		{
+			unsigned short code[FixedLitLenCodes];		// bit-reversed
+			unsigned char length[FixedLitLenCodes];
+		};
+
+		class Encoder
+		{
+		public:
+			Encoder(const unsigned char* in, size_t len, unsigned char* out, size_t outSize, int lv)
+				: input(in), inputLength(len), output(out), outputEnd(out + outSize), outputPos(out)
+				, bitBuffer(0), bitCount(0), overflow(false), level(lv), numSymbols(0), blockStart(0)
+			{
+				static const unsigned short chains[10] = {0, 4, 8, 16, 32, 64, 128, 256, 1024, 4096};
+				static const unsigned short nices[10] = {0, 8, 16, 32, 32, 64, 128, 128, 258, 258};
+				maxChain = chains[level];
+				niceLength = nices[level];
+				lazy = level >= 4;
+			}
+			size_t Encode(void)
+			{
+				if (level == 0 || inputLength < MinMatch)
+					WriteStored(0, inputLength, true);
+				else
+				{
+					for (size_t i = 0; i < HashSize; ++i)
+						head[i] = 0;
+					Compress();
+				}
+				FlushBits();
+				if (overflow)
+					return 0;
+				return outputPos - output;
+			}
+
+		private:
+			// bit writer
+			void PutBits(unsigned int value, unsigned int n)
+			{
+				bitBuffer |= (uint64_t)value << bitCount;
+				bitCount += n;
+				if (bitCount >= 32)
+				{
+					if (outputEnd - outputPos >= 4)
+					{
+						outputPos[0] = (unsigned char)(bitBuffer);
+						outputPos[1] = (unsigned char)(bitBuffer >> 8);
+						outputPos[2] = (unsigned char)(bitBuffer >> 16);
+						outputPos[3] = (unsigned char)(bitBuffer >> 24);
+						outputPos += 4;
+					}
+					else
+						overflow = true;
+					bitBuffer >>= 32;
+					bitCount -= 32;
+				}
+			}
+			void FlushBits(void)
+			{
+				while (bitCount > 0)
+				{
+					if (outputPos < outputEnd)
+						*outputPos++ = (unsigned char)bitBuffer;
+					else
+						overflow = true;
+					bitBuffer >>= 8;
+					bitCount = bitCount > 8 ? bitCount - 8 : 0;
+				}
+				bitBuffer = 0;
+			}
+
+			static unsigned int HighestBit(unsigned int v)
+			{
+				unsigned int n = 0;
+				while (v >>= 1)
+					n++;
+				return n;
+			}
+			static void LengthCode(unsigned int len, unsigned int& symbol, unsigned int& extraBits, unsigned int& extra)
+			{
+				unsigned int l = len - MinMatch;
+				if (l < 8)
+				{
+					symbol = 257 + l;
+					extraBits = 0;
+					extra = 0;
+				}
+				else if (l == 255)
+				{
+					symbol = 285;
+					extraBits = 0;
+					extra = 0;
+				}
+				else
+				{
+					unsigned int nb = HighestBit(l);
+					symbol = 257 + 4 * (nb - 1) + ((l >> (nb - 2)) & 3);
+					extraBits = nb - 2;
+					extra = l & ((1 << extraBits) - 1);
+				}
+			}
+			static void DistanceCode(unsigned int dist, unsigned int& symbol, unsigned int& extraBits, unsigned int& extra)
+			{
+				unsigned int d = dist - 1;
+				if (d < 4)
+				{
+					symbol = d;
+					extraBits = 0;
+					extra = 0;
+				}
+				else
+				{
+					unsigned int nb = HighestBit(d);
+					symbol = 2 * nb + ((d >> (nb - 1)) & 1);
+					extraBits = nb - 1;
+					extra = d & ((1 << extraBits) - 1);
+				}
+			}
+
+			// LZ77
+			unsigned int Hash(size_t pos) const
+			{
+				return ((input[pos] << 10) ^ (input[pos + 1] << 5) ^ input[pos + 2]) & (HashSize - 1);
+			}
+			// find longest match at pos, and insert pos into hash chain.
+			unsigned int FindAndInsert(size_t pos, unsigned int& distance)
+			{
+				unsigned int h = Hash(pos);
+				size_t candidate = head[h];		// position + 1
+				prev[pos & WindowMask] = candidate;
+				head[h] = pos + 1;
+
+				size_t limit = pos > WindowSize ? pos - WindowSize : 0;
+				unsigned int maxLength = (unsigned int)Min<size_t>(MaxMatch, inputLength - pos);
+				unsigned int best = MinMatch - 1;
+				const unsigned char* p = input + pos;
+				for (unsigned int chain = maxChain; candidate > 0 && chain > 0; --chain)
+				{
+					size_t c = candidate - 1;
+					if (c < limit)
+						break;
+					const unsigned char* q = input + c;
+					if (q[best] == p[best] && q[0] == p[0] && q[1] == p[1])
+					{
+						unsigned int len = 2;
+						while (len < maxLength && q[len] == p[len])
+							len++;
+						if (len > best)
+						{
+							best = len;
+							distance = (unsigned int)(pos - c);
+							if (len >= niceLength || len == maxLength)
+								break;
+						}
+					}
+					candidate = prev[c & WindowMask];
+				}
+				return best >= MinMatch ? best : 0;
+			}
+			void Insert(size_t pos)
+			{
+				unsigned int h = Hash(pos);
+				prev[pos & WindowMask] = head[h];
+				head[h] = pos + 1;
+			}
+			void Compress(void)
+			{
+				size_t pos = 0;
+				size_t inserted = 0;	// positions before this are in hash chains.
+				const size_t hashEnd = inputLength - MinMatch + 1;
+				while (pos < inputLength)
+				{
+					unsigned int length = 0;
+					unsigned int distance = 0;
+					if (pos < hashEnd)
+					{
+						length = FindAndInsert(pos, distance);
+						inserted = pos + 1;
+						// lazy evaluation: prefer longer match at next position.
+						while (lazy && length > 0 && length < niceLength && pos + 1 < hashEnd && numSymbols + 2 < MaxSymbols)
+						{
+							unsigned int dist2 = 0;
+							unsigned int len2 = FindAndInsert(pos + 1, dist2);
+							inserted = pos + 2;
+							if (len2 <= length)
+								break;
+							AddLiteral(pos);
+							pos++;
+							length = len2;
+							distance = dist2;
+						}
+					}
+					if (length > 0)
+					{
+						AddMatch(length, distance);
+						size_t end = Min(pos + length, hashEnd);
+						for (; inserted < end; ++inserted)
+							Insert(inserted);
+						pos += length;
+					}
+					else
+					{
+						AddLiteral(pos);
+						pos++;
+					}
+					if (numSymbols >= MaxSymbols)
+						FlushBlock(pos, false);
+				}
+				FlushBlock(pos, true);
+			}
+			void AddLiteral(size_t pos)
+			{
+				symbols[numSymbols].value = input[pos];
+				symbols[numSymbols].distance = 0;
+				numSymbols++;
+			}
+			void AddMatch(unsigned int length, unsigned int distance)
+			{
+				symbols[numSymbols].value = (unsigned short)length;
+				symbols[numSymbols].distance = (unsigned short)(distance - 1);
+				symbols[numSymbols].distance |= 0x8000;
+				numSymbols++;
+			}
+
+			// Huffman code lengths limited to maxBits. (frequencies should have at least one nonzero)
+			static void BuildLengths(const unsigned int* freq, int n, int maxBits, unsigned char* lengths)
+			{
+				struct Node
+				{
+					unsigned int freq;
+					unsigned short symbol;
+				};
+				Node leaves[LitLenCodes];
+				int numLeaves = 0;
+				for (int i = 0; i < n; ++i)
+				{
+					lengths[i] = 0;
+					if (freq[i])
+					{
+						leaves[numLeaves].freq = freq[i];
+						leaves[numLeaves].symbol = (unsigned short)i;
+						numLeaves++;
+					}
+				}
+				if (numLeaves == 0)
+					return;
+				if (numLeaves == 1)
+				{
+					lengths[leaves[0].symbol] = 1;
+					return;
+				}
+				DKStaticArray<Node>(leaves, numLeaves).Sort([](const Node& a, const Node& b)
+				{
+					return a.freq < b.freq || (a.freq == b.freq && a.symbol < b.symbol);
+				});
+
+				// two-queue Huffman construction, internal nodes are increasing.
+				unsigned int weight[LitLenCodes * 2];
+				int parent[LitLenCodes * 2];
+				for (int i = 0; i < numLeaves; ++i)
+					weight[i] = leaves[i].freq;
+				int leaf = 0;
+				int internal = numLeaves;
+				int next = numLeaves;
+				for (int k = 0; k < numLeaves - 1; ++k)
+				{
+					int pick[2];
+					for (int j = 0; j < 2; ++j)
+					{
+						if (leaf < numLeaves && (internal >= next || weight[leaf] <= weight[internal]))
+							pick[j] = leaf++;
+						else
+							pick[j] = internal++;
+					}
+					weight[next] = weight[pick[0]] + weight[pick[1]];
+					parent[pick[0]] = next;
+					parent[pick[1]] = next;
+					next++;
+				}
+				// depth of each leaf. (root is next-1)
+				int depth[LitLenCodes * 2];
+				depth[next - 1] = 0;
+				for (int i = next - 2; i >= 0; --i)
+					depth[i] = depth[parent[i]] + 1;
+
+				// limit length, adjust counts to satisfy Kraft inequality.
+				int count[MaxBits + 2] = {0};
+				for (int i = 0; i < numLeaves; ++i)
+					count[Min(depth[i], MaxBits + 1)]++;
+				for (int i = maxBits + 1; i <= MaxBits + 1; ++i)
+				{
+					count[maxBits] += count[i];
+					count[i] = 0;
+				}
+				uint32_t total = 0;
+				for (int i = maxBits; i > 0; --i)
+					total += (uint32_t)count[i] << (maxBits - i);
+				while (total > (1U << maxBits))
+				{
+					count[maxBits]--;
+					for (int i = maxBits - 1; i > 0; --i)
+					{
+						if (count[i])
+						{
+							count[i]--;
+							count[i + 1] += 2;
+							break;
+						}
+					}
+					total--;
+				}
+				// least frequent symbols get longest codes.
+				int index = 0;
+				for (int len = maxBits; len > 0; --len)
+				{
+					for (int i = 0; i < count[len]; ++i)
+						lengths[leaves[index++].symbol] = (unsigned char)len;
+				}
+			}
+			static void BuildCodes(const unsigned char* lengths, int n, unsigned short* codes)
+			{
+				unsigned int count[MaxBits + 1] = {0};
+				unsigned int next[MaxBits + 1];
+				for (int i = 0; i < n; ++i)
+					count[lengths[i]]++;
+				count[0] = 0;
+				unsigned int code = 0;
+				for (int len = 1; len <= MaxBits; ++len)
+				{
+					code = (code + count[len - 1]) << 1;
+					next[len] = code;
+				}
+				for (int i = 0; i < n; ++i)
+				{
+					unsigned int len = lengths[i];
+					if (len)
+					{
+						unsigned int c = next[len]++;
+						unsigned int rev = 0;
+						for (unsigned int b = 0; b < len; ++b)
+							rev |= ((c >> b) & 1) << (len - 1 - b);
+						codes[i] = (unsigned short)rev;
+					}
+				}
+			}
+
+			// run-length encoding of code lengths. (symbols 0~18)
+			struct CodeLengthSymbol
+			{
+				unsigned char symbol;
+				unsigned char extra;
+			};
+			static int EncodeCodeLengths(const unsigned char* lengths, int n, CodeLengthSymbol* out)
+			{
+				int count = 0;
+				for (int i = 0; i < n; )
+				{
+					unsigned char len = lengths[i];
+					int run = 1;
+					while (i + run < n && lengths[i + run] == len)
+						run++;
+					i += run;
+					if (len == 0)
+					{
+						while (run >= 11)
+						{
+							int r = Min(run, 138);
+							out[count].symbol = 18;
+							out[count++].extra = (unsigned char)(r - 11);
+							run -= r;
+						}
+						if (run >= 3)
+						{
+							out[count].symbol = 17;
+							out[count++].extra = (unsigned char)(run - 3);
+							run = 0;
+						}
+					}
+					else
+					{
+						out[count].symbol = len;
+						out[count++].extra = 0;
+						run--;
+						while (run >= 3)
+						{
+							int r = Min(run, 6);
+							out[count].symbol = 16;
+							out[count++].extra = (unsigned char)(r - 3);
+							run -= r;
+						}
+					}
+					while (run-- > 0)
+					{
+						out[count].symbol = len;
+						out[count++].extra = 0;
+					}
+				}
+				return count;
+			}
+
+			void WriteStored(size_t begin, size_t end, bool last)
+			{
+				do
+				{
+					size_t len = Min<size_t>(end - begin, MaxStoredLength);
+					bool final = last && begin + len == end;
+					PutBits(final ? 1 : 0, 3);
+					// align to byte
+					FlushBits();
+					bitCount = 0;
+					if (outputEnd - outputPos < (ptrdiff_t)(len + 4))
+					{
+						overflow = true;
+						return;
+					}
+					outputPos[0] = (unsigned char)(len);
+					outputPos[1] = (unsigned char)(len >> 8);
+					outputPos[2] = (unsigned char)(~len);
+					outputPos[3] = (unsigned char)(~len >> 8);
+					memcpy(outputPos + 4, input + begin, len);
+					outputPos += len + 4;
+					begin += len;
+				} while (begin < end);
+			}
+			void WriteSymbols(const Huffman& litLen, const Huffman& dist)
+			{
+				for (size_t i = 0; i < numSymbols; ++i)
+				{
+					const Symbol& s = symbols[i];
+					if (s.distance & 0x8000)
+					{
+						unsigned int sym, extraBits, extra;
+						LengthCode(s.value, sym, extraBits, extra);
+						PutBits(litLen.code[sym], litLen.length[sym]);
+						if (extraBits)
+							PutBits(extra, extraBits);
+						DistanceCode((s.distance & 0x7fff) + 1, sym, extraBits, extra);
+						PutBits(dist.code[sym], dist.length[sym]);
+						if (extraBits)
+							PutBits(extra, extraBits);
+					}
+					else
+						PutBits(litLen.code[s.value], litLen.length[s.value]);
+				}
+				PutBits(litLen.code[256], litLen.length[256]);
+			}
+			void FlushBlock(size_t blockEnd, bool last)
+			{
+				static const unsigned char codeLengthOrder[CodeLenCodes] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+				unsigned int litFreq[LitLenCodes] = {0};
+				unsigned int distFreq[DistCodes] = {0};
+				uint64_t extraBits = 0;
+				for (size_t i = 0; i < numSymbols; ++i)
+				{
+					const Symbol& s = symbols[i];
+					if (s.distance & 0x8000)
+					{
+						unsigned int sym, eb, extra;
+						LengthCode(s.value, sym, eb, extra);
+						litFreq[sym]++;
+						extraBits += eb;
+						DistanceCode((s.distance & 0x7fff) + 1, sym, eb, extra);
+						distFreq[sym]++;
+						extraBits += eb;
+					}
+					else
+						litFreq[s.value]++;
+				}
+				litFreq[256] = 1;
+
+				// dynamic codes
+				Huffman litLen, dist;
+				BuildLengths(litFreq, LitLenCodes, MaxBits, litLen.length);
+				bool hasDistance = false;
+				for (int i = 0; i < DistCodes; ++i)
+					hasDistance = hasDistance || distFreq[i] > 0;
+				if (hasDistance)
+					BuildLengths(distFreq, DistCodes, MaxBits, dist.length);
+				else
+				{
+					memset(dist.length, 0, DistCodes);
+					dist.length[0] = 1;
+				}
+				int numLitLen = LitLenCodes;
+				while (numLitLen > 257 && litLen.length[numLitLen - 1] == 0)
+					numLitLen--;
+				int numDist = DistCodes;
+				while (numDist > 1 && dist.length[numDist - 1] == 0)
+					numDist--;
+
+				unsigned char allLengths[LitLenCodes + DistCodes];
+				memcpy(allLengths, litLen.length, numLitLen);
+				memcpy(allLengths + numLitLen, dist.length, numDist);
+				CodeLengthSymbol clSymbols[LitLenCodes + DistCodes];
+				int numCL = EncodeCodeLengths(allLengths, numLitLen + numDist, clSymbols);
+				unsigned int clFreq[CodeLenCodes] = {0};
+				for (int i = 0; i < numCL; ++i)
+					clFreq[clSymbols[i].symbol]++;
+				Huffman codeLen;
+				BuildLengths(clFreq, CodeLenCodes, MaxCodeLenBits, codeLen.length);
+				int numCodeLen = CodeLenCodes;
+				while (numCodeLen > 4 && codeLen.length[codeLengthOrder[numCodeLen - 1]] == 0)
+					numCodeLen--;
+
+				uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * numCodeLen + extraBits;
+				for (int i = 0; i < numCL; ++i)
+				{
+					unsigned char s = clSymbols[i].symbol;
+					dynamicBits += codeLen.length[s] + (s == 16 ? 2 : (s == 17 ? 3 : (s == 18 ? 7 : 0)));
+				}
+				uint64_t fixedBits = 3 + extraBits;
+				for (int i = 0; i < LitLenCodes; ++i)
+				{
+					dynamicBits += (uint64_t)litFreq[i] * litLen.length[i];
+					fixedBits += (uint64_t)litFreq[i] * (i < 144 ? 8 : (i < 256 ? 9 : (i < 280 ? 7 : 8)));
+				}
+				for (int i = 0; i < DistCodes; ++i)
+				{
+					dynamicBits += (uint64_t)distFreq[i] * dist.length[i];
+					fixedBits += (uint64_t)distFreq[i] * 5;
+				}
+				size_t blockLength = blockEnd - blockStart;
+				uint64_t storedBits = ((uint64_t)blockLength + 5 * (blockLength / MaxStoredLength + 1)) * 8 + 7;
+
+				if (storedBits <= dynamicBits && storedBits <= fixedBits)
+					WriteStored(blockStart, blockEnd, last);
+				else if (fixedBits <= dynamicBits)
+				{
+					Huffman fixedLitLen, fixedDist;
+					for (int i = 0; i < FixedLitLenCodes; ++i)
+						fixedLitLen.length[i] = (unsigned char)(i < 144 ? 8 : (i < 256 ? 9 : (i < 280 ? 7 : 8)));
+					for (int i = 0; i < DistCodes; ++i)
+						fixedDist.length[i] = 5;
+					BuildCodes(fixedLitLen.length, FixedLitLenCodes, fixedLitLen.code);
+					BuildCodes(fixedDist.length, DistCodes, fixedDist.code);
+					PutBits(last ? 1 : 0, 1);
+					PutBits(1, 2);
+					WriteSymbols(fixedLitLen, fixedDist);
+				}
+				else
+				{
+					BuildCodes(litLen.length, LitLenCodes, litLen.code);
+					BuildCodes(dist.length, DistCodes, dist.code);
+					BuildCodes(codeLen.length, CodeLenCodes, codeLen.code);
+					PutBits(last ? 1 : 0, 1);
+					PutBits(2, 2);
+					PutBits(numLitLen - 257, 5);
+					PutBits(numDist - 1, 5);
+					PutBits(numCodeLen - 4, 4);
+					for (int i = 0; i < numCodeLen; ++i)
+						PutBits(codeLen.length[codeLengthOrder[i]], 3);
+					for (int i = 0; i < numCL; ++i)
+					{
+						unsigned char s = clSymbols[i].symbol;
+						PutBits(codeLen.code[s], codeLen.length[s]);
+						if (s == 16)
+							PutBits(clSymbols[i].extra, 2);
+						else if (s == 17)
+							PutBits(clSymbols[i].extra, 3);
+						else if (s == 18)
+							PutBits(clSymbols[i].extra, 7);
+					}
+					WriteSymbols(litLen, dist);
+				}
+				numSymbols = 0;
+				blockStart = blockEnd;
+			}
+
+			struct Symbol
+			{
+				unsigned short value;		// literal or match length
+				unsigned short distance;	// (distance - 1) | 0x8000 for match, 0 for literal
+			};
+
+			const unsigned char* const input;
+			const size_t inputLength;
+			unsigned char* const output;
+			unsigned char* const outputEnd;
+			unsigned char* outputPos;
+			uint64_t bitBuffer;
+			unsigned int bitCount;
+			bool overflow;
+
+			const int level;
+			unsigned int maxChain;
+			unsigned int niceLength;
+			bool lazy;
+
+			Symbol symbols[MaxSymbols];
+			size_t numSymbols;
+			size_t blockStart;
+			size_t head[HashSize];		// position + 1, 0 if empty.
+			size_t prev[WindowSize];
+		};
+	};
+}
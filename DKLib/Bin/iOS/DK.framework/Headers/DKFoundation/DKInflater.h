@@ -0,0 +1,674 @@
+//
+//  File: DKInflater.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <string.h>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKObject.h"
+#include "DKArray.h"
+#include "DKSpinLock.h"
+#include "DKCriticalSection.h"
+#include "DKData.h"
+#include "DKStream.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKInflater
+// raw deflate (RFC 1951) decoder, decodes from memory. (mapped file, etc.)
+//
+// Inflate() decodes next bytes into buffer, can be called repeatedly.
+// Seek() moves to uncompressed position. seeking backward restarts from
+// beginning, unless seek index has checkpoint before position.
+//
+// DKInflater::SeekIndex
+//  checkpoints of decoder state (input bit offset, 32KB window) taken at
+//  deflate block boundary every 'interval' bytes of output.
+//  index is filled while decoding, can be shared with other decoders of
+//  same input. (thread-safe)
+//
+// DKInflateStream
+//  read-only, seekable stream which decodes DKData. (data is locked while
+//  stream is alive)
+//
+// Example:
+//  DKObject<DKInflater::SeekIndex> index = DKOBJECT_NEW DKInflater::SeekIndex(1024 * 1024);
+//  DKInflateStream stream(slice, uncompressedSize, index);
+//  stream.SetPos(pos);		// fast if index has checkpoint near pos.
+//  stream.Read(buffer, size);
+//
+// Note:
+//  checkpoint is taken at block boundary only, actual distance between
+//  checkpoints depends on block size of compressor. (usually 16~128KB)
+//  each checkpoint holds 32KB window.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKInflater
+	{
+	public:
+		enum
+		{
+			WindowSize = 0x8000,
+		};
+		struct Checkpoint
+		{
+			uint64_t inputBits;		// bit offset of block header
+			uint64_t output;		// uncompressed offset
+			DKArray<unsigned char> window;
+		};
+		class SeekIndex
+		{
+		public:
+			SeekIndex(size_t interval = 0x100000) : interval(Max<size_t>(interval, WindowSize))
+			{
+			}
+			size_t Interval(void) const		{return interval;}
+			size_t NumberOfCheckpoints(void) const
+			{
+				DKCriticalSection<DKSpinLock> guard(lock);
+				return checkpoints.Count();
+			}
+			// last checkpoint before or at position.
+			DKObject<Checkpoint> Find(uint64_t position) const
+			{
+				DKCriticalSection<DKSpinLock> guard(lock);
+				size_t begin = 0;
+				size_t end = checkpoints.Count();
+				while (begin < end)
+				{
+					size_t mid = (begin + end) / 2;
+					if (checkpoints.Value(mid)->output <= position)
+						begin = mid + 1;
+					else
+						end = mid;
+				}
+				if (begin > 0)
+					return checkpoints.Value(begin - 1);
+				return NULL;
+			}
+			// next output offset should be checkpointed.
+			uint64_t NextOutput(void) const
+			{
+				DKCriticalSection<DKSpinLock> guard(lock);
+				if (checkpoints.Count() > 0)
+					return checkpoints.Value(checkpoints.Count() - 1)->output + interval;
+				return interval;
+			}
+			void Add(Checkpoint* cp)
+			{
+				DKCriticalSection<DKSpinLock> guard(lock);
+				uint64_t next = interval;
+				if (checkpoints.Count() > 0)
+					next = checkpoints.Value(checkpoints.Count() - 1)->output + interval;
+				if (cp->output >= next)
+					checkpoints.Add(cp);
+			}
+		private:
+			const size_t interval;
+			DKArray<DKObject<Checkpoint>> checkpoints;
+			DKSpinLock lock;
+
+			SeekIndex(const SeekIndex&);
+			SeekIndex& operator = (const SeekIndex&);
+		};
+
+		DKInflater(const void* input, size_t inputLength, SeekIndex* index = NULL)
+			: inputBegin(reinterpret_cast<const unsigned char*>(input))
+			, inputEnd(reinterpret_cast<const unsigned char*>(input) + inputLength)
+			, seekIndex(index)
+		{
+			Reset();
+		}
+		~DKInflater(void)
+		{
+		}
+
+		// decode next bytes, returns bytes decoded.
+		// returns less than size if end of stream or error.
+		size_t Inflate(void* output, size_t size)
+		{
+			return Decode(reinterpret_cast<unsigned char*>(output), size);
+		}
+		// move to uncompressed position.
+		bool Seek(uint64_t position)
+		{
+			if (error)
+				return false;
+			DKObject<Checkpoint> cp = NULL;
+			if (seekIndex)
+				cp = seekIndex->Find(position);
+			if (cp && (cp->output > output || position < output))
+				Restore(cp);
+			else if (position < output)
+				Reset();
+
+			while (output < position && !finished && !error)
+			{
+				size_t n = (size_t)Min<uint64_t>(position - output, (uint64_t)-1 >> 1);
+				if (Decode(NULL, n) == 0)
+					break;
+			}
+			return output == position;
+		}
+		uint64_t Position(void) const	{return output;}
+		bool IsFinished(void) const		{return finished;}
+		bool IsError(void) const		{return error;}
+		// compressed bytes consumed. (valid if finished)
+		size_t InputLength(void) const	{return (size_t)((InputBits() + 7) / 8);}
+
+		void Reset(void)
+		{
+			SetInputBits(0);
+			output = 0;
+			blockType = BlockNone;
+			lastBlock = false;
+			finished = false;
+			error = false;
+			storedLength = 0;
+			matchLength = 0;
+			matchDistance = 0;
+		}
+
+	private:
+		enum
+		{
+			FastBits = 9,
+			MaxBits = 15,
+			MaxLitLenCodes = 288,
+			MaxDistCodes = 30,
+			WindowMask = WindowSize - 1,
+		};
+		enum BlockType
+		{
+			BlockNone = -1,
+			BlockStored = 0,
+			BlockFixed = 1,
+			BlockDynamic = 2,
+		};
+		struct Huffman
+		{
+			unsigned short count[MaxBits + 1];
+			unsigned short symbol[MaxLitLenCodes];
+			unsigned short fast[1 << FastBits];	// (symbol << 4 | length), 0 if code is longer.
+		};
+
+		// bit reader
+		void Refill(void)
+		{
+			while (bitCount <= 56)
+			{
+				if (input < inputEnd)
+					bitBuffer |= (uint64_t)(*input++) << bitCount;
+				else
+					overrun++;
+				bitCount += 8;
+			}
+		}
+		unsigned int Bits(unsigned int n)
+		{
+			if (bitCount < n)
+				Refill();
+			unsigned int v = (unsigned int)(bitBuffer & ((1ULL << n) - 1));
+			bitBuffer >>= n;
+			bitCount -= n;
+			return v;
+		}
+		uint64_t InputBits(void) const
+		{
+			return (uint64_t)(input - inputBegin + overrun) * 8 - bitCount;
+		}
+		void SetInputBits(uint64_t bits)
+		{
+			input = inputBegin + Min<uint64_t>(bits / 8, inputEnd - inputBegin);
+			bitBuffer = 0;
+			bitCount = 0;
+			overrun = 0;
+			if (bits % 8)
+				Bits((unsigned int)(bits % 8));
+		}
+		bool IsOverrun(void) const
+		{
+			return overrun * 8 > bitCount;
+		}
+
+		static bool BuildHuffman(Huffman& h, const unsigned char* lengths, int n)
+		{
+			memset(h.count, 0, sizeof(h.count));
+			for (int i = 0; i < n; ++i)
+				h.count[lengths[i]]++;
+			if (h.count[0] == n)		// no codes
+			{
+				memset(h.fast, 0, sizeof(h.fast));
+				return true;
+			}
+			int left = 1;
+			for (int len = 1; len <= MaxBits; ++len)
+			{
+				left <<= 1;
+				left -= h.count[len];
+				if (left < 0)		// over-subscribed
+					return false;
+			}
+			unsigned short offsets[MaxBits + 2];
+			offsets[1] = 0;
+			for (int len = 1; len <= MaxBits; ++len)
+				offsets[len + 1] = offsets[len] + h.count[len];
+			for (int i = 0; i < n; ++i)
+			{
+				if (lengths[i])
+					h.symbol[offsets[lengths[i]]++] = (unsigned short)i;
+			}
+			// lookup table of short codes, indexed by bit-reversed code.
+			memset(h.fast, 0, sizeof(h.fast));
+			unsigned int code = 0;
+			int index = 0;
+			for (int len = 1; len <= FastBits; ++len)
+			{
+				for (int i = 0; i < h.count[len]; ++i)
+				{
+					unsigned int rev = 0;
+					for (int b = 0; b < len; ++b)
+						rev |= ((code >> b) & 1) << (len - 1 - b);
+					unsigned short entry = (unsigned short)((h.symbol[index] << 4) | len);
+					for (unsigned int k = rev; k < (1U << FastBits); k += (1U << len))
+						h.fast[k] = entry;
+					code++;
+					index++;
+				}
+				code <<= 1;
+			}
+			return true;
+		}
+		int DecodeSymbol(const Huffman& h)
+		{
+			if (bitCount < MaxBits)
+				Refill();
+			unsigned short entry = h.fast[bitBuffer & ((1 << FastBits) - 1)];
+			if (entry)
+			{
+				bitBuffer >>= (entry & 15);
+				bitCount -= (entry & 15);
+				return entry >> 4;
+			}
+			// canonical decoding of long code.
+			uint64_t bits = bitBuffer;
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (int len = 1; len <= MaxBits; ++len)
+			{
+				code |= (int)(bits & 1);
+				bits >>= 1;
+				int count = h.count[len];
+				if (code - count < first)
+				{
+					bitBuffer >>= len;
+					bitCount -= len;
+					return h.symbol[index + (code - first)];
+				}
+				index += count;
+				first += count;
+				first <<= 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+
+		bool BeginBlock(void)
+		{
+			if (seekIndex && output > 0 && output >= seekIndex->NextOutput())
+			{
+				DKObject<Checkpoint> cp = DKOBJECT_NEW Checkpoint();
+				cp->inputBits = InputBits();
+				cp->output = output;
+				size_t len = (size_t)Min<uint64_t>(output, WindowSize);
+				cp->window.Resize(len);
+				for (size_t i = 0; i < len; ++i)
+					cp->window.Value(i) = window[(output - len + i) & WindowMask];
+				seekIndex->Add(cp);
+			}
+
+			lastBlock = Bits(1) != 0;
+			blockType = (BlockType)Bits(2);
+			switch (blockType)
+			{
+			case BlockStored:
+				{
+					Bits(bitCount % 8);		// byte align
+					unsigned int len = Bits(16);
+					unsigned int nlen = Bits(16);
+					if (len != (~nlen & 0xffff))
+						return false;
+					storedLength = len;
+				}
+				break;
+			case BlockFixed:
+				{
+					unsigned char lengths[MaxLitLenCodes];
+					int i = 0;
+					for (; i < 144; ++i) lengths[i] = 8;
+					for (; i < 256; ++i) lengths[i] = 9;
+					for (; i < 280; ++i) lengths[i] = 7;
+					for (; i < 288; ++i) lengths[i] = 8;
+					BuildHuffman(litLenCode, lengths, MaxLitLenCodes);
+					for (i = 0; i < MaxDistCodes; ++i) lengths[i] = 5;
+					BuildHuffman(distCode, lengths, MaxDistCodes);
+				}
+				break;
+			case BlockDynamic:
+				if (!ReadDynamicTables())
+					return false;
+				break;
+			default:
+				return false;
+			}
+			return !IsOverrun();
+		}
+		bool ReadDynamicTables(void)
+		{
+			static const unsigned char order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+			unsigned char lengths[MaxLitLenCodes + MaxDistCodes + 2];
+
+			int numLitLen = Bits(5) + 257;
+			int numDist = Bits(5) + 1;
+			int numCodeLen = Bits(4) + 4;
+			if (numLitLen > 286 || numDist > MaxDistCodes)
+				return false;
+
+			memset(lengths, 0, 19);
+			for (int i = 0; i < numCodeLen; ++i)
+				lengths[order[i]] = (unsigned char)Bits(3);
+			Huffman& lenCode = litLenCode;		// temporary
+			if (!BuildHuffman(lenCode, lengths, 19))
+				return false;
+
+			int index = 0;
+			while (index < numLitLen + numDist)
+			{
+				int symbol = DecodeSymbol(lenCode);
+				if (symbol < 0)
+					return false;
+				if (symbol < 16)
+				{
+					lengths[index++] = (unsigned char)symbol;
+					continue;
+				}
+				unsigned char len = 0;
+				int repeat;
+				if (symbol == 16)
+				{
+					if (index == 0)
+						return false;
+					len = lengths[index - 1];
+					repeat = 3 + Bits(2);
+				}
+				else if (symbol == 17)
+					repeat = 3 + Bits(3);
+				else
+					repeat = 11 + Bits(7);
+				if (index + repeat > numLitLen + numDist)
+					return false;
+				while (repeat--)
+					lengths[index++] = len;
+			}
+			if (lengths[256] == 0)		// no end-of-block code
+				return false;
+			return BuildHuffman(litLenCode, lengths, numLitLen) &&
+				BuildHuffman(distCode, lengths + numLitLen, numDist);
+		}
+
+		void Emit(unsigned char*& out, const unsigned char* p, size_t n)
+		{
+			if (out)
+			{
+				memcpy(out, p, n);
+				out += n;
+			}
+			if (n > WindowSize)
+			{
+				output += n - WindowSize;
+				p += n - WindowSize;
+				n = WindowSize;
+			}
+			while (n > 0)
+			{
+				size_t pos = (size_t)(output & WindowMask);
+				size_t len = Min<size_t>(n, WindowSize - pos);
+				memcpy(&window[pos], p, len);
+				output += len;
+				p += len;
+				n -= len;
+			}
+		}
+		size_t Decode(unsigned char* out, size_t size)
+		{
+			static const unsigned short lengthBase[29] = {
+				3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+				35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+			static const unsigned char lengthExtra[29] = {
+				0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+				3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+			static const unsigned short distBase[30] = {
+				1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+				257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+			static const unsigned char distExtra[30] = {
+				0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+				7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+			size_t remain = size;
+			while (remain > 0 && !finished && !error)
+			{
+				if (matchLength > 0)
+				{
+					size_t n = Min<size_t>(matchLength, remain);
+					for (size_t i = 0; i < n; ++i)
+					{
+						unsigned char c = window[(output - matchDistance) & WindowMask];
+						window[output & WindowMask] = c;
+						output++;
+						if (out)
+							*out++ = c;
+					}
+					matchLength -= (unsigned int)n;
+					remain -= n;
+					continue;
+				}
+				switch (blockType)
+				{
+				case BlockNone:
+					if (lastBlock)
+						finished = true;
+					else if (!BeginBlock())
+						error = true;
+					break;
+				case BlockStored:
+					if (storedLength == 0)
+					{
+						blockType = BlockNone;
+						break;
+					}
+					else
+					{
+						size_t n = Min<size_t>(storedLength, remain);
+						size_t copied = 0;
+						// bytes in bit buffer first. (byte aligned)
+						while (copied < n && bitCount >= 8)
+						{
+							unsigned char c = (unsigned char)Bits(8);
+							Emit(out, &c, 1);
+							copied++;
+						}
+						if (copied < n)
+						{
+							if (IsOverrun() || (size_t)(inputEnd - input) < n - copied)
+							{
+								error = true;
+								break;
+							}
+							Emit(out, input, n - copied);
+							input += n - copied;
+						}
+						if (IsOverrun())
+						{
+							error = true;
+							break;
+						}
+						storedLength -= (unsigned int)n;
+						remain -= n;
+					}
+					break;
+				default:
+					{
+						int symbol = DecodeSymbol(litLenCode);
+						if (symbol < 0)
+							error = true;
+						else if (symbol < 256)
+						{
+							unsigned char c = (unsigned char)symbol;
+							window[output & WindowMask] = c;
+							output++;
+							if (out)
+								*out++ = c;
+							remain--;
+						}
+						else if (symbol == 256)
+						{
+							blockType = BlockNone;
+							if (IsOverrun())
+								error = true;
+						}
+						else
+						{
+							symbol -= 257;
+							if (symbol >= 29)
+							{
+								error = true;
+								break;
+							}
+							unsigned int length = lengthBase[symbol] + Bits(lengthExtra[symbol]);
+							int dsym = DecodeSymbol(distCode);
+							if (dsym < 0 || dsym >= 30)
+							{
+								error = true;
+								break;
+							}
+							unsigned int dist = distBase[dsym] + Bits(distExtra[dsym]);
+							if (dist > output || IsOverrun())
+							{
+								error = true;
+								break;
+							}
+							matchLength = length;
+							matchDistance = dist;
+						}
+					}
+					break;
+				}
+			}
+			return size - remain;
+		}
+		void Restore(const Checkpoint* cp)
+		{
+			Reset();
+			SetInputBits(cp->inputBits);
+			output = cp->output;
+			size_t len = cp->window.Count();
+			for (size_t i = 0; i < len; ++i)
+				window[(output - len + i) & WindowMask] = cp->window.Value(i);
+		}
+
+		const unsigned char* const inputBegin;
+		const unsigned char* const inputEnd;
+		const unsigned char* input;
+		uint64_t bitBuffer;
+		unsigned int bitCount;
+		size_t overrun;		// bytes read past end. (zero padded)
+
+		uint64_t output;
+		BlockType blockType;
+		bool lastBlock;
+		bool finished;
+		bool error;
+		unsigned int storedLength;
+		unsigned int matchLength;
+		unsigned int matchDistance;
+		Huffman litLenCode;
+		Huffman distCode;
+		unsigned char window[WindowSize];
+		DKObject<SeekIndex> seekIndex;
+
+		DKInflater(const DKInflater&);
+		DKInflater& operator = (const DKInflater&);
+	};
+
+	class DKInflateStream : public DKStream
+	{
+	public:
+		// length: uncompressed length
+		DKInflateStream(DKData* compressed, size_t length, DKInflater::SeekIndex* index = NULL)
+			: data(compressed), totalLength(length), inflater(NULL)
+		{
+			if (data)
+			{
+				const void* p = data->LockShared();
+				void* mem = p ? DKMemoryHeapAlloc(sizeof(DKInflater)) : NULL;
+				if (mem)
+					inflater = new(mem) DKInflater(p, data->Length(), index);
+			}
+		}
+		~DKInflateStream(void)
+		{
+			if (inflater)
+			{
+				inflater->~DKInflater();
+				DKMemoryHeapFree(inflater);
+			}
+			if (data)
+				data->UnlockShared();
+		}
+
+		Position SetPos(Position p)
+		{
+			if (inflater)
+			{
+				inflater->Seek((uint64_t)Clamp<Position>(p, 0, totalLength));
+				return (Position)inflater->Position();
+			}
+			return 0;
+		}
+		Position GetPos(void) const			{return inflater ? (Position)inflater->Position() : 0;}
+		Position RemainLength(void) const	{return TotalLength() - GetPos();}
+		Position TotalLength(void) const	{return inflater ? totalLength : 0;}
+
+		size_t Read(void* p, size_t s)
+		{
+			if (inflater)
+			{
+				s = (size_t)Min<uint64_t>(s, totalLength - Min<uint64_t>(inflater->Position(), totalLength));
+				return inflater->Inflate(p, s);
+			}
+			return 0;
+		}
+		size_t Write(const void*, size_t)		{return 0;}	// read-only
+
+		bool IsReadable(void) const		{return true;}
+		bool IsSeekable(void) const		{return true;}
+		bool IsWritable(void) const		{return false;}
+
+		bool IsError(void) const		{return inflater == NULL || inflater->IsError();}
+
+	private:
+		DKObject<DKData> data;
+		const size_t totalLength;
+		DKInflater* inflater;	// 32KB window, heap allocated
+
+		DKInflateStream(const DKInflateStream&);
+		DKInflateStream& operator = (const DKInflateStream&);
+	};
+}
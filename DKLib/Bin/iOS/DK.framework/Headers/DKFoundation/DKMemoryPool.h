@@ -0,0 +1,367 @@
+//
+//  File: DKMemoryPool.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKAllocator.h"
+#include "DKSpinLock.h"
+#include "DKCriticalSection.h"
+#include "DKThreadLocal.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKMemoryPool
+// size-class pool allocator for small fixed-size objects.
+//
+// DKMemoryPool-Alloc/Realloc/Free functions are serving small memory blocks
+// (DKMemoryPoolMaxUnitSize or less) from per-thread free-lists, one list for
+// each size-class. When thread's free-list grows too long, a batch of blocks
+// will be moved to the global depot, other threads can take it from depot.
+// larger requests are passed to DKMemoryHeapAlloc.
+//
+// DKMemoryPoolAllocator is DKAllocator for pool, it can be used with
+// DKObject::Alloc() or operator new(size_t, DKAllocator&).
+//   DKObject<MyObject> obj = DKObject<MyObject>::Alloc(DKMemoryPoolAllocator::Instance());
+//
+// DKMemoryPMAllocator is allocator type for template classes.
+//
+// Note:
+//  Memory chunks will not be returned to system, they will be reused until
+//  process terminated.
+//  Pool allocators report DKMemoryLocationCustom, DKMemoryLocation is used
+//  by compiled library and cannot have location for header-only allocator.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		class MemoryPool
+		{
+		public:
+			enum
+			{
+				HeaderSize = 16,			// block header, keeps 16 bytes alignment.
+				ChunkSize = 0x10000,		// 64KB, allocation unit from heap.
+				NumSizeClasses = 24,
+				MaxUnitSize = 2048,
+				LargeBlock = 0xffff,		// size-class of heap-allocated block.
+			};
+			union Header
+			{
+				unsigned int sizeClass;
+				unsigned char padding[HeaderSize];
+			};
+			// free block layout. (header area is used also)
+			struct FreeBlock
+			{
+				FreeBlock* next;			// next block in list.
+				FreeBlock* nextBatch;		// first block of next batch. (depot only)
+				size_t batchLength;			// number of blocks in batch. (depot only)
+			};
+
+			static size_t UnitSize(unsigned int sizeClass)
+			{
+				static const size_t units[NumSizeClasses] = {
+					16, 32, 48, 64, 80, 96, 112, 128,
+					160, 192, 224, 256, 320, 384, 448, 512,
+					640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+				};
+				DKASSERT_DEBUG(sizeClass < NumSizeClasses);
+				return units[sizeClass];
+			}
+			static unsigned int SizeClass(size_t s)
+			{
+				if (s <= 128)
+					return s > 0 ? static_cast<unsigned int>((s - 1) / 16) : 0;
+				if (s > MaxUnitSize)
+					return LargeBlock;
+				unsigned int c = 8;
+				while (UnitSize(c) < s)
+					c++;
+				return c;
+			}
+			static size_t BlockSize(unsigned int sizeClass)
+			{
+				return UnitSize(sizeClass) + HeaderSize;
+			}
+			// number of blocks moved between thread and depot at once.
+			static size_t BatchLength(unsigned int sizeClass)
+			{
+				return Clamp<size_t>((ChunkSize / 4) / BlockSize(sizeClass), 4, 64);
+			}
+
+			static void* Alloc(size_t s)
+			{
+				unsigned int sizeClass = SizeClass(s);
+				Header* header = NULL;
+				if (sizeClass == LargeBlock)
+				{
+					header = static_cast<Header*>(DKMemoryHeapAlloc(s + HeaderSize));
+					if (header == NULL)
+						return NULL;
+				}
+				else
+				{
+					MemoryPool* pool = Instance();
+					ThreadCache* cache = pool ? pool->threadCache.Value() : NULL;
+					if (cache == NULL)
+						return NULL;
+					FreeBlock* block = cache->head[sizeClass];
+					if (block == NULL)
+					{
+						block = pool->Refill(sizeClass, &cache->count[sizeClass]);
+						if (block == NULL)
+							return NULL;
+					}
+					cache->head[sizeClass] = block->next;
+					cache->count[sizeClass]--;
+					header = reinterpret_cast<Header*>(block);
+				}
+				header->sizeClass = sizeClass;
+				return reinterpret_cast<unsigned char*>(header) + HeaderSize;
+			}
+			static void* Realloc(void* p, size_t s)
+			{
+				if (p == NULL)
+					return Alloc(s);
+
+				Header* header = HeaderOf(p);
+				if (header->sizeClass == LargeBlock)
+				{
+					header = static_cast<Header*>(DKMemoryHeapRealloc(header, s + HeaderSize));
+					if (header == NULL)
+						return NULL;
+					return reinterpret_cast<unsigned char*>(header) + HeaderSize;
+				}
+				size_t unit = UnitSize(header->sizeClass);
+				if (s <= unit)
+					return p;
+
+				void* p2 = Alloc(s);
+				if (p2)
+				{
+					memcpy(p2, p, unit);
+					Free(p);
+				}
+				return p2;
+			}
+			static void Free(void* p)
+			{
+				if (p == NULL)
+					return;
+
+				Header* header = HeaderOf(p);
+				unsigned int sizeClass = header->sizeClass;
+				if (sizeClass == LargeBlock)
+				{
+					DKMemoryHeapFree(header);
+					return;
+				}
+				DKASSERT_DEBUG(sizeClass < NumSizeClasses);
+
+				MemoryPool* pool = Instance();	// not NULL, block was allocated from it.
+				ThreadCache* cache = pool->threadCache.Value();
+				FreeBlock* block = reinterpret_cast<FreeBlock*>(header);
+				if (cache == NULL)
+				{
+					// no cache for this thread, give block to depot directly.
+					block->next = NULL;
+					pool->PushBatch(sizeClass, block, 1);
+					return;
+				}
+				block->next = cache->head[sizeClass];
+				cache->head[sizeClass] = block;
+				cache->count[sizeClass]++;
+
+				size_t batch = BatchLength(sizeClass);
+				if (cache->count[sizeClass] > batch * 2)
+				{
+					// move 'batch' blocks from head into depot.
+					FreeBlock* first = cache->head[sizeClass];
+					FreeBlock* last = first;
+					for (size_t i = 1; i < batch; ++i)
+						last = last->next;
+					cache->head[sizeClass] = last->next;
+					cache->count[sizeClass] -= batch;
+					last->next = NULL;
+					pool->PushBatch(sizeClass, first, batch);
+				}
+			}
+			// usable size of block.
+			static size_t Size(void* p)
+			{
+				DKASSERT_DEBUG(p != NULL);
+				unsigned int sizeClass = HeaderOf(p)->sizeClass;
+				if (sizeClass == LargeBlock)
+					return 0;	// unknown
+				return UnitSize(sizeClass);
+			}
+
+		private:
+			struct ThreadCache
+			{
+				FreeBlock* head[NumSizeClasses];
+				size_t count[NumSizeClasses];
+
+				ThreadCache(void)
+				{
+					for (int i = 0; i < NumSizeClasses; ++i)
+					{
+						head[i] = NULL;
+						count[i] = 0;
+					}
+				}
+				~ThreadCache(void)	// thread terminated, give all blocks to depot.
+				{
+					for (unsigned int i = 0; i < NumSizeClasses; ++i)
+					{
+						if (head[i])
+							Instance()->PushBatch(i, head[i], count[i]);
+					}
+				}
+			};
+			struct Depot
+			{
+				DKSpinLock lock;
+				FreeBlock* batches;
+				Depot(void) : batches(NULL) {}
+			};
+
+			Depot depots[NumSizeClasses];
+			DKThreadLocal<ThreadCache> threadCache;
+
+			static Header* HeaderOf(void* p)
+			{
+				return reinterpret_cast<Header*>(reinterpret_cast<unsigned char*>(p) - HeaderSize);
+			}
+			void PushBatch(unsigned int sizeClass, FreeBlock* first, size_t length)
+			{
+				first->batchLength = length;
+				Depot& depot = depots[sizeClass];
+				DKCriticalSection<DKSpinLock> guard(depot.lock);
+				first->nextBatch = depot.batches;
+				depot.batches = first;
+			}
+			// get blocks from depot, or new chunk if depot is empty.
+			FreeBlock* Refill(unsigned int sizeClass, size_t* length)
+			{
+				Depot& depot = depots[sizeClass];
+				FreeBlock* batch = NULL;
+				{
+					DKCriticalSection<DKSpinLock> guard(depot.lock);
+					batch = depot.batches;
+					if (batch)
+						depot.batches = batch->nextBatch;
+				}
+				if (batch)
+				{
+					*length = batch->batchLength;
+					return batch;
+				}
+
+				size_t blockSize = BlockSize(sizeClass);
+				size_t numBlocks = ChunkSize / blockSize;
+				unsigned char* chunk = static_cast<unsigned char*>(DKMemoryHeapAlloc(ChunkSize));
+				if (chunk == NULL)
+					return NULL;
+				for (size_t i = 0; i < numBlocks; ++i)
+				{
+					FreeBlock* block = reinterpret_cast<FreeBlock*>(&chunk[blockSize * i]);
+					block->next = (i + 1 < numBlocks) ? reinterpret_cast<FreeBlock*>(&chunk[blockSize * (i + 1)]) : NULL;
+				}
+				*length = numBlocks;
+				return reinterpret_cast<FreeBlock*>(chunk);
+			}
+
+			// pool instance is never destroyed, objects can be released
+			// while other global objects being destroyed.
+			template <int N> struct InstanceHolder
+			{
+				static std::atomic<MemoryPool*> instance;
+			};
+			// returns NULL if pool cannot be allocated.
+			static MemoryPool* Instance(void)
+			{
+				MemoryPool* pool = InstanceHolder<0>::instance.load(std::memory_order_acquire);
+				if (pool == NULL)
+				{
+					void* mem = DKMemoryHeapAlloc(sizeof(MemoryPool));
+					if (mem == NULL)
+						return NULL;
+					MemoryPool* newPool = new(mem) MemoryPool();
+					if (InstanceHolder<0>::instance.compare_exchange_strong(pool, newPool, std::memory_order_acq_rel))
+						pool = newPool;
+					else
+					{
+						newPool->~MemoryPool();
+						DKMemoryHeapFree(newPool);
+					}
+				}
+				return pool;
+			}
+		};
+		template <int N> std::atomic<MemoryPool*> MemoryPool::InstanceHolder<N>::instance(NULL);
+	}
+
+	enum {DKMemoryPoolMaxUnitSize = Private::MemoryPool::MaxUnitSize};
+
+	// pool memory
+	inline void* DKMemoryPoolAlloc(size_t s)				{return Private::MemoryPool::Alloc(s);}
+	inline void* DKMemoryPoolRealloc(void* p, size_t s)		{return Private::MemoryPool::Realloc(p, s);}
+	inline void  DKMemoryPoolFree(void* p)					{Private::MemoryPool::Free(p);}
+
+	// allocator type for template classes.
+	struct DKMemoryPMAllocator
+	{
+		enum {location = DKMemoryLocationCustom};
+		static void* Alloc(size_t s)			{return DKMemoryPoolAlloc(s);}
+		static void* Realloc(void* p, size_t s)	{return DKMemoryPoolRealloc(p, s);}
+		static void Free(void* p)				{DKMemoryPoolFree(p);}
+	};
+
+	// DKAllocator for pool memory.
+	class DKMemoryPoolAllocator : public DKAllocator
+	{
+	public:
+		void* Alloc(size_t s)					{return DKMemoryPoolAlloc(s);}
+		void Dealloc(void* p)					{DKMemoryPoolFree(p);}
+		DKMemoryLocation Location(void) const	{return DKMemoryLocationCustom;}
+
+		// shared instance, never destroyed.
+		static DKAllocator& Instance(void)
+		{
+			DKMemoryPoolAllocator* alloc = InstanceHolder<0>::instance.load(std::memory_order_acquire);
+			if (alloc == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(DKMemoryPoolAllocator));
+				if (mem == NULL)
+					DKERROR_THROW("Out of memory");
+				DKMemoryPoolAllocator* newAlloc = new(mem) DKMemoryPoolAllocator();
+				if (InstanceHolder<0>::instance.compare_exchange_strong(alloc, newAlloc, std::memory_order_acq_rel))
+					alloc = newAlloc;
+				else
+				{
+					newAlloc->~DKMemoryPoolAllocator();
+					DKMemoryHeapFree(newAlloc);
+				}
+			}
+			return *alloc;
+		}
+
+	private:
+		template <int N> struct InstanceHolder
+		{
+			static std::atomic<DKMemoryPoolAllocator*> instance;
+		};
+	};
+	template <int N> std::atomic<DKMemoryPoolAllocator*> DKMemoryPoolAllocator::InstanceHolder<N>::instance(NULL);
+}
+
+#define DKOBJECT_POOL_NEW		new(DKFoundation::DKMemoryPoolAllocator::Instance())
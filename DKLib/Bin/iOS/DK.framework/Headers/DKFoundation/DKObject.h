@@ -291,6 +291,8 @@ namespace DKFoundation
 	template <typename T> class DKObject<T*>;
 	template <typename T> class DKObject<T&>;
 	template <typename T> class DKObject<T&&>;
+	// DKObject can be relocated by memcpy, ref-count is not bound to address of DKObject.
+	template <typename T> struct DKTriviallyRelocatable<DKObject<T>> {enum {Result = true};};
 
 	// To provide external linkage for internal object
 	class DKUnknown
@@ -6,6 +6,7 @@
 //
 
 #pragma once
+#include <new>
 #include "../DKInclude.h"
 #include "DKTypeTraits.h"
 #include "DKFunction.h"
@@ -68,6 +69,40 @@ namespace DKFoundation
 		}
 	};
 
+	namespace Private
+	{
+		// relocate n items from src to dst, ranges can be overlapped.
+		// items in src are destroyed, dst should not be constructed.
+		template <typename VALUE> void RelocateItems(VALUE* dst, VALUE* src, size_t n, DKTrue)
+		{
+			memmove((void*)dst, (void*)src, sizeof(VALUE) * n);
+		}
+		template <typename VALUE> void RelocateItems(VALUE* dst, VALUE* src, size_t n, DKFalse)
+		{
+			if (dst < src)
+			{
+				for (size_t i = 0; i < n; ++i)
+				{
+					::new(&dst[i]) VALUE(static_cast<VALUE&&>(src[i]));
+					src[i].~VALUE();
+				}
+			}
+			else if (dst > src)
+			{
+				for (size_t i = n; i > 0; --i)
+				{
+					::new(&dst[i-1]) VALUE(static_cast<VALUE&&>(src[i-1]));
+					src[i-1].~VALUE();
+				}
+			}
+		}
+		template <typename VALUE> void RelocateItems(VALUE* dst, VALUE* src, size_t n)
+		{
+			if (n > 0 && dst != src)
+				RelocateItems(dst, src, n, DKNumber<DKTriviallyRelocatable<VALUE>::Result>());
+		}
+	}
+
 	template <typename VALUE> class DKStaticArray
 	{
 	public:
@@ -182,18 +217,18 @@ namespace DKFoundation
 					size_t right = count - left;
 					if (right < left)
 					{
-						void* tmp = DKMemoryHeapAlloc(sizeof(VALUE) * right);
-						memcpy(tmp, &data[left], sizeof(VALUE) * right);
-						memmove(&data[right], data, sizeof(VALUE) * left);
-						memcpy(data, tmp, sizeof(VALUE) * right);
+						VALUE* tmp = (VALUE*)DKMemoryHeapAlloc(sizeof(VALUE) * right);
+						Private::RelocateItems(tmp, &data[left], right);
+						Private::RelocateItems(&data[right], data, left);
+						Private::RelocateItems(data, tmp, right);
 						DKMemoryHeapFree(tmp);
 					}
 					else
 					{
-						void* tmp = DKMemoryHeapAlloc(sizeof(VALUE) * left);
-						memcpy(tmp, data, sizeof(VALUE) * left);
-						memmove(data, &data[left], sizeof(VALUE) * right);
-						memcpy(&data[right], tmp, sizeof(VALUE) * left);
+						VALUE* tmp = (VALUE*)DKMemoryHeapAlloc(sizeof(VALUE) * left);
+						Private::RelocateItems(tmp, data, left);
+						Private::RelocateItems(data, &data[left], right);
+						Private::RelocateItems(&data[right], tmp, left);
 						DKMemoryHeapFree(tmp);
 					}
 #endif
@@ -213,16 +248,7 @@ namespace DKFoundation
 			DKASSERT_DEBUG(v2 < count);
 
 			if (v1 != v2)
-			{
-				unsigned char* p1 = reinterpret_cast<unsigned char*>(&data[v1]);
-				unsigned char* p2 = reinterpret_cast<unsigned char*>(&data[v2]);
-				for (int i = 0; i < sizeof(VALUE); ++i)
-				{
-					unsigned char tmp = p1[i];
-					p1[i] = p2[i];
-					p2[i] = tmp;
-				}
-			}
+				Swap(data[v1], data[v2], DKNumber<DKTriviallyRelocatable<VALUE>::Result>());
 		}
 		void Sort(const DKFunctionSignature<bool (const VALUE&, const VALUE&)>* cmp)
 		{
@@ -281,6 +307,28 @@ namespace DKFoundation
 		}
 
 	private:
+		// swap items by bytes. (trivially relocatable)
+		static void Swap(VALUE& v1, VALUE& v2, DKTrue)
+		{
+			unsigned char* p1 = reinterpret_cast<unsigned char*>(&v1);
+			unsigned char* p2 = reinterpret_cast<unsigned char*>(&v2);
+			for (int i = 0; i < sizeof(VALUE); ++i)
+			{
+				unsigned char tmp = p1[i];
+				p1[i] = p2[i];
+				p2[i] = tmp;
+			}
+		}
+		// swap items by move-constructor, copy-constructor is used if VALUE
+		// has no move-constructor. items are not required to be assignable.
+		static void Swap(VALUE& v1, VALUE& v2, DKFalse)
+		{
+			VALUE tmp(static_cast<VALUE&&>(v1));
+			v1.~VALUE();
+			::new(&v1) VALUE(static_cast<VALUE&&>(v2));
+			v2.~VALUE();
+			::new(&v2) VALUE(static_cast<VALUE&&>(tmp));
+		}
 		// lambda enumerator (VALUE&)
 		template <typename T> void EnumerateForward(T&& enumerator, DKNumber<1>)
 		{
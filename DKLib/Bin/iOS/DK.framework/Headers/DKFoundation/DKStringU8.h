@@ -19,6 +19,10 @@
 namespace DKFoundation
 {
 	class DKData;
+	class DKStringU8;
+	// string object holds pointer to heap buffer only, can be relocated by memcpy.
+	template <> struct DKTriviallyRelocatable<DKStringU8> {enum {Result = true};};
+
 	class DKLIB_API DKStringU8
 	{
 	public:
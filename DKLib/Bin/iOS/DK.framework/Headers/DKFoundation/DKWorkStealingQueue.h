@@ -0,0 +1,444 @@
+//
+//  File: DKWorkStealingQueue.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKFunction.h"
+#include "DKOperation.h"
+#include "DKOperationQueue.h"
+#include "DKThread.h"
+#include "DKThreadLocal.h"
+#include "DKCondition.h"
+#include "DKSpinLock.h"
+#include "DKQueue.h"
+#include "DKArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKWorkStealingQueue
+// processing operations with multi-threaded, work-stealing scheduler.
+// interface is same as DKOperationQueue.
+//
+// each worker thread has own deque of operations. operations posted from
+// worker thread are pushed into its deque, and processed in LIFO order.
+// operations posted from other threads are distributed to deques.
+// idle worker steals oldest operation from deque of random victim, and
+// parks on condition when there is nothing to steal.
+// there is no global lock, workers contend only when stealing.
+//
+// TaskGroup: fork-join helper.
+//  an operation can spawn child operations and wait for them, waiting
+//  thread performs pending operations instead of blocking.
+//
+// Example:
+//  DKWorkStealingQueue queue;
+//  queue.Post(DKFunction([&]()
+//  {
+//      DKWorkStealingQueue::TaskGroup group(queue);
+//      group.Spawn(DKFunction(Child1)->Invocation());
+//      group.Spawn(DKFunction(Child2)->Invocation());
+//      group.Wait();   // performs Child1, Child2 or other operations.
+//  })->Invocation());
+//
+// Note:
+//  number of threads is fixed at construction.
+//  (zero for number of hardware threads)
+//  destructor waits until all operations are done.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKWorkStealingQueue
+	{
+	public:
+		typedef DKOperationQueue::OperationSync OperationSync;
+
+		class TaskGroup
+		{
+		public:
+			TaskGroup(DKWorkStealingQueue& q) : queue(q), pending(0) {}
+			~TaskGroup(void)
+			{
+				Wait();
+			}
+			void Spawn(DKOperation* operation)
+			{
+				pending.fetch_add(1);
+				queue.Enqueue(operation, NULL, this);
+			}
+			// wait until all spawned operations are done.
+			// calling thread performs pending operations while waiting.
+			void Wait(void)
+			{
+				while (pending.load(std::memory_order_acquire) > 0)
+				{
+					if (!queue.PerformPending())
+						DKThread::Yield();
+				}
+			}
+			size_t PendingOperations(void) const
+			{
+				return pending.load(std::memory_order_relaxed);
+			}
+		private:
+			DKWorkStealingQueue& queue;
+			std::atomic<size_t> pending;
+			friend class DKWorkStealingQueue;
+
+			TaskGroup(const TaskGroup&);
+			TaskGroup& operator = (const TaskGroup&);
+		};
+
+		DKWorkStealingQueue(size_t numThreads = 0)
+			: queued(0), running(0), pending(0), sleepers(0), nextWorker(0), terminate(false)
+		{
+			if (numThreads == 0)
+				numThreads = Max<size_t>(std::thread::hardware_concurrency(), 1);
+
+			workers.Reserve(numThreads);
+			for (size_t i = 0; i < numThreads; ++i)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(Worker));
+				if (mem == NULL)
+					break;	// run with fewer workers.
+				Worker* w = new(mem) Worker();
+				w->seed = static_cast<unsigned int>(i * 2654435761U + 1);
+				workers.Add(w);
+			}
+			if (workers.Count() == 0)
+				DKERROR_THROW("Out of memory");
+			numThreads = workers.Count();
+			threads.Reserve(numThreads);
+			for (size_t i = 0; i < numThreads; ++i)
+			{
+				threads.Add(DKThread::Create(DKFunction([this, i]()
+				{
+					this->WorkerProc(i);
+				})->Invocation()));
+			}
+		}
+		~DKWorkStealingQueue(void)
+		{
+			WaitForCompletion();
+
+			parkCond.Lock();
+			terminate = true;
+			parkCond.Broadcast();
+			parkCond.Unlock();
+
+			for (DKObject<DKThread>& t : threads)
+				t->WaitTerminate();
+			threads.Clear();
+
+			for (Worker* w : workers)
+			{
+				w->~Worker();
+				DKMemoryHeapFree(w);
+			}
+		}
+
+		void Post(DKOperation* operation)
+		{
+			Enqueue(operation, NULL, NULL);
+		}
+		DKObject<OperationSync> ProcessAsync(DKOperation* operation)
+		{
+			DKObject<SyncObject> sync = DKOBJECT_NEW SyncObject();
+			Enqueue(operation, sync, NULL);
+			return sync.SafeCast<OperationSync>();
+		}
+		// wait until done.
+		bool Process(DKOperation* operation)
+		{
+			return ProcessAsync(operation)->Sync();
+		}
+		// cancel all operations not started yet.
+		void CancelAllOperations(void)
+		{
+			Task task;
+			for (Worker* w : workers)
+			{
+				while (w->tasks.PopFront(task))
+				{
+					queued.fetch_sub(1);
+					if (task.sync)
+						task.sync->Cancel();
+					Complete(task);
+				}
+			}
+		}
+		// wait until all operations are done.
+		void WaitForCompletion(void) const
+		{
+			completionCond.Lock();
+			while (pending.load() > 0)
+				completionCond.Wait();
+			completionCond.Unlock();
+		}
+
+		size_t QueueLength(void) const
+		{
+			return queued.load(std::memory_order_relaxed);
+		}
+		size_t RunningOperations(void) const
+		{
+			return running.load(std::memory_order_relaxed);
+		}
+		size_t RunningThreads(void) const
+		{
+			return threads.Count();
+		}
+		size_t MaxConcurrentOperations(void) const
+		{
+			return workers.Count();
+		}
+
+	private:
+		enum {SpinCount = 64};
+
+		class SyncObject : public OperationSync
+		{
+		public:
+			enum {StateRunning = StateCancelled + 1};
+			SyncObject(void) : state(StatePending) {}
+			bool Sync(void)
+			{
+				cond.Lock();
+				while (state == StatePending || state == StateRunning)
+					cond.Wait();
+				int s = state;
+				cond.Unlock();
+				return s == StateProcessed;
+			}
+			bool Cancel(void)
+			{
+				return Finish(StatePending, StateCancelled);
+			}
+			State OperationState(void)
+			{
+				int s = state;
+				if (s == StateRunning)
+					return StatePending;
+				return static_cast<State>(s);
+			}
+			bool Begin(void)
+			{
+				int s = StatePending;
+				return state.compare_exchange_strong(s, StateRunning);
+			}
+			bool Finish(int from, int to)
+			{
+				cond.Lock();
+				bool result = state.compare_exchange_strong(from, to);
+				if (result)
+					cond.Broadcast();
+				cond.Unlock();
+				return result;
+			}
+		private:
+			std::atomic<int> state;
+			DKCondition cond;
+		};
+		struct Task
+		{
+			DKObject<DKOperation> operation;
+			DKObject<SyncObject> sync;
+			TaskGroup* group;
+		};
+		struct Worker
+		{
+			DKQueue<Task, DKSpinLock> tasks;
+			unsigned int seed;
+		};
+		struct Context
+		{
+			Context(void) : queue(NULL), index(0) {}
+			DKWorkStealingQueue* queue;
+			size_t index;
+		};
+		typedef DKThreadLocal<Context> ContextLocal;
+		// thread-local storage is created on first use and never destroyed,
+		// it is shared by all queues.
+		template <int N> struct ContextHolder
+		{
+			static std::atomic<ContextLocal*> local;
+		};
+		static ContextLocal* ContextStorage(void)
+		{
+			ContextLocal* local = ContextHolder<0>::local.load(std::memory_order_acquire);
+			if (local == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(ContextLocal));
+				if (mem == NULL)
+					return NULL;
+				ContextLocal* newLocal = new(mem) ContextLocal();
+				if (ContextHolder<0>::local.compare_exchange_strong(local, newLocal, std::memory_order_acq_rel))
+					local = newLocal;
+				else
+				{
+					newLocal->~ContextLocal();
+					DKMemoryHeapFree(newLocal);
+				}
+			}
+			return local;
+		}
+		// worker context of calling thread, NULL if not a worker of this queue.
+		Context* CurrentContext(void) const
+		{
+			ContextLocal* local = ContextStorage();
+			Context* ctxt = local ? local->ValueNoCreate() : NULL;
+			if (ctxt && ctxt->queue == this)
+				return ctxt;
+			return NULL;
+		}
+
+		void Enqueue(DKOperation* operation, SyncObject* sync, TaskGroup* group)
+		{
+			Task task = {operation, sync, group};
+			pending.fetch_add(1);
+			queued.fetch_add(1);
+
+			Context* ctxt = CurrentContext();
+			size_t index = ctxt ? ctxt->index : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.Count();
+			workers.Value(index)->tasks.PushBack(static_cast<Task&&>(task));
+
+			if (sleepers.load() > 0)
+			{
+				parkCond.Lock();
+				parkCond.Signal();
+				parkCond.Unlock();
+			}
+		}
+		// pop from own deque (LIFO), or steal from others (FIFO).
+		bool Dequeue(Context* ctxt, Task& task)
+		{
+			size_t numWorkers = workers.Count();
+			size_t start = 0;
+			if (ctxt)
+			{
+				Worker* w = workers.Value(ctxt->index);
+				if (w->tasks.PopBack(task))
+				{
+					queued.fetch_sub(1);
+					return true;
+				}
+				// xorshift, select random victim.
+				unsigned int x = w->seed;
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				w->seed = x;
+				start = x % numWorkers;
+			}
+			for (size_t i = 0; i < numWorkers; ++i)
+			{
+				Worker* victim = workers.Value((start + i) % numWorkers);
+				if (victim->tasks.PopFront(task))
+				{
+					queued.fetch_sub(1);
+					return true;
+				}
+			}
+			return false;
+		}
+		void Perform(Task& task)
+		{
+			if (task.sync == NULL || task.sync->Begin())
+			{
+				running.fetch_add(1);
+				task.operation->Perform();
+				running.fetch_sub(1);
+				if (task.sync)
+					task.sync->Finish(SyncObject::StateRunning, SyncObject::StateProcessed);
+			}
+			Complete(task);
+		}
+		void Complete(Task& task)
+		{
+			if (task.group)
+				task.group->pending.fetch_sub(1, std::memory_order_release);
+			task.operation = NULL;
+			task.sync = NULL;
+			if (pending.fetch_sub(1) == 1)
+			{
+				completionCond.Lock();
+				completionCond.Broadcast();
+				completionCond.Unlock();
+			}
+		}
+		// perform one pending operation on calling thread. (TaskGroup)
+		bool PerformPending(void)
+		{
+			Task task;
+			if (Dequeue(CurrentContext(), task))
+			{
+				Perform(task);
+				return true;
+			}
+			return false;
+		}
+		void WorkerProc(size_t index)
+		{
+			// without thread-local context, worker still performs tasks,
+			// but tasks posted from it are not pushed to its own deque.
+			Context localContext;
+			ContextLocal* local = ContextStorage();
+			Context* ctxt = local ? local->Value() : NULL;
+			if (ctxt == NULL)
+				ctxt = &localContext;
+			ctxt->queue = this;
+			ctxt->index = index;
+
+			Task task;
+			for (;;)
+			{
+				if (Dequeue(ctxt, task))
+				{
+					Perform(task);
+					continue;
+				}
+				bool found = false;
+				for (int i = 0; i < SpinCount && !found; ++i)
+				{
+					DKThread::Yield();
+					found = queued.load(std::memory_order_relaxed) > 0;
+				}
+				if (found)
+					continue;
+
+				// park until operation posted.
+				parkCond.Lock();
+				sleepers.fetch_add(1);
+				while (queued.load() == 0 && !terminate)
+					parkCond.Wait();
+				sleepers.fetch_sub(1);
+				bool exit = terminate && queued.load() == 0;
+				parkCond.Unlock();
+				if (exit)
+					break;
+			}
+			ctxt->queue = NULL;
+		}
+
+		DKArray<Worker*> workers;
+		DKArray<DKObject<DKThread>> threads;
+		std::atomic<size_t> queued;		// operations in deques
+		std::atomic<size_t> running;	// operations being processed
+		std::atomic<size_t> pending;	// queued + running
+		std::atomic<size_t> sleepers;	// parked workers
+		std::atomic<size_t> nextWorker;
+		bool terminate;
+		DKCondition parkCond;
+		DKCondition completionCond;
+
+		DKWorkStealingQueue(const DKWorkStealingQueue&);
+		DKWorkStealingQueue& operator = (const DKWorkStealingQueue&);
+	};
+	template <int N> std::atomic<DKWorkStealingQueue::ContextLocal*> DKWorkStealingQueue::ContextHolder<N>::local(NULL);
+}
@@ -0,0 +1,430 @@
+//
+//  File: DKZipMappedUnarchiver.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <string.h>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKArray.h"
+#include "DKMap.h"
+#include "DKData.h"
+#include "DKDataStream.h"
+#include "DKDataSlice.h"
+#include "DKBuffer.h"
+#include "DKFileMap.h"
+#include "DKHash.h"
+#include "DKParallel.h"
+#include "DKInflater.h"
+#include "DKZipUnarchiver.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKZipMappedUnarchiver
+// random-access zip reader with memory-mapped archive (DKFileMap).
+//
+// stored (MethodStored) entries are returned as DKDataSlice of mapped file,
+// without decoding or copying.
+// deflated entries are decoded with DKInflater, from mapped file directly.
+// if seekIndexInterval is not zero, each deflated entry larger than interval
+// has seek index (DKInflater::SeekIndex), shared by all streams of entry.
+// seeking stream resumes from nearest checkpoint instead of beginning.
+//
+// Extract() decodes many entries concurrently (DKParallelFor) into caller
+// buffers, without intermediate copy.
+//
+// Example:
+//  DKObject<DKZipMappedUnarchiver> zip = DKZipMappedUnarchiver::Create(path, 256 * 1024);
+//  DKObject<DKData> data = zip->OpenFileData(L"textures/stone.png");  // zero-copy if stored
+//  DKObject<DKStream> stream = zip->OpenFileStream(L"sounds/bgm.ogg");
+//
+//  DKZipMappedUnarchiver::ExtractRequest req[2] = {
+//      {L"a.dat", bufferA, sizeA}, {L"b.dat", bufferB, sizeB}};
+//  zip->Extract(req, 2);   // req[i].result is size or ExtractFailed
+//
+// Note:
+//  encrypted and bzip2 entries are not supported, use DKZipUnarchiver.
+//  CRC is verified by Extract() (optional) and by OpenFileData() for deflated
+//  entries. stored entries (zero-copy) and streams are not verified.
+//  Zip64 is supported, multi-disk (spanned) archive is not supported.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKZipMappedUnarchiver
+	{
+	public:
+		typedef DKZipUnarchiver::FileInfo FileInfo;
+		typedef DKZipUnarchiver::Method Method;
+
+		enum : size_t {ExtractFailed = (size_t)-1};
+		struct ExtractRequest
+		{
+			DKString file;
+			void* buffer;		// should be uncompressedSize bytes at least.
+			size_t bufferSize;
+			size_t result;		// extracted bytes, ExtractFailed on error.
+		};
+
+		~DKZipMappedUnarchiver(void)
+		{
+			if (mapped)
+				mapped->UnlockShared();
+		}
+
+		static DKObject<DKZipMappedUnarchiver> Create(const DKString& file, size_t seekIndexInterval = 0)
+		{
+			DKObject<DKFileMap> map = DKFileMap::Open(file, 0, false);
+			if (map == NULL)
+				return NULL;
+			DKObject<DKZipMappedUnarchiver> zip = DKOBJECT_NEW DKZipMappedUnarchiver(map, file);
+			if (zip->base && zip->ReadCentralDirectory(seekIndexInterval))
+				return zip;
+			return NULL;
+		}
+
+		const DKArray<FileInfo>& GetFileList(void) const	{return files;}
+		const FileInfo* GetFileInfo(const DKString& file) const
+		{
+			const Entry* e = FindEntry(file);
+			if (e)
+				return &files.Value(e->index);
+			return NULL;
+		}
+
+		// stored content, slice of mapped file. (no copy)
+		// NULL if entry is not stored.
+		DKObject<DKDataSlice> OpenStoredData(const DKString& file) const
+		{
+			const Entry* e = FindEntry(file);
+			if (e && files.Value(e->index).method == DKZipUnarchiver::MethodStored)
+				return CompressedData(*e);
+			return NULL;
+		}
+		// content of file, stored entry is returned without copying,
+		// deflated entry is decoded into DKBuffer.
+		DKObject<DKData> OpenFileData(const DKString& file) const
+		{
+			const Entry* e = FindEntry(file);
+			if (e)
+			{
+				const FileInfo& info = files.Value(e->index);
+				DKObject<DKDataSlice> raw = CompressedData(*e);
+				if (raw == NULL)
+					return NULL;
+				if (info.method == DKZipUnarchiver::MethodStored)
+					return raw.SafeCast<DKData>();
+				if (info.method == DKZipUnarchiver::MethodDeflated)
+				{
+					DKObject<DKBuffer> buffer = DKBuffer::Create(NULL, info.uncompressedSize);
+					if (buffer)
+					{
+						bool valid = false;
+						void* p = buffer->LockExclusive();
+						if (p || info.uncompressedSize == 0)
+						{
+							DKDataReader reader(raw);
+							DKObject<DKInflater> inflater = DKOBJECT_NEW DKInflater(reader, info.compressedSize);
+							size_t decoded = inflater->Inflate(p, info.uncompressedSize);
+							valid = !inflater->IsError() && decoded == info.uncompressedSize &&
+								(decoded == 0 || DKHashCRC32(p, decoded).digest[0] == info.crc32);
+						}
+						buffer->UnlockExclusive();
+						if (valid)
+							return buffer.SafeCast<DKData>();
+					}
+				}
+			}
+			return NULL;
+		}
+		// seekable stream of file content.
+		DKObject<DKStream> OpenFileStream(const DKString& file) const
+		{
+			const Entry* e = FindEntry(file);
+			if (e)
+			{
+				const FileInfo& info = files.Value(e->index);
+				DKObject<DKDataSlice> raw = CompressedData(*e);
+				if (raw == NULL)
+					return NULL;
+				if (info.method == DKZipUnarchiver::MethodStored)
+					return DKOBJECT_NEW DKDataStream(raw);
+				if (info.method == DKZipUnarchiver::MethodDeflated)
+				{
+					DKObject<DKInflateStream> stream = DKOBJECT_NEW DKInflateStream(raw, info.uncompressedSize, const_cast<DKInflater::SeekIndex*>(e->seekIndex.Ptr()));
+					if (!stream->IsError())
+						return stream.SafeCast<DKStream>();
+				}
+			}
+			return NULL;
+		}
+
+		// extract files into request buffers concurrently,
+		// returns number of files extracted successfully.
+		size_t Extract(ExtractRequest* requests, size_t count, bool verifyCRC = true) const
+		{
+			DKAtomicNumber32 succeeded = 0;
+			DKParallelFor(0, count, [&](size_t i)
+			{
+				ExtractRequest& req = requests[i];
+				req.result = ExtractFailed;
+				const Entry* e = FindEntry(req.file);
+				if (e == NULL)
+					return;
+				const FileInfo& info = files.Value(e->index);
+				if (info.uncompressedSize > req.bufferSize || (req.buffer == NULL && info.uncompressedSize > 0))
+					return;
+				DKObject<DKDataSlice> raw = CompressedData(*e);
+				if (raw == NULL)
+					return;
+
+				size_t decoded = 0;
+				const void* p = raw->LockShared();
+				if (info.method == DKZipUnarchiver::MethodStored)
+				{
+					if (p && info.uncompressedSize == info.compressedSize)
+					{
+						memcpy(req.buffer, p, info.uncompressedSize);
+						decoded = info.uncompressedSize;
+					}
+				}
+				else if (info.method == DKZipUnarchiver::MethodDeflated)
+				{
+					if (p || info.compressedSize == 0)
+					{
+						DKObject<DKInflater> inflater = DKOBJECT_NEW DKInflater(p, info.compressedSize);
+						decoded = inflater->Inflate(req.buffer, info.uncompressedSize);
+						if (inflater->IsError())
+							decoded = ExtractFailed;
+					}
+				}
+				raw->UnlockShared();
+				if (decoded != info.uncompressedSize)
+					return;
+				if (verifyCRC && decoded > 0 && DKHashCRC32(req.buffer, decoded).digest[0] != info.crc32)
+					return;
+				req.result = decoded;
+				succeeded.Increment();
+			});
+			return (size_t)(unsigned int)succeeded;
+		}
+
+		const DKString& GetArchiveName(void) const		{return filename;}
+
+	private:
+		struct Entry
+		{
+			size_t index;			// index of files
+			uint64_t localHeader;	// offset of local file header
+			DKObject<DKInflater::SeekIndex> seekIndex;
+		};
+
+		DKZipMappedUnarchiver(DKFileMap* map, const DKString& file)
+			: mapped(map), filename(file), base(NULL), length(0)
+		{
+			base = reinterpret_cast<const unsigned char*>(mapped->LockShared());
+			length = mapped->Length();
+			if (base == NULL)
+			{
+				mapped->UnlockShared();
+				mapped = NULL;
+			}
+		}
+
+		static unsigned int Read16(const unsigned char* p)
+		{
+			return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+		}
+		static uint32_t Read32(const unsigned char* p)
+		{
+			return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+		static uint64_t Read64(const unsigned char* p)
+		{
+			return (uint64_t)Read32(p) | ((uint64_t)Read32(p + 4) << 32);
+		}
+
+		bool ReadCentralDirectory(size_t seekIndexInterval)
+		{
+			enum
+			{
+				EndOfCentralDirSignature = 0x06054b50,
+				Zip64EndOfCentralDirSignature = 0x06064b50,
+				Zip64LocatorSignature = 0x07064b50,
+				CentralDirSignature = 0x02014b50,
+				EndOfCentralDirSize = 22,
+				CentralDirHeaderSize = 46,
+			};
+			if (length < EndOfCentralDirSize)
+				return false;
+
+			// find end of central directory record. (comment length up to 0xffff)
+			const unsigned char* eocd = NULL;
+			size_t searchEnd = length > EndOfCentralDirSize + 0xffff ? length - EndOfCentralDirSize - 0xffff : 0;
+			for (size_t pos = length - EndOfCentralDirSize + 1; pos-- > searchEnd; )
+			{
+				if (Read32(base + pos) == EndOfCentralDirSignature)
+				{
+					eocd = base + pos;
+					break;
+				}
+			}
+			if (eocd == NULL)
+				return false;
+
+			uint64_t numEntries = Read16(eocd + 10);
+			uint64_t dirSize = Read32(eocd + 12);
+			uint64_t dirOffset = Read32(eocd + 16);
+			if (numEntries == 0xffff || dirSize == 0xffffffff || dirOffset == 0xffffffff)
+			{
+				size_t eocdPos = eocd - base;
+				if (eocdPos >= 20 && Read32(eocd - 20) == Zip64LocatorSignature)
+				{
+					uint64_t pos = Read64(eocd - 20 + 8);
+					if (pos > length || 56 > length - pos || Read32(base + pos) != Zip64EndOfCentralDirSignature)
+						return false;
+					numEntries = Read64(base + pos + 32);
+					dirSize = Read64(base + pos + 40);
+					dirOffset = Read64(base + pos + 48);
+				}
+			}
+			if (dirOffset > length || dirSize > length - dirOffset)
+				return false;
+
+			// entry count is not trusted, directory cannot have more records
+			// than it can hold.
+			size_t capacity = (size_t)Min<uint64_t>(numEntries, dirSize / CentralDirHeaderSize);
+			files.Reserve(capacity);
+			entries.Reserve(capacity);
+			const unsigned char* p = base + dirOffset;
+			const unsigned char* end = p + dirSize;
+			for (uint64_t i = 0; i < numEntries; ++i)
+			{
+				if (p + CentralDirHeaderSize > end || Read32(p) != CentralDirSignature)
+					return false;
+				unsigned int flags = Read16(p + 8);
+				unsigned int method = Read16(p + 10);
+				unsigned int time = Read16(p + 12);
+				unsigned int date = Read16(p + 14);
+				uint64_t compressedSize = Read32(p + 20);
+				uint64_t uncompressedSize = Read32(p + 24);
+				unsigned int nameLength = Read16(p + 28);
+				unsigned int extraLength = Read16(p + 30);
+				unsigned int commentLength = Read16(p + 32);
+				uint64_t localHeader = Read32(p + 42);
+				const unsigned char* name = p + CentralDirHeaderSize;
+				const unsigned char* extra = name + nameLength;
+				if (extra + extraLength + commentLength > end)
+					return false;
+
+				// zip64 extended information
+				for (const unsigned char* x = extra; x + 4 <= extra + extraLength; )
+				{
+					unsigned int id = Read16(x);
+					unsigned int size = Read16(x + 2);
+					const unsigned char* field = x + 4;
+					const unsigned char* fieldEnd = Min(field + size, extra + extraLength);
+					if (id == 0x0001)
+					{
+						if (uncompressedSize == 0xffffffff && field + 8 <= fieldEnd)
+						{
+							uncompressedSize = Read64(field);
+							field += 8;
+						}
+						if (compressedSize == 0xffffffff && field + 8 <= fieldEnd)
+						{
+							compressedSize = Read64(field);
+							field += 8;
+						}
+						if (localHeader == 0xffffffff && field + 8 <= fieldEnd)
+							localHeader = Read64(field);
+						break;
+					}
+					x = field + size;
+				}
+
+				FileInfo info;
+				info.uncompressedSize = (size_t)uncompressedSize;
+				info.compressedSize = (size_t)compressedSize;
+				info.compressLevel = 0;
+				info.date = DKDateTime((date >> 9) + 1980, (date >> 5) & 15, date & 31,
+									   time >> 11, (time >> 5) & 63, (time & 31) * 2, 0);
+				info.name = DKString((const DKUniChar8*)name, nameLength);
+				info.directory = nameLength > 0 && name[nameLength - 1] == '/';
+				info.crypted = (flags & 1) != 0;
+				info.crc32 = Read32(p + 16);
+				switch (method)
+				{
+				case 0:		info.method = DKZipUnarchiver::MethodStored;	break;
+				case 8:
+					info.method = DKZipUnarchiver::MethodDeflated;
+					switch ((flags >> 1) & 3)
+					{
+					case 1:		info.compressLevel = 9;	break;	// maximum
+					case 2:		info.compressLevel = 2;	break;	// fast
+					case 3:		info.compressLevel = 1;	break;	// super fast
+					default:	info.compressLevel = 6;	break;	// normal
+					}
+					break;
+				case 12:	info.method = DKZipUnarchiver::MethodBZip2ed;	break;
+				default:	info.method = DKZipUnarchiver::MethodUnknown;	break;
+				}
+
+				Entry entry;
+				entry.index = files.Count();
+				entry.localHeader = localHeader;
+				if (seekIndexInterval > 0 && info.method == DKZipUnarchiver::MethodDeflated && info.uncompressedSize > seekIndexInterval)
+					entry.seekIndex = DKOBJECT_NEW DKInflater::SeekIndex(seekIndexInterval);
+
+				nameIndex.Update(info.name, entries.Count());
+				files.Add(info);
+				entries.Add(entry);
+
+				p = extra + extraLength + commentLength;
+			}
+			return true;
+		}
+
+		const Entry* FindEntry(const DKString& file) const
+		{
+			const DKMap<DKString, size_t>::Pair* pair = nameIndex.Find(file);
+			if (pair)
+				return &entries.Value(pair->value);
+			return NULL;
+		}
+		// compressed content. (stored content if not compressed)
+		DKObject<DKDataSlice> CompressedData(const Entry& e) const
+		{
+			enum
+			{
+				LocalHeaderSignature = 0x04034b50,
+				LocalHeaderSize = 30,
+			};
+			const FileInfo& info = files.Value(e.index);
+			if (info.crypted)
+				return NULL;
+			// local header has its own name and extra field length.
+			if (e.localHeader > length || LocalHeaderSize > length - e.localHeader || Read32(base + e.localHeader) != LocalHeaderSignature)
+				return NULL;
+			const unsigned char* local = base + e.localHeader;
+			uint64_t dataOffset = e.localHeader + LocalHeaderSize + Read16(local + 26) + Read16(local + 28);
+			if (dataOffset > length || info.compressedSize > length - dataOffset)
+				return NULL;
+			return DKDataSlice::Create(const_cast<DKFileMap*>(mapped.Ptr()), (size_t)dataOffset, info.compressedSize);
+		}
+
+		DKObject<DKFileMap> mapped;		// locked (shared) while alive
+		DKString filename;
+		const unsigned char* base;
+		size_t length;
+		DKArray<FileInfo> files;
+		DKArray<Entry> entries;
+		DKMap<DKString, size_t> nameIndex;
+
+		DKZipMappedUnarchiver(const DKZipMappedUnarchiver&);
+		DKZipMappedUnarchiver& operator = (const DKZipMappedUnarchiver&);
+	};
+}
@@ -0,0 +1,671 @@
+//
+//  File: DKBufferedLog.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <string.h>
+#include <wchar.h>
+#include <atomic>
+#include <tuple>
+#include <type_traits>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKLog.h"
+#include "DKThread.h"
+#include "DKThreadLocal.h"
+#include "DKCondition.h"
+#include "DKSpinLock.h"
+#include "DKCriticalSection.h"
+#include "DKFunction.h"
+#include "DKArray.h"
+#include "DKSmallArray.h"
+#include "DKMemory.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKBufferedLogger
+// asynchronous logger, formats and outputs log messages on background thread.
+//
+// each thread writes log records into own ring buffer without locking.
+// record holds format string (pointer, must be string literal or static) and
+// arguments only, formatting is deferred to flushing thread. flushing thread
+// wakes periodically (or when buffer is half full, or error logged) and
+// delivers formatted messages to output logger in one batch.
+//
+// arguments can be scalar types, pointers, C-strings (const char*,
+// const wchar_t*) or DKString. strings are copied into buffer.
+// other types are rejected at compile time, convert to DKString first.
+// if buffer is full, message is discarded and counted. (DroppedMessages)
+// messages larger than half of buffer are formatted and delivered
+// immediately by calling thread.
+//
+// DKBufferedLogger can be installed as current logger, then messages from
+// DKLog() are buffered also. (formatted by calling thread)
+//
+// log levels:
+//  DKLOG_INFO, DKLOG_WARNING, DKLOG_ERROR macros with printf-style format.
+//  DKLOG_DEBUG of DKLog.h is not changed, define DKLOG_BUFFERED_DEBUG
+//  before including this file to redirect DKLOG_DEBUG to debug level.
+//  levels below DKLOG_LEVEL_MIN are removed at compile time.
+//  (DKLOG_LEVEL_MIN is 0(debug) for debug build, 1(info) for release build)
+//  if no buffered logger installed, messages are logged with DKLog().
+//  if logger has no output logger and no previous logger, formatted
+//  messages are written to stderr.
+//
+// Note:
+//  logger should not be uninstalled or destroyed while other threads are
+//  logging with it. (install at startup, uninstall at shutdown)
+//  output logger must not log with installed DKBufferedLogger.
+//
+// Example:
+//  DKBufferedLogger logger(&fileLogger);
+//  logger.Install();
+//  DKLOG_INFO("Texture loaded: %ls (%dx%d)\n", (const wchar_t*)path, w, h);
+//  logger.Uninstall();   // flush remaining messages.
+////////////////////////////////////////////////////////////////////////////////
+
+#define DKLOG_LEVEL_DEBUG		0
+#define DKLOG_LEVEL_INFO		1
+#define DKLOG_LEVEL_WARNING		2
+#define DKLOG_LEVEL_ERROR		3
+
+#ifndef DKLOG_LEVEL_MIN
+#ifdef DKLIB_DEBUG_ENABLED
+#define DKLOG_LEVEL_MIN		DKLOG_LEVEL_DEBUG
+#else
+#define DKLOG_LEVEL_MIN		DKLOG_LEVEL_INFO
+#endif
+#endif
+
+namespace DKFoundation
+{
+	enum DKLogLevel
+	{
+		DKLogLevelDebug = DKLOG_LEVEL_DEBUG,
+		DKLogLevelInfo = DKLOG_LEVEL_INFO,
+		DKLogLevelWarning = DKLOG_LEVEL_WARNING,
+		DKLogLevelError = DKLOG_LEVEL_ERROR,
+	};
+
+	namespace Private
+	{
+		// stored argument of log record.
+		// Stored: value stored in record
+		// Extra: additional bytes required (string)
+		// Load: value passed to formatter
+		// Pass: value passed to formatter directly (without buffering)
+		template <typename T, bool Scalar = std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value>
+		struct LogArgument;
+
+		template <typename T> struct LogArgument<T, true>
+		{
+			typedef T Stored;
+			static size_t Extra(T) {return 0;}
+			static T Store(T v, unsigned char*, size_t&) {return v;}
+			static T Load(T v, const unsigned char*) {return v;}
+			static T Pass(T v) {return v;}
+		};
+
+		template <typename C> struct LogStringArgument
+		{
+			typedef uint32_t Stored;	// offset of string in record, 0 for NULL.
+			static size_t Length(const char* s) {return ::strlen(s);}
+			static size_t Length(const wchar_t* s) {return ::wcslen(s);}
+			static const C* NullString(const char*) {return "(null)";}
+			static const C* NullString(const wchar_t*) {return L"(null)";}
+
+			static size_t Extra(const C* s)
+			{
+				if (s)
+					return (Length(s) + 1) * sizeof(C) + sizeof(C) - 1;
+				return 0;
+			}
+			static uint32_t Store(const C* s, unsigned char* base, size_t& offset)
+			{
+				if (s == NULL)
+					return 0;
+				offset = (offset + sizeof(C) - 1) & ~(sizeof(C) - 1);
+				size_t bytes = (Length(s) + 1) * sizeof(C);
+				memcpy(&base[offset], s, bytes);
+				uint32_t pos = (uint32_t)offset;
+				offset += bytes;
+				return pos;
+			}
+			static const C* Load(uint32_t pos, const unsigned char* base)
+			{
+				if (pos)
+					return reinterpret_cast<const C*>(&base[pos]);
+				return NullString((const C*)0);
+			}
+			static const C* Pass(const C* s)
+			{
+				return s ? s : NullString((const C*)0);
+			}
+		};
+		template <> struct LogArgument<char*, true> : public LogStringArgument<char> {};
+		template <> struct LogArgument<const char*, true> : public LogStringArgument<char> {};
+		template <> struct LogArgument<wchar_t*, true> : public LogStringArgument<wchar_t> {};
+		template <> struct LogArgument<const wchar_t*, true> : public LogStringArgument<wchar_t> {};
+		template <typename T> struct LogArgument<T, false>
+		{
+			static_assert(!std::is_same<T, T>::value, "Log argument must be scalar, pointer, C-string or DKString.");
+			typedef int Stored;
+			static size_t Extra(const T&) {return 0;}
+			static int Store(const T&, unsigned char*, size_t&) {return 0;}
+			static int Load(int v, const unsigned char*) {return v;}
+			static int Pass(const T&) {return 0;}
+		};
+		template <> struct LogArgument<DKString, false> : public LogStringArgument<DKUniCharW>
+		{
+			static size_t Extra(const DKString& s)
+			{
+				return LogStringArgument::Extra((const DKUniCharW*)s);
+			}
+			static uint32_t Store(const DKString& s, unsigned char* base, size_t& offset)
+			{
+				return LogStringArgument::Store((const DKUniCharW*)s, base, offset);
+			}
+			static const DKUniCharW* Pass(const DKString& s)
+			{
+				return LogStringArgument::Pass((const DKUniCharW*)s);
+			}
+		};
+
+		template <size_t...> struct LogIndexSequence {};
+		template <size_t N, size_t... I> struct LogIndices : LogIndices<N-1, N-1, I...> {};
+		template <size_t... I> struct LogIndices<0, I...> { typedef LogIndexSequence<I...> Type; };
+
+		// record layout: Stored(tuple) + extra data (strings)
+		template <typename... Args> struct LogRecord
+		{
+			typedef std::tuple<typename LogArgument<Args>::Stored...> Stored;
+			static_assert(std::is_trivially_destructible<Stored>::value, "Invalid argument type");
+
+			static size_t Length(const Args&... args)
+			{
+				size_t extra[] = {0, LogArgument<Args>::Extra(args)...};
+				size_t length = sizeof(Stored);
+				for (size_t n : extra)
+					length += n;
+				return length;
+			}
+			static void Store(unsigned char* data, const Args&... args)
+			{
+				size_t offset = sizeof(Stored);
+				new(data) Stored(LogArgument<Args>::Store(args, data, offset)...);
+			}
+			static void Format(const unsigned char* data, const char* fmt, DKString& output)
+			{
+				FormatIndexed(data, fmt, output, typename LogIndices<sizeof...(Args)>::Type());
+			}
+			template <size_t... I> static void FormatIndexed(const unsigned char* data, const char* fmt, DKString& output, LogIndexSequence<I...>)
+			{
+				const Stored& s = *reinterpret_cast<const Stored*>(data);
+				output.Append(DKString::Format(fmt, LogArgument<Args>::Load(std::get<I>(s), data)...));
+			}
+		};
+		template <> struct LogRecord<>
+		{
+			static size_t Length(void) {return 0;}
+			static void Store(unsigned char*) {}
+			static void Format(const unsigned char*, const char* fmt, DKString& output)
+			{
+				output.Append(DKString::Format(fmt));
+			}
+		};
+	}
+
+	class DKBufferedLogger : public DKLogger
+	{
+	public:
+		enum {DefaultBufferSize = 0x10000};
+
+		// output: logger which receives formatted messages. (NULL for previous logger)
+		// bufferSize: ring buffer size of each thread.
+		// interval: maximum delay of flushing.
+		DKBufferedLogger(DKLogger* output = NULL, size_t bufferSize = DefaultBufferSize, double interval = 0.1)
+			: outputLogger(output)
+			, previousLogger(NULL)
+			, bufferCapacity(RoundUpCapacity(bufferSize))
+			, flushInterval(interval)
+			, minimumLevel(DKLogLevelDebug)
+			, loggerId(++LoggerCounter<0>::counter)
+			, buffers(NULL)
+			, dropped(0)
+			, flushRequested(false)
+			, requestedPasses(0)
+			, completedPasses(0)
+			, terminate(false)
+		{
+			flushThread = DKThread::Create(DKFunction(this, &DKBufferedLogger::FlushThreadProc)->Invocation());
+		}
+		~DKBufferedLogger(void)
+		{
+			Uninstall();
+
+			flushCond.Lock();
+			terminate = true;
+			flushCond.Signal();
+			flushCond.Unlock();
+			if (flushThread)
+				flushThread->WaitTerminate();
+
+			DKCriticalSection<DKSpinLock> guard(bufferLock);
+			FlushBuffers();
+			while (buffers)
+			{
+				ThreadBuffer* buffer = buffers;
+				buffers = buffer->next;
+				buffer->detached.store(true, std::memory_order_release);
+				buffer->Release();
+			}
+		}
+
+		// set this logger as current logger. (DKLoggerSet)
+		void Install(void)
+		{
+			DKLogger* prev = DKLoggerCurrent();
+			if (prev != this)
+			{
+				previousLogger = prev;
+				DKLoggerSet(this);
+			}
+			DKBufferedLogger* expected = NULL;
+			ActiveLogger<0>::logger.compare_exchange_strong(expected, this);
+		}
+		// restore previous logger, flush all messages.
+		void Uninstall(void)
+		{
+			DKBufferedLogger* expected = this;
+			ActiveLogger<0>::logger.compare_exchange_strong(expected, NULL);
+			if (DKLoggerCompareAndReplace(this, previousLogger))
+				Flush();
+		}
+		// buffered logger receives DKLOG_ macros.
+		static DKBufferedLogger* Active(void)
+		{
+			return ActiveLogger<0>::logger.load(std::memory_order_acquire);
+		}
+
+		// runtime filtering, messages below level are discarded.
+		void SetLevel(DKLogLevel level)			{minimumLevel.store(level, std::memory_order_relaxed);}
+		DKLogLevel Level(void) const			{return minimumLevel.load(std::memory_order_relaxed);}
+
+		// number of messages discarded. (buffer was full)
+		size_t DroppedMessages(void) const		{return dropped.load(std::memory_order_relaxed);}
+
+		// DKLogger interface, message formatted already.
+		void Log(const DKString& str)
+		{
+			Write(DKLogLevelInfo, "%ls", str);
+		}
+
+		// buffer log record of current thread, returns false if discarded.
+		template <typename... Args> bool Write(DKLogLevel level, const char* fmt, const Args&... args)
+		{
+			typedef Private::LogRecord<typename std::decay<const Args>::type...> Record;
+
+			if (level < minimumLevel.load(std::memory_order_relaxed))
+				return false;
+
+			size_t length = (sizeof(RecordHeader) + Record::Length(args...) + RecordAlignment - 1) & ~(RecordAlignment - 1);
+			ThreadBuffer* buffer = NULL;
+			if (length <= bufferCapacity / 2)
+				buffer = ThreadBufferForCurrentThread();
+			if (buffer == NULL)
+			{
+				// too large to buffer (or no buffer), output immediately.
+				DKString str;
+				str.Append(DKString::Format(fmt, Private::LogArgument<typename std::decay<const Args>::type>::Pass(args)...));
+				Output(str);
+				return true;
+			}
+
+			size_t tail = buffer->tail.load(std::memory_order_relaxed);
+			size_t head = buffer->head.load(std::memory_order_acquire);
+			size_t offset = tail & (bufferCapacity - 1);
+			size_t contiguous = bufferCapacity - offset;
+			size_t total = length;
+			if (contiguous < length)	// wrap around, skip to beginning.
+				total += contiguous;
+
+			if (tail + total - head > bufferCapacity)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				RequestFlush();
+				return false;
+			}
+			if (contiguous < length)
+			{
+				if (contiguous >= sizeof(RecordHeader))
+				{
+					RecordHeader* padding = reinterpret_cast<RecordHeader*>(&buffer->data[offset]);
+					padding->length = (uint32_t)contiguous;
+					padding->level = 0;
+					padding->format = NULL;
+					padding->fmt = NULL;
+				}
+				offset = 0;
+			}
+			RecordHeader* header = reinterpret_cast<RecordHeader*>(&buffer->data[offset]);
+			header->length = (uint32_t)length;
+			header->level = (uint32_t)level;
+			header->format = &Record::Format;
+			header->fmt = fmt;
+			Record::Store(reinterpret_cast<unsigned char*>(&header[1]), args...);
+
+			buffer->tail.store(tail + total, std::memory_order_release);
+
+			if (level >= DKLogLevelError || tail + total - head > bufferCapacity / 2)
+				RequestFlush();
+			return true;
+		}
+
+		// output all messages buffered before calling.
+		void Flush(void)
+		{
+			flushCond.Lock();
+			uint64_t pass = ++requestedPasses;
+			flushCond.Signal();
+			while (completedPasses < pass && flushThread && flushThread->IsAlive())
+				flushCond.Wait();
+			flushCond.Unlock();
+		}
+
+	private:
+		enum {RecordAlignment = 8};
+		typedef void (*FormatProc)(const unsigned char*, const char*, DKString&);
+
+		struct RecordHeader
+		{
+			uint32_t length;		// bytes including header
+			uint32_t level;
+			FormatProc format;		// NULL for padding
+			const char* fmt;
+		};
+		// ring buffer of one thread, single producer (owner thread)
+		// single consumer (flushing thread).
+		// released by logger and owner thread both.
+		struct ThreadBuffer
+		{
+			ThreadBuffer(size_t capacity)
+				: data(reinterpret_cast<unsigned char*>(DKMemoryHeapAlloc(capacity)))
+				, head(0), tail(0), refCount(2), detached(false), next(NULL)
+			{
+			}
+			~ThreadBuffer(void)
+			{
+				DKMemoryHeapFree(data);
+			}
+			void Release(void)
+			{
+				if (refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					this->~ThreadBuffer();
+					DKMemoryHeapFree(this);
+				}
+			}
+			unsigned char* data;
+			std::atomic<size_t> head;	// read position (consumer)
+			char pad[64];				// avoid false sharing
+			std::atomic<size_t> tail;	// write position (producer)
+			std::atomic<int> refCount;
+			std::atomic<bool> detached;	// logger destroyed
+			ThreadBuffer* next;			// guarded by bufferLock
+		};
+		// buffers of current thread, for each logger.
+		struct ThreadContext
+		{
+			struct Entry
+			{
+				uint64_t loggerId;
+				ThreadBuffer* buffer;
+			};
+			~ThreadContext(void)
+			{
+				for (Entry& e : entries)
+					e.buffer->Release();
+			}
+			DKSmallArray<Entry, 2> entries;
+		};
+		typedef DKThreadLocal<ThreadContext> ThreadContextLocal;
+		// thread-local storage is created on first use and never destroyed,
+		// logging is safe while other global objects being constructed.
+		template <int N> struct ThreadContextHolder
+		{
+			static std::atomic<ThreadContextLocal*> local;
+		};
+		template <int N> struct ActiveLogger
+		{
+			static std::atomic<DKBufferedLogger*> logger;
+		};
+		template <int N> struct LoggerCounter
+		{
+			static std::atomic<uint64_t> counter;
+		};
+
+		static size_t RoundUpCapacity(size_t size)
+		{
+			size_t capacity = 0x1000;
+			while (capacity < size)
+				capacity <<= 1;
+			return capacity;
+		}
+
+		static ThreadContextLocal* ContextLocal(void)
+		{
+			ThreadContextLocal* local = ThreadContextHolder<0>::local.load(std::memory_order_acquire);
+			if (local == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(ThreadContextLocal));
+				if (mem == NULL)
+					return NULL;
+				ThreadContextLocal* newLocal = new(mem) ThreadContextLocal();
+				if (ThreadContextHolder<0>::local.compare_exchange_strong(local, newLocal, std::memory_order_acq_rel))
+					local = newLocal;
+				else
+				{
+					newLocal->~ThreadContextLocal();
+					DKMemoryHeapFree(newLocal);
+				}
+			}
+			return local;
+		}
+
+		// buffer of current thread, NULL if cannot be allocated.
+		ThreadBuffer* ThreadBufferForCurrentThread(void)
+		{
+			ThreadContextLocal* local = ContextLocal();
+			ThreadContext* ctxt = local ? local->Value() : NULL;
+			if (ctxt == NULL)
+				return NULL;
+			for (size_t i = 0; i < ctxt->entries.Count(); ++i)
+			{
+				ThreadContext::Entry& e = ctxt->entries.Value(i);
+				if (e.loggerId == loggerId)
+					return e.buffer;
+				if (e.buffer->detached.load(std::memory_order_acquire))
+				{
+					// logger has been destroyed.
+					e.buffer->Release();
+					ctxt->entries.Remove(i--);
+				}
+			}
+			void* mem = DKMemoryHeapAlloc(sizeof(ThreadBuffer));
+			if (mem == NULL)
+				return NULL;
+			ThreadBuffer* buffer = new(mem) ThreadBuffer(bufferCapacity);
+			ThreadContext::Entry e = {loggerId, buffer};
+			ctxt->entries.Add(e);
+
+			DKCriticalSection<DKSpinLock> guard(bufferLock);
+			buffer->next = buffers;
+			buffers = buffer;
+			return buffer;
+		}
+
+		void RequestFlush(void)
+		{
+			if (!flushRequested.exchange(true, std::memory_order_acq_rel))
+			{
+				flushCond.Lock();
+				flushCond.Signal();
+				flushCond.Unlock();
+			}
+		}
+
+		// format records of buffer, append to output.
+		void Drain(ThreadBuffer* buffer, DKString& output)
+		{
+			size_t head = buffer->head.load(std::memory_order_relaxed);
+			size_t tail = buffer->tail.load(std::memory_order_acquire);
+			while (head != tail)
+			{
+				size_t offset = head & (bufferCapacity - 1);
+				size_t contiguous = bufferCapacity - offset;
+				if (contiguous < sizeof(RecordHeader))
+				{
+					head += contiguous;
+					continue;
+				}
+				const RecordHeader* header = reinterpret_cast<const RecordHeader*>(&buffer->data[offset]);
+				if (header->format)
+					header->format(reinterpret_cast<const unsigned char*>(&header[1]), header->fmt, output);
+				head += header->length;
+			}
+			buffer->head.store(head, std::memory_order_release);
+		}
+
+		// drain all buffers, release buffers of terminated threads.
+		// bufferLock should be locked.
+		void FlushBuffers(void)
+		{
+			DKString output;
+			ThreadBuffer** link = &buffers;
+			while (*link)
+			{
+				ThreadBuffer* buffer = *link;
+				// owner thread has been terminated, nothing will be written.
+				bool orphaned = buffer->refCount.load(std::memory_order_acquire) == 1;
+
+				Drain(buffer, output);
+
+				if (orphaned)
+				{
+					*link = buffer->next;
+					buffer->Release();
+				}
+				else
+					link = &buffer->next;
+			}
+			if (output.Length() > 0)
+				Output(output);
+		}
+
+		void Output(const DKString& str)
+		{
+			DKCriticalSection<DKSpinLock> guard(outputLock);
+			DKLogger* logger = outputLogger ? outputLogger : previousLogger;
+			if (logger && logger != this)
+				logger->Log(str);
+			else
+			{
+				// DKLog() cannot be used, it comes back to this logger if installed.
+				DKStringU8 text((const DKUniCharW*)str);
+				fputs((const char*)text, stderr);
+				fflush(stderr);
+			}
+		}
+
+		void FlushThreadProc(void)
+		{
+			flushCond.Lock();
+			while (!terminate)
+			{
+				if (requestedPasses == completedPasses && !flushRequested.load(std::memory_order_acquire))
+					flushCond.WaitTimeout(flushInterval);
+
+				uint64_t pass = requestedPasses;
+				flushRequested.store(false, std::memory_order_release);
+				flushCond.Unlock();
+
+				bufferLock.Lock();
+				FlushBuffers();
+				bufferLock.Unlock();
+
+				flushCond.Lock();
+				completedPasses = pass;
+				flushCond.Broadcast();
+			}
+			flushCond.Unlock();
+		}
+
+		DKLogger* outputLogger;
+		DKLogger* previousLogger;
+		const size_t bufferCapacity;
+		const double flushInterval;
+		std::atomic<DKLogLevel> minimumLevel;
+		const uint64_t loggerId;
+
+		ThreadBuffer* buffers;
+		DKSpinLock bufferLock;
+		DKSpinLock outputLock;
+		std::atomic<size_t> dropped;
+		std::atomic<bool> flushRequested;
+
+		DKCondition flushCond;
+		uint64_t requestedPasses;
+		uint64_t completedPasses;
+		bool terminate;
+		DKObject<DKThread> flushThread;
+
+		DKBufferedLogger(const DKBufferedLogger&);
+		DKBufferedLogger& operator = (const DKBufferedLogger&);
+	};
+	template <int N> std::atomic<DKBufferedLogger::ThreadContextLocal*> DKBufferedLogger::ThreadContextHolder<N>::local(NULL);
+	template <int N> std::atomic<DKBufferedLogger*> DKBufferedLogger::ActiveLogger<N>::logger(NULL);
+	template <int N> std::atomic<uint64_t> DKBufferedLogger::LoggerCounter<N>::counter(0);
+
+	// write log message with level.
+	// buffered if DKBufferedLogger installed, otherwise DKLog() is used.
+	template <typename... Args> void DKLogWrite(DKLogLevel level, const char* fmt, const Args&... args)
+	{
+		DKBufferedLogger* logger = DKBufferedLogger::Active();
+		if (logger)
+			logger->Write(level, fmt, args...);
+		else
+			DKLog(fmt, Private::LogArgument<typename std::decay<const Args>::type>::Pass(args)...);
+	}
+	inline void DKLogWrite(DKLogLevel level, const DKString& str)
+	{
+		DKBufferedLogger* logger = DKBufferedLogger::Active();
+		if (logger)
+			logger->Write(level, "%ls", str);
+		else
+			DKLog(str);
+	}
+}
+
+#ifdef DKLOG_BUFFERED_DEBUG
+#undef DKLOG_DEBUG
+#if DKLOG_LEVEL_MIN <= DKLOG_LEVEL_DEBUG
+#define DKLOG_DEBUG(...)	DKFoundation::DKLogWrite(DKFoundation::DKLogLevelDebug, __VA_ARGS__)
+#else
+#define DKLOG_DEBUG(...)	(void)0
+#endif
+#endif
+
+#if DKLOG_LEVEL_MIN <= DKLOG_LEVEL_INFO
+#define DKLOG_INFO(...)		DKFoundation::DKLogWrite(DKFoundation::DKLogLevelInfo, __VA_ARGS__)
+#else
+#define DKLOG_INFO(...)		(void)0
+#endif
+#if DKLOG_LEVEL_MIN <= DKLOG_LEVEL_WARNING
+#define DKLOG_WARNING(...)	DKFoundation::DKLogWrite(DKFoundation::DKLogLevelWarning, __VA_ARGS__)
+#else
+#define DKLOG_WARNING(...)	(void)0
+#endif
+#define DKLOG_ERROR(...)	DKFoundation::DKLogWrite(DKFoundation::DKLogLevelError, __VA_ARGS__)
@@ -27,6 +27,9 @@
 //
 //  }
 //
+// DKOrderedCriticalSection<T1, T2> locks two objects at once, in order of
+// address. use it when locking self and other object of same type.
+//
 // Note:
 //  Do not confuse with Win32 CriticalSection object, this is unrelated to that.
 //
@@ -51,4 +54,37 @@ namespace DKFoundation
 		DKCriticalSection& operator = (const DKCriticalSection&);
 		const T& lock;
 	};
+
+	// locks two objects in order of address, objects should be different.
+	// two threads locking same pair with reversed arguments cannot dead-lock.
+	template <typename T1, typename T2> class DKOrderedCriticalSection
+	{
+	public:
+		DKOrderedCriticalSection(const T1& lockObject1, const T2& lockObject2)
+			: lock1(lockObject1), lock2(lockObject2)
+			, firstIs1(static_cast<const void*>(&lockObject1) < static_cast<const void*>(&lockObject2))
+		{
+			if (firstIs1)
+			{
+				lock1.Lock();
+				lock2.Lock();
+			}
+			else
+			{
+				lock2.Lock();
+				lock1.Lock();
+			}
+		}
+		~DKOrderedCriticalSection(void)
+		{
+			lock1.Unlock();
+			lock2.Unlock();
+		}
+	private:
+		DKOrderedCriticalSection(const DKOrderedCriticalSection&);
+		DKOrderedCriticalSection& operator = (const DKOrderedCriticalSection&);
+		const T1& lock1;
+		const T2& lock2;
+		const bool firstIs1;
+	};
 }
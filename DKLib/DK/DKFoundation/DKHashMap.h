@@ -0,0 +1,326 @@
+//
+//  File: DKHashMap.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <initializer_list>
+#include "../DKInclude.h"
+#include "DKHashTable.h"
+#include "DKMap.h"
+#include "DKDummyLock.h"
+#include "DKCriticalSection.h"
+#include "DKTypeTraits.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKHashMap
+// hash map class (using DKHashTable internally, see DKHashTable.h).
+// interface is same as DKMap, except enumeration order is not sorted.
+// keys are compared by operator ==, and hashed by HASH.
+//
+// Insert: insert value if key is not exists.
+// Update: set value for key whether key is exists or not.
+//
+// insertion, deletion, lookup is thread-safe.
+// If you need to modify value directly, you should have lock object.
+//
+// Find(), Remove() accepts other key types which HASH can accept and
+// comparable with KEY. (no temporary KEY object)
+//  DKHashMap<DKString, int> map;
+//  map.Find(L"name");	// no DKString created.
+//
+// To enumerate items:
+//  map.Enumerate([](const MyMap::Pair& pair) {...});
+//  map.Enumerate([](const MyMap::Pair& pair, bool* stop) {...});
+//
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	template <
+		typename KEY,								// key type
+		typename VALUE,								// value type
+		typename LOCK = DKDummyLock,				// lock
+		typename HASH = DKHashTableHash<KEY>,		// key hash
+		typename COPY = DKMapValueCopy<VALUE>,		// copy value
+		typename ALLOC = DKMemoryDefaultAllocator	// memory allocator
+	>
+	class DKHashMap
+	{
+	public:
+		typedef LOCK						Lock;
+		typedef HASH						Hash;
+		typedef COPY						Copy;
+		typedef DKMapPair<const KEY, VALUE>	Pair;
+		typedef DKCriticalSection<Lock>		CriticalSection;
+		typedef ALLOC						Allocator;
+		typedef DKTypeTraits<KEY>			KeyTraits;
+		typedef DKTypeTraits<VALUE>			ValueTraits;
+
+		struct PairHash
+		{
+			uint64_t operator () (const Pair& p) const
+			{
+				return hash(p.key);
+			}
+			Hash hash;
+		};
+		struct KeyHash
+		{
+			template <typename K> uint64_t operator () (const K& k) const
+			{
+				return hash(k);
+			}
+			Hash hash;
+		};
+		struct PairEquality
+		{
+			bool operator () (const Pair& lhs, const Pair& rhs) const
+			{
+				return lhs.key == rhs.key;
+			}
+		};
+		struct KeyEquality
+		{
+			template <typename K> bool operator () (const Pair& lhs, const K& k) const
+			{
+				return lhs.key == k;
+			}
+		};
+		struct PairCopy
+		{
+			void operator () (Pair& dst, const Pair& src) const
+			{
+				copy(dst.value, src.value);
+			}
+			Copy copy;
+		};
+		typedef DKHashTable<Pair, KEY, PairHash, KeyHash, PairEquality, KeyEquality, PairCopy, Allocator> Container;
+
+		// lock is public. to provde lock object from outside!
+		// FindNoLock, CountNoLock is usable regardless of locking.
+		Lock	lock;
+
+		DKHashMap(void)
+		{
+		}
+		DKHashMap(DKHashMap&& m)
+			: container(static_cast<Container&&>(m.container))
+		{
+		}
+		DKHashMap(const DKHashMap& m)
+		{
+			CriticalSection guard(m.lock);
+			container = m.container;
+		}
+		DKHashMap(std::initializer_list<Pair> il)
+		{
+			container.Reserve(il.size());
+			for (const Pair& p : il)
+				container.Insert(p);
+		}
+		~DKHashMap(void)
+		{
+			Clear();
+		}
+		// Update: overwrite value if key is exists, or insert item.
+		void Update(const Pair& p)
+		{
+			CriticalSection guard(lock);
+			container.Update(p);
+		}
+		void Update(const KEY& k, const VALUE& v)
+		{
+			Update(Pair(k,v));
+		}
+		void Update(const Pair* p, size_t size)
+		{
+			CriticalSection guard(lock);
+			container.Reserve(container.Count() + size);
+			for (size_t i = 0; i < size; i++)
+				container.Update(p[i]);
+		}
+		void Update(std::initializer_list<Pair> il)
+		{
+			CriticalSection guard(lock);
+			for (const Pair& p : il)
+				container.Update(p);
+		}
+		// Insert: insert item if key is not exist, fails otherwise.
+		bool Insert(const Pair& p)
+		{
+			CriticalSection guard(lock);
+			return container.Insert(p) != NULL;
+		}
+		bool Insert(const KEY& k, const VALUE& v)
+		{
+			return Insert(Pair(k, v));
+		}
+		size_t Insert(const Pair* p, size_t size)
+		{
+			size_t ret = 0;
+			CriticalSection guard(lock);
+			container.Reserve(container.Count() + size);
+			for (size_t i = 0; i < size; i++)
+				if (container.Insert(p[i]))
+					ret++;
+			return ret;
+		}
+		size_t Insert(std::initializer_list<Pair> il)
+		{
+			size_t n = 0;
+			CriticalSection guard(lock);
+			for (const Pair& p : il)
+			{
+				if (container.Insert(p) != NULL)
+					n++;
+			}
+			return n;
+		}
+		template <typename K> void Remove(const K& k)
+		{
+			CriticalSection guard(lock);
+			container.Remove(k);
+		}
+		void Remove(std::initializer_list<KEY> il)
+		{
+			CriticalSection guard(lock);
+			for (const KEY& k : il)
+				container.Remove(k);
+		}
+		void Clear(void)
+		{
+			CriticalSection guard(lock);
+			container.Clear();
+		}
+		// allocate space for n items.
+		void Reserve(size_t n)
+		{
+			CriticalSection guard(lock);
+			container.Reserve(n);
+		}
+		template <typename K> Pair* Find(const K& k)
+		{
+			return const_cast<Pair*>(static_cast<const DKHashMap&>(*this).Find(k));
+		}
+		template <typename K> const Pair* Find(const K& k) const
+		{
+			CriticalSection guard(lock);
+			return FindNoLock(k);
+		}
+		// Perform search operation without locking.
+		// useful if you have locked already in your context.
+		template <typename K> Pair* FindNoLock(const K& k)
+		{
+			return const_cast<Pair*>(static_cast<const DKHashMap&>(*this).FindNoLock(k));
+		}
+		template <typename K> const Pair* FindNoLock(const K& k) const
+		{
+			return container.Find(k);
+		}
+		// if key 'k' is not exist, an new value inserted and returns.
+		VALUE& Value(const KEY& k)
+		{
+			CriticalSection guard(lock);
+			Pair* p = FindNoLock(k);
+			if (p == NULL)
+				p = const_cast<Pair*>(container.Insert(Pair(k, VALUE())));
+			return p->value;
+		}
+		bool IsEmpty(void) const
+		{
+			CriticalSection guard(lock);
+			return container.Count() == 0;
+		}
+		size_t Count(void) const
+		{
+			CriticalSection guard(lock);
+			return container.Count();
+		}
+		size_t CountNoLock(void) const
+		{
+			return container.Count();
+		}
+		DKHashMap& operator = (DKHashMap&& m)
+		{
+			if (this != &m)
+			{
+				CriticalSection guard(lock);
+				container = static_cast<Container&&>(m.container);
+			}
+			return *this;
+		}
+		DKHashMap& operator = (const DKHashMap& m)
+		{
+			if (this != &m)
+			{
+				CriticalSection guardOther(m.lock);
+				CriticalSection guardSelf(lock);
+
+				container = m.container;
+			}
+			return *this;
+		}
+		DKHashMap& operator = (std::initializer_list<Pair> il)
+		{
+			CriticalSection guard(lock);
+			container.Clear();
+			for (const Pair& p : il)
+				container.Insert(p);
+			return *this;
+		}
+		// Enumerate: enumerate all items. (order is not specified)
+		// You cannot insert, remove items while enumerating. (container is read-only)
+		// enumerator can be lambda or any function type that can receive arguments (VALUE&) or (VALUE&, bool*)
+		// (VALUE&, bool*) type can cancel iteration by set boolean value to true.
+		template <typename T> void Enumerate(T&& enumerator)
+		{
+			using Func = typename DKFunctionType<T&&>::Signature;
+			enum {ValidatePType1 = Func::template CanInvokeWithParameterTypes<Pair&>()};
+			enum {ValidatePType2 = Func::template CanInvokeWithParameterTypes<Pair&, bool*>()};
+			static_assert(ValidatePType1 || ValidatePType2, "enumerator's parameter is not compatible with (VALUE&) or (VALUE&,bool*)");
+
+			Enumerate(std::forward<T>(enumerator), typename Func::ParameterNumber());
+		}
+		// lambda enumerator (const VALUE&) or (const VALUE&, bool*) function type.
+		template <typename T> void Enumerate(T&& enumerator) const
+		{
+			using Func = typename DKFunctionType<T&&>::Signature;
+			enum {ValidatePType1 = Func::template CanInvokeWithParameterTypes<const Pair&>()};
+			enum {ValidatePType2 = Func::template CanInvokeWithParameterTypes<const Pair&, bool*>()};
+			static_assert(ValidatePType1 || ValidatePType2, "enumerator's parameter is not compatible with (const VALUE&) or (const VALUE&,bool*)");
+
+			Enumerate(std::forward<T>(enumerator), typename Func::ParameterNumber());
+		}
+
+	private:
+		// lambda enumerator (VALUE&)
+		template <typename T> void Enumerate(T&& enumerator, DKNumber<1>)
+		{
+			CriticalSection guard(lock);
+			container.Enumerate([&enumerator](Pair& val, bool*) {enumerator(val);});
+		}
+		// lambda enumerator (const VALUE&)
+		template <typename T> void Enumerate(T&& enumerator, DKNumber<1>) const
+		{
+			CriticalSection guard(lock);
+			container.Enumerate([&enumerator](const Pair& val, bool*) {enumerator(val);});
+		}
+		// lambda enumerator (VALUE&, bool*)
+		template <typename T> void Enumerate(T&& enumerator, DKNumber<2>)
+		{
+			CriticalSection guard(lock);
+			container.Enumerate(enumerator);
+		}
+		// lambda enumerator (const VALUE&, bool*)
+		template <typename T> void Enumerate(T&& enumerator, DKNumber<2>) const
+		{
+			CriticalSection guard(lock);
+			container.Enumerate(enumerator);
+		}
+
+		Container	container;
+	};
+}
@@ -0,0 +1,394 @@
+//
+//  File: DKMemoryStatistics.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKAllocator.h"
+#include "DKObject.h"
+#include "DKArray.h"
+#include "DKSpinLock.h"
+#include "DKCriticalSection.h"
+#include "DKFunction.h"
+#include "DKRunLoop.h"
+#include "DKRunLoopTimer.h"
+#include "DKLog.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKMemoryStatistics
+// memory accounting for allocators and memory locations.
+//
+// DKCountingAllocator is DKAllocator wrapper, counts live bytes, peak bytes,
+// number of allocations and size histogram of allocations. each allocation
+// has 16 bytes header to keep size of block.
+// counting allocators are also accumulated by location of wrapped allocator.
+// (custom, heap, virtual, file, reserved)
+// counting allocator can have limit of live bytes, allocation fails (returns
+// NULL) if exceeds limit. (budget enforcement)
+//
+// DKMemoryCountingAllocator<ALLOC> is allocator type for template classes,
+// counts to location of ALLOC.
+//
+// DKMemoryAccounting provides snapshot of all counting allocators and
+// locations, and dumping statistics with DKLog.
+//
+// Example:
+//  static DKCountingAllocator textureAllocator("Textures");
+//  resourcePool.SetAllocator(&textureAllocator);
+//  textureAllocator.SetLimit(256 << 20);    // 256MB budget
+//  ...
+//  DKMemoryAccounting::Dump();
+//  DKObject<DKRunLoopTimer> timer = DKMemoryAccounting::ScheduleDump(10.0, runLoop);
+//
+// Note:
+//  allocations not made with counting allocators are not counted.
+//  (DKMemoryHeapAlloc, DKMemoryVirtualAlloc, etc. called directly)
+//  counting allocator should live longer than objects allocated with it.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	struct DKMemoryStatistics
+	{
+		enum {NumSizeBuckets = 16};
+
+		size_t liveBytes;
+		size_t peakBytes;
+		size_t liveCount;			// number of live blocks
+		size_t totalAllocations;	// number of allocations since created
+		size_t totalBytes;			// bytes allocated since created
+		size_t failedAllocations;	// failed or exceeded limit
+		size_t sizeHistogram[NumSizeBuckets];	// allocations for each size
+
+		// bucket n counts allocations of (BucketSize(n-1), BucketSize(n)]
+		// last bucket counts all allocations larger than BucketSize(NumSizeBuckets-2)
+		static size_t BucketSize(unsigned int bucket)	{return size_t(16) << bucket;}
+		static unsigned int Bucket(size_t size)
+		{
+			unsigned int bucket = 0;
+			while (bucket < NumSizeBuckets - 1 && size > BucketSize(bucket))
+				bucket++;
+			return bucket;
+		}
+	};
+
+	// thread-safe counter.
+	class DKMemoryCounter
+	{
+	public:
+		DKMemoryCounter(void)
+			: liveBytes(0), peakBytes(0), liveCount(0), totalAllocations(0), totalBytes(0), failedAllocations(0)
+		{
+			for (std::atomic<size_t>& n : sizeHistogram)
+				n.store(0, std::memory_order_relaxed);
+		}
+		void Allocated(size_t size)
+		{
+			size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+			size_t peak = peakBytes.load(std::memory_order_relaxed);
+			while (peak < live && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+			{
+			}
+			liveCount.fetch_add(1, std::memory_order_relaxed);
+			totalAllocations.fetch_add(1, std::memory_order_relaxed);
+			totalBytes.fetch_add(size, std::memory_order_relaxed);
+			sizeHistogram[DKMemoryStatistics::Bucket(size)].fetch_add(1, std::memory_order_relaxed);
+		}
+		void Freed(size_t size)
+		{
+			liveBytes.fetch_sub(size, std::memory_order_relaxed);
+			liveCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+		void Failed(void)
+		{
+			failedAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		size_t LiveBytes(void) const
+		{
+			return liveBytes.load(std::memory_order_relaxed);
+		}
+		// reset peak to current live bytes.
+		void ResetPeak(void)
+		{
+			peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		DKMemoryStatistics Statistics(void) const
+		{
+			DKMemoryStatistics s;
+			s.liveBytes = liveBytes.load(std::memory_order_relaxed);
+			s.peakBytes = peakBytes.load(std::memory_order_relaxed);
+			s.liveCount = liveCount.load(std::memory_order_relaxed);
+			s.totalAllocations = totalAllocations.load(std::memory_order_relaxed);
+			s.totalBytes = totalBytes.load(std::memory_order_relaxed);
+			s.failedAllocations = failedAllocations.load(std::memory_order_relaxed);
+			for (int i = 0; i < DKMemoryStatistics::NumSizeBuckets; ++i)
+				s.sizeHistogram[i] = sizeHistogram[i].load(std::memory_order_relaxed);
+			if (s.peakBytes < s.liveBytes)
+				s.peakBytes = s.liveBytes;
+			return s;
+		}
+	private:
+		std::atomic<size_t> liveBytes;
+		std::atomic<size_t> peakBytes;
+		std::atomic<size_t> liveCount;
+		std::atomic<size_t> totalAllocations;
+		std::atomic<size_t> totalBytes;
+		std::atomic<size_t> failedAllocations;
+		std::atomic<size_t> sizeHistogram[DKMemoryStatistics::NumSizeBuckets];
+
+		DKMemoryCounter(const DKMemoryCounter&);
+		DKMemoryCounter& operator = (const DKMemoryCounter&);
+	};
+
+	class DKCountingAllocator;
+	class DKMemoryAccounting
+	{
+	public:
+		enum {NumLocations = DKMemoryLocationReserved + 1};
+
+		struct AllocatorStatistics
+		{
+			const char* name;
+			DKMemoryLocation location;
+			size_t limit;				// 0 for unlimited
+			DKMemoryStatistics statistics;
+		};
+
+		// counter of location, accumulates all counting allocators of location.
+		static DKMemoryCounter& LocationCounter(DKMemoryLocation loc)
+		{
+			DKASSERT_DEBUG((int)loc >= 0 && (int)loc < NumLocations);
+			return Registry::Instance().locations[loc];
+		}
+		static DKMemoryStatistics LocationStatistics(DKMemoryLocation loc)
+		{
+			return LocationCounter(loc).Statistics();
+		}
+		// statistics of all counting allocators alive.
+		static DKArray<AllocatorStatistics> Snapshot(void);
+
+		// log statistics of locations and allocators.
+		static void Dump(void)
+		{
+			static const char* const locationNames[NumLocations] = {
+				"Custom", "Heap", "Virtual", "File", "Reserved"
+			};
+			DKLog("[DKMemoryAccounting] live / peak / count / allocations\n");
+			for (int i = 0; i < NumLocations; ++i)
+			{
+				DKMemoryStatistics s = LocationStatistics((DKMemoryLocation)i);
+				if (s.totalAllocations > 0)
+					DKLog(" Location:%-9s %12llu / %12llu / %8llu / %8llu\n", locationNames[i],
+						  (unsigned long long)s.liveBytes, (unsigned long long)s.peakBytes,
+						  (unsigned long long)s.liveCount, (unsigned long long)s.totalAllocations);
+			}
+			DKArray<AllocatorStatistics> allocators = Snapshot();
+			for (const AllocatorStatistics& a : allocators)
+			{
+				const DKMemoryStatistics& s = a.statistics;
+				DKLog(" %-18s %12llu / %12llu / %8llu / %8llu (%s, limit:%llu, failed:%llu)\n", a.name,
+					  (unsigned long long)s.liveBytes, (unsigned long long)s.peakBytes,
+					  (unsigned long long)s.liveCount, (unsigned long long)s.totalAllocations,
+					  locationNames[a.location], (unsigned long long)a.limit,
+					  (unsigned long long)s.failedAllocations);
+			}
+		}
+		// dump statistics periodically, invalidate timer to stop.
+		static DKObject<DKRunLoopTimer> ScheduleDump(double interval, DKRunLoop* runLoop = NULL)
+		{
+			return DKRunLoopTimer::Create(DKFunction(&DKMemoryAccounting::Dump)->Invocation(), interval, runLoop);
+		}
+
+	private:
+		// registry is created on first use and never destroyed, counting
+		// allocators can be global objects constructed in any order.
+		struct Registry
+		{
+			Registry(void) : allocators(NULL) {}
+			DKMemoryCounter locations[NumLocations];
+			DKCountingAllocator* allocators;		// linked list
+			DKSpinLock lock;
+
+			static Registry& Instance(void)
+			{
+				Registry* reg = RegistryHolder<0>::instance.load(std::memory_order_acquire);
+				if (reg == NULL)
+				{
+					void* mem = DKMemoryHeapAlloc(sizeof(Registry));
+					if (mem == NULL)
+						DKERROR_THROW("Out of memory");
+					Registry* newReg = new(mem) Registry();
+					if (RegistryHolder<0>::instance.compare_exchange_strong(reg, newReg, std::memory_order_acq_rel))
+						reg = newReg;
+					else
+					{
+						newReg->~Registry();
+						DKMemoryHeapFree(newReg);
+					}
+				}
+				return *reg;
+			}
+		};
+		template <int N> struct RegistryHolder
+		{
+			static std::atomic<Registry*> instance;
+		};
+		friend class DKCountingAllocator;
+	};
+	template <int N> std::atomic<DKMemoryAccounting::Registry*> DKMemoryAccounting::RegistryHolder<N>::instance(NULL);
+
+	// DKAllocator wrapper, counts allocations.
+	class DKCountingAllocator : public DKAllocator
+	{
+	public:
+		enum {HeaderSize = 16};		// keeps 16 bytes alignment.
+
+		// name: string literal or static string.
+		DKCountingAllocator(const char* n, DKAllocator& alloc = DKAllocator::DefaultAllocator(), size_t limitBytes = 0)
+			: name(n), allocator(alloc), limit(limitBytes), prev(NULL), next(NULL)
+		{
+			DKMemoryAccounting::Registry& reg = DKMemoryAccounting::Registry::Instance();
+			DKCriticalSection<DKSpinLock> guard(reg.lock);
+			next = reg.allocators;
+			if (next)
+				next->prev = this;
+			reg.allocators = this;
+		}
+		~DKCountingAllocator(void)
+		{
+			DKASSERT_DEBUG(counter.Statistics().liveCount == 0);
+
+			DKMemoryAccounting::Registry& reg = DKMemoryAccounting::Registry::Instance();
+			DKCriticalSection<DKSpinLock> guard(reg.lock);
+			if (prev)
+				prev->next = next;
+			else
+				reg.allocators = next;
+			if (next)
+				next->prev = prev;
+		}
+
+		void* Alloc(size_t s)
+		{
+			size_t max = limit.load(std::memory_order_relaxed);
+			if (max > 0 && counter.LiveBytes() + s > max)
+			{
+				counter.Failed();
+				return NULL;
+			}
+			void* p = allocator.Alloc(s + HeaderSize);
+			if (p)
+			{
+				*reinterpret_cast<size_t*>(p) = s;
+				counter.Allocated(s);
+				DKMemoryAccounting::LocationCounter(allocator.Location()).Allocated(s);
+				return reinterpret_cast<char*>(p) + HeaderSize;
+			}
+			counter.Failed();
+			return NULL;
+		}
+		void Dealloc(void* p)
+		{
+			if (p)
+			{
+				void* block = reinterpret_cast<char*>(p) - HeaderSize;
+				size_t s = *reinterpret_cast<size_t*>(block);
+				counter.Freed(s);
+				DKMemoryAccounting::LocationCounter(allocator.Location()).Freed(s);
+				allocator.Dealloc(block);
+			}
+		}
+		DKMemoryLocation Location(void) const
+		{
+			return allocator.Location();
+		}
+
+		const char* Name(void) const					{return name;}
+		DKMemoryStatistics Statistics(void) const		{return counter.Statistics();}
+		void ResetPeak(void)							{counter.ResetPeak();}
+
+		// limit of live bytes, 0 for unlimited.
+		// limit is checked before allocating, concurrent allocations can
+		// exceed limit slightly.
+		void SetLimit(size_t bytes)						{limit.store(bytes, std::memory_order_relaxed);}
+		size_t Limit(void) const						{return limit.load(std::memory_order_relaxed);}
+
+	private:
+		const char* name;
+		DKAllocator& allocator;
+		std::atomic<size_t> limit;
+		DKMemoryCounter counter;
+		DKCountingAllocator* prev;
+		DKCountingAllocator* next;
+
+		friend class DKMemoryAccounting;
+	};
+
+	inline DKArray<DKMemoryAccounting::AllocatorStatistics> DKMemoryAccounting::Snapshot(void)
+	{
+		DKArray<AllocatorStatistics> result;
+		Registry& reg = Registry::Instance();
+		DKCriticalSection<DKSpinLock> guard(reg.lock);
+		for (DKCountingAllocator* a = reg.allocators; a; a = a->next)
+		{
+			AllocatorStatistics s = {a->name, a->Location(), a->Limit(), a->Statistics()};
+			result.Add(s);
+		}
+		return result;
+	}
+
+	// allocator type for template classes, counts to location of ALLOC.
+	template <typename ALLOC> struct DKMemoryCountingAllocator
+	{
+		enum {location = ALLOC::location, HeaderSize = 16};
+
+		static void* Alloc(size_t s)
+		{
+			void* p = ALLOC::Alloc(s + HeaderSize);
+			if (p)
+			{
+				*reinterpret_cast<size_t*>(p) = s;
+				Counter().Allocated(s);
+				return reinterpret_cast<char*>(p) + HeaderSize;
+			}
+			Counter().Failed();
+			return NULL;
+		}
+		static void* Realloc(void* p, size_t s)
+		{
+			if (p == NULL)
+				return Alloc(s);
+			void* block = reinterpret_cast<char*>(p) - HeaderSize;
+			size_t old = *reinterpret_cast<size_t*>(block);
+			void* p2 = ALLOC::Realloc(block, s + HeaderSize);
+			if (p2)
+			{
+				*reinterpret_cast<size_t*>(p2) = s;
+				Counter().Freed(old);
+				Counter().Allocated(s);
+				return reinterpret_cast<char*>(p2) + HeaderSize;
+			}
+			Counter().Failed();
+			return NULL;
+		}
+		static void Free(void* p)
+		{
+			if (p)
+			{
+				void* block = reinterpret_cast<char*>(p) - HeaderSize;
+				Counter().Freed(*reinterpret_cast<size_t*>(block));
+				ALLOC::Free(block);
+			}
+		}
+		static DKMemoryCounter& Counter(void)
+		{
+			return DKMemoryAccounting::LocationCounter((DKMemoryLocation)location);
+		}
+	};
+}
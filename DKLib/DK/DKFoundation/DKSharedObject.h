@@ -0,0 +1,289 @@
+//
+//  File: DKSharedObject.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKAllocator.h"
+#include "DKAtomicNumber32.h"
+#include "DKTypeTraits.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKSharedObject<T>
+// ref-counted object pointer with intrusive reference-count header.
+//
+// DKObject keeps reference-count of object in DKObjectRefCounter's global
+// table, every copy of DKObject requires table look-up. DKSharedObject stores
+// reference-count in header placed in front of object, which allocated
+// together with object. copying DKSharedObject is a single atomic operation,
+// no global table or lock involved, objects on different threads never
+// contend each other.
+//
+// Object can be allocated with DKSharedObject::Alloc() or New() only,
+// raw pointer cannot be adopted. (there is no header for it)
+// Allocated memory includes header, so allocator's Alloc() should not be
+// 'operator new (size_t, DKAllocator&)' of object. (object is not registered
+// to DKObjectRefCounter, DKObject cannot share ownership with it.)
+//
+// Example:
+//  DKSharedObject<MyObject> obj = DKSharedObject<MyObject>::New(arg1, arg2);
+//  DKSharedObject<MyBase> base = obj;      // share ownership.
+//  DKSharedObject<MyObject>::Ref weak = obj;
+//  DKSharedObject<MyObject> obj2 = weak;   // NULL if object destroyed.
+//
+// Note:
+//  DKSharedObject::Ref (weak-ref) holds header memory until all Refs are
+//  destroyed, object itself is destroyed when last DKSharedObject released.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		struct SharedObjectHeader
+		{
+			typedef void (*DestroyFunc)(SharedObjectHeader*);
+			enum {Size = 32,};	// keeps 16 bytes alignment of object.
+
+			DKAtomicNumber32 strongCount;
+			DKAtomicNumber32 weakCount;	// number of weak-refs, +1 while object alive.
+			DKAllocator* allocator;
+			DestroyFunc destroy;
+
+			void* Object(void)
+			{
+				return reinterpret_cast<unsigned char*>(this) + Size;
+			}
+			void Retain(void)
+			{
+				strongCount.Increment();
+			}
+			// increase strong-count only if object is alive.
+			bool RetainIfAlive(void)
+			{
+				DKAtomicNumber32::Value count = strongCount;
+				while (count > 0)
+				{
+					if (strongCount.CompareAndSet(count, count + 1))
+						return true;
+					count = strongCount;
+				}
+				return false;
+			}
+			void Release(void)
+			{
+				if (strongCount.Decrement() == 1)
+				{
+					destroy(this);
+					ReleaseWeak();
+				}
+			}
+			void RetainWeak(void)
+			{
+				weakCount.Increment();
+			}
+			void ReleaseWeak(void)
+			{
+				if (weakCount.Decrement() == 1)
+				{
+					DKAllocator* alloc = allocator;
+					this->~SharedObjectHeader();
+					alloc->Dealloc(this);
+				}
+			}
+		};
+	}
+
+	template <typename T> class DKSharedObject
+	{
+		typedef Private::SharedObjectHeader Header;
+	public:
+		typedef DKAtomicNumber32::Value RefCountValue;
+
+		class Ref
+		{
+		public:
+			Ref(void) : ptr(NULL), header(NULL) {}
+			Ref(const Ref& r) : ptr(r.ptr), header(r.header)
+			{
+				if (header)
+					header->RetainWeak();
+			}
+			~Ref(void)
+			{
+				if (header)
+					header->ReleaseWeak();
+			}
+			Ref& operator = (const Ref& r)
+			{
+				if (r.header)
+					r.header->RetainWeak();
+				if (header)
+					header->ReleaseWeak();
+				ptr = r.ptr;
+				header = r.header;
+				return *this;
+			}
+		private:
+			T* ptr;
+			Header* header;
+			friend class DKSharedObject;
+		};
+
+		DKSharedObject(void) : _target(NULL), _header(NULL)
+		{
+		}
+		DKSharedObject(const DKSharedObject& obj) : _target(obj._target), _header(obj._header)
+		{
+			if (_header)
+				_header->Retain();
+		}
+		DKSharedObject(DKSharedObject&& obj) : _target(obj._target), _header(obj._header)
+		{
+			obj._target = NULL;
+			obj._header = NULL;
+		}
+		template <typename U> DKSharedObject(const DKSharedObject<U>& obj) : _target(obj._target), _header(obj._header)
+		{
+			if (_header)
+				_header->Retain();
+		}
+		DKSharedObject(const Ref& ref) : _target(NULL), _header(NULL)
+		{
+			if (ref.header && ref.header->RetainIfAlive())
+			{
+				_target = ref.ptr;
+				_header = ref.header;
+			}
+		}
+		~DKSharedObject(void)
+		{
+			if (_header)
+				_header->Release();
+		}
+
+		// pointer operators
+		T* operator ->(void)						{return _target;}
+		const T* operator ->(void) const			{return _target;}
+		T& operator * (void)						{return *_target;}
+		const T& operator * (void) const			{return *_target;}
+		// type-casting operators
+		operator T* (void)							{return _target;}
+		operator const T* (void) const				{return _target;}
+		// get raw-pointer
+		T* Ptr(void)								{return _target;}
+		const T* Ptr(void) const					{return _target;}
+
+		DKSharedObject& operator = (DKSharedObject&& obj)
+		{
+			if (this != &obj)
+			{
+				Header* old = _header;
+				_target = obj._target;
+				_header = obj._header;
+				obj._target = NULL;
+				obj._header = NULL;
+				if (old)
+					old->Release();
+			}
+			return *this;
+		}
+		DKSharedObject& operator = (const DKSharedObject& obj)
+		{
+			if (obj._header)
+				obj._header->Retain();
+			Header* old = _header;
+			_target = obj._target;
+			_header = obj._header;
+			if (old)
+				old->Release();
+			return *this;
+		}
+		// casting Ref (weak-ref)
+		operator Ref (void) const
+		{
+			Ref ref;
+			if (_header)
+			{
+				_header->RetainWeak();
+				ref.ptr = _target;
+				ref.header = _header;
+			}
+			return ref;
+		}
+
+		template <typename... Args> static DKSharedObject Alloc(DKAllocator& alloc, Args&&... args)
+		{
+			void* p = alloc.Alloc(Header::Size + sizeof(T));
+			if (p == NULL)
+				return DKSharedObject();
+			Header* header = new(p) Header();
+			header->strongCount = 1;
+			header->weakCount = 1;
+			header->allocator = &alloc;
+			header->destroy = &DestroyObject;
+			T* target = new(header->Object()) T(std::forward<Args>(args)...);
+			return DKSharedObject(target, header);
+		}
+		template <typename... Args> static DKSharedObject New(Args&&... args)
+		{
+			return Alloc(DKAllocator::DefaultAllocator(DKMemoryLocationHeap), std::forward<Args>(args)...);
+		}
+		DKAllocator* Allocator(void) const
+		{
+			if (_header)
+				return _header->allocator;
+			return NULL;
+		}
+		bool IsShared(void) const
+		{
+			return SharingCount() > 1;
+		}
+		RefCountValue SharingCount(void) const
+		{
+			if (_header)
+				return _header->strongCount;
+			return 0;
+		}
+		template <typename R> DKSharedObject<R> StaticCast(void) const
+		{
+			if (_header)
+				_header->Retain();
+			return DKSharedObject<R>(static_cast<R*>(_target), _header);
+		}
+		template <typename R> DKSharedObject<R> DynamicCast(void) const
+		{
+			R* p = dynamic_cast<R*>(_target);
+			if (p)
+			{
+				_header->Retain();
+				return DKSharedObject<R>(p, _header);
+			}
+			return DKSharedObject<R>();
+		}
+
+	private:
+		// takes ownership of one strong-count.
+		DKSharedObject(T* p, Header* h) : _target(p), _header(h)
+		{
+		}
+		static void DestroyObject(Header* h)
+		{
+			static_cast<T*>(h->Object())->~T();
+		}
+
+		T* _target;
+		Header* _header;
+
+		template <typename U> friend class DKSharedObject;
+	};
+	template <typename T> class DKSharedObject<T*>;
+	template <typename T> class DKSharedObject<T&>;
+	template <typename T> class DKSharedObject<T&&>;
+	template <typename T> struct DKTriviallyRelocatable<DKSharedObject<T>> {enum {Result = true};};
+}
@@ -0,0 +1,450 @@
+//
+//  File: DKSmallArray.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <type_traits>
+#include <initializer_list>
+#include "../DKInclude.h"
+#include "DKTypeTraits.h"
+#include "DKDummyLock.h"
+#include "DKCriticalSection.h"
+#include "DKMemory.h"
+#include "DKFunction.h"
+#include "DKStaticArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKSmallArray
+// array class with inline storage for N items.
+// no heap allocation until number of items exceeds N, items are moved to
+// heap when array grows. (heap memory is not returned to inline storage
+// until array destroyed)
+// interface is same as DKArray, useful for arrays which have few items.
+//
+// ex:
+//  DKSmallArray<int, 8> array = {1, 2, 3};	// no heap allocation.
+//
+// NOTE:
+//  object size is bigger than DKArray. (sizeof(VALUE) * N)
+//  moving array with inline items moves all items, not a pointer.
+//  IsInline() returns true if items are stored in inline storage.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	template <typename VALUE, size_t N, typename LOCK = DKDummyLock, typename ALLOC = DKMemoryDefaultAllocator>
+	class DKSmallArray
+	{
+		static_assert(N > 0, "inline capacity must be greater than zero");
+	public:
+		typedef LOCK					Lock;
+		typedef DKCriticalSection<Lock>	CriticalSection;
+		typedef size_t					Index;
+		typedef DKTypeTraits<VALUE>		ValueTraits;
+		typedef ALLOC					Allocator;
+
+		enum {InlineCapacity = N};
+		static const Index invalidIndex = (size_t)-1;
+		// lock is public. (object can be locked from outside, to use modify element directly.)
+		Lock	lock;
+
+		// implementation for range-based-for-loop.
+		typedef DKArrayRBIterator<DKSmallArray, VALUE&>				RBIterator;
+		typedef DKArrayRBIterator<const DKSmallArray, const VALUE&>	ConstRBIterator;
+		RBIterator begin(void)				{return RBIterator(*this, 0);}
+		ConstRBIterator begin(void) const	{return ConstRBIterator(*this, 0);}
+		RBIterator end(void)				{return RBIterator(*this, this->Count());}
+		ConstRBIterator end(void) const		{return ConstRBIterator(*this, this->Count());}
+
+		DKSmallArray(void)
+			: data(InlineData()), count(0), capacity(N)
+		{
+		}
+		DKSmallArray(const VALUE* v, size_t c)
+			: data(InlineData()), count(0), capacity(N)
+		{
+			Add(v, c);
+		}
+		DKSmallArray(const VALUE& v, size_t c)
+			: data(InlineData()), count(0), capacity(N)
+		{
+			Add(v, c);
+		}
+		DKSmallArray(DKSmallArray&& v)
+			: data(InlineData()), count(0), capacity(N)
+		{
+			MoveFrom(v);
+		}
+		DKSmallArray(const DKSmallArray& v)
+			: data(InlineData()), count(0), capacity(N)
+		{
+			CriticalSection guard(v.lock);
+			Add(v.data, v.count);
+		}
+		DKSmallArray(std::initializer_list<VALUE> il)
+			: data(InlineData()), count(0), capacity(N)
+		{
+			Add(il);
+		}
+		~DKSmallArray(void)
+		{
+			Clear();
+
+			if (data != InlineData())
+				Allocator::Free(data);
+		}
+		bool IsEmpty(void) const
+		{
+			CriticalSection guard(lock);
+			return count == 0;
+		}
+		// true if items are stored in inline storage. (no heap allocated)
+		bool IsInline(void) const
+		{
+			CriticalSection guard(lock);
+			return data == InlineData();
+		}
+		// append one item to tail.
+		Index Add(const VALUE& value)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(1);
+			::new(&data[count]) VALUE(value);
+			return count++;
+		}
+		// append one item to tail, item will be moved.
+		Index Add(VALUE&& value)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(1);
+			::new(&data[count]) VALUE(static_cast<VALUE&&>(value));
+			return count++;
+		}
+		// construct one item at tail with arguments.
+		template <typename... Args> Index EmplaceBack(Args&&... args)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(1);
+			::new(&data[count]) VALUE(std::forward<Args>(args)...);
+			return count++;
+		}
+		// append 's' length of value to tail.
+		Index Add(const VALUE* value, size_t s)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(s);
+			for (Index i = 0; i < s; i++)
+				::new(&data[count+i]) VALUE(value[i]);
+			count += s;
+			return count - s;
+		}
+		// append value to tail 's' times. (value x s)
+		Index Add(const VALUE& value, size_t s)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(s);
+			for (Index i = 0; i < s; i++)
+				::new(&data[count+i]) VALUE(value);
+			count += s;
+			return count - s;
+		}
+		// append initializer-list items to tail.
+		Index Add(std::initializer_list<VALUE> il)
+		{
+			size_t s = il.size();
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(s);
+			for (const VALUE& v : il)
+			{
+				::new(&data[count]) VALUE(v);
+				count++;
+			}
+			return count - s;
+		}
+		// insert one value into position 'pos'.
+		Index Insert(const VALUE& value, Index pos)
+		{
+			return Emplace(pos, value);
+		}
+		// insert one value into position 'pos', value will be moved.
+		Index Insert(VALUE&& value, Index pos)
+		{
+			return Emplace(pos, static_cast<VALUE&&>(value));
+		}
+		// construct one item at position 'pos' with arguments.
+		template <typename... Args> Index Emplace(Index pos, Args&&... args)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(1);
+			if (pos > count)
+				pos = count;
+			if (pos < count)
+				Private::RelocateItems(&data[pos+1], &data[pos], count - pos);
+			::new(&data[pos]) VALUE(std::forward<Args>(args)...);
+			count++;
+			return pos;
+		}
+		// insert 's' length of value into position 'pos'.
+		Index Insert(const VALUE* value, size_t s, Index pos)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(s);
+			if (pos > count)
+				pos = count;
+			if (pos < count)
+				Private::RelocateItems(&data[pos+s], &data[pos], count - pos);
+			for (Index i = 0; i < s; i++)
+				::new(&data[pos+i]) VALUE(value[i]);
+			count += s;
+			return pos;
+		}
+		// remove one element at pos.
+		size_t Remove(Index pos)
+		{
+			CriticalSection guard(lock);
+			if (pos < count)
+			{
+				data[pos].~VALUE();
+				if (count - pos > 1)
+					Private::RelocateItems(&data[pos], &data[pos+1], count-pos-1);
+				count--;
+			}
+			return count;
+		}
+		// remove 'c' items at pos. (c = count)
+		size_t Remove(Index pos, size_t c)
+		{
+			CriticalSection guard(lock);
+			if (pos < count)
+			{
+				Index i = 0;
+				for (; i < count - pos && i < c; i++)
+					data[pos+i].~VALUE();
+				if (i > 0)
+					Private::RelocateItems(&data[pos], &data[pos+i], count-pos-i);
+				count -= i;
+			}
+			return count;
+		}
+		void Clear(void)
+		{
+			CriticalSection guard(lock);
+			for (Index i = 0; i < count; i++)
+				data[i].~VALUE();
+
+			count = 0;
+		}
+		size_t Count(void) const
+		{
+			CriticalSection guard(lock);
+			return count;
+		}
+		size_t Capacity(void) const
+		{
+			CriticalSection guard(lock);
+			return capacity;
+		}
+		void Resize(size_t s)
+		{
+			CriticalSection guard(lock);
+			if (count > s)			// shrink
+			{
+				for (Index i = s; i < count; i++)
+					data[i].~VALUE();
+			}
+			else if (count < s)		// extend
+			{
+				ReserveNL(s);
+				for (Index i = count; i < s; i++)
+					::new(&data[i]) VALUE();
+			}
+			count = s;
+		}
+		void Resize(size_t s, const VALUE& val)
+		{
+			CriticalSection guard(lock);
+			if (count > s)			// shrink
+			{
+				for (Index i = s; i < count; i++)
+					data[i].~VALUE();
+			}
+			else if (count < s)		// extend
+			{
+				ReserveNL(s);
+				for (Index i = count; i < s; i++)
+					::new(&data[i]) VALUE(val);
+			}
+			count = s;
+		}
+		void Reserve(size_t c)
+		{
+			CriticalSection guard(lock);
+			ReserveNL(c);
+		}
+		bool CopyValue(VALUE& value, Index index) const
+		{
+			CriticalSection guard(lock);
+			if (count > index)
+			{
+				value = data[index];
+				return true;
+			}
+			return false;
+		}
+		VALUE& Value(Index index)
+		{
+			CriticalSection guard(lock);
+			DKASSERT_DEBUG(count > index);
+			return data[index];
+		}
+		const VALUE& Value(Index index) const
+		{
+			CriticalSection guard(lock);
+			DKASSERT_DEBUG(count > index);
+			return data[index];
+		}
+		// To use items directly (You may need lock array.)
+		operator VALUE* (void)
+		{
+			if (count > 0)
+				return data;
+			return NULL;
+		}
+		operator const VALUE* (void) const
+		{
+			if (count > 0)
+				return data;
+			return NULL;
+		}
+		DKSmallArray& operator = (DKSmallArray&& other)
+		{
+			if (this != &other)
+			{
+				CriticalSection guard(lock);
+				for (Index i = 0; i < count; i++)
+					data[i].~VALUE();
+				count = 0;
+				if (data != InlineData())
+					Allocator::Free(data);
+				data = InlineData();
+				capacity = N;
+
+				MoveFrom(other);
+			}
+			return *this;
+		}
+		DKSmallArray& operator = (const DKSmallArray& other)
+		{
+			if (this != &other)
+			{
+				CriticalSection guardOther(other.lock);
+				Clear();
+				Add(other.data, other.count);
+			}
+			return *this;
+		}
+		DKSmallArray& operator = (std::initializer_list<VALUE> il)
+		{
+			Clear();
+			Add(il);
+			return *this;
+		}
+		template <typename CompareFunc> void Sort(CompareFunc cmp)
+		{
+			CriticalSection guard(lock);
+			if (count > 1)
+				DKStaticArray<VALUE>(data, count).template Sort<CompareFunc>(cmp);
+		}
+		// EnumerateForward / EnumerateBackward: enumerate all items.
+		// You cannot insert, remove items while enumerating. (container is read-only)
+		// enumerator can be lambda or any function type that can receive arguments (VALUE&) or (VALUE&, bool*)
+		// (VALUE&, bool*) type can cancel iteration by set boolean value to true.
+		template <typename T> void EnumerateForward(T&& enumerator)
+		{
+			CriticalSection guard(lock);
+			DKStaticArray<VALUE>(data, count).EnumerateForward(std::forward<T>(enumerator));
+		}
+		template <typename T> void EnumerateBackward(T&& enumerator)
+		{
+			CriticalSection guard(lock);
+			DKStaticArray<VALUE>(data, count).EnumerateBackward(std::forward<T>(enumerator));
+		}
+		// lambda enumerator (const VALUE&) or (const VALUE&, bool*) function type.
+		template <typename T> void EnumerateForward(T&& enumerator) const
+		{
+			CriticalSection guard(lock);
+			const DKStaticArray<VALUE> array(data, count);
+			array.EnumerateForward(std::forward<T>(enumerator));
+		}
+		template <typename T> void EnumerateBackward(T&& enumerator) const
+		{
+			CriticalSection guard(lock);
+			const DKStaticArray<VALUE> array(data, count);
+			array.EnumerateBackward(std::forward<T>(enumerator));
+		}
+	private:
+		VALUE* InlineData(void)
+		{
+			return reinterpret_cast<VALUE*>(&storage);
+		}
+		const VALUE* InlineData(void) const
+		{
+			return reinterpret_cast<const VALUE*>(&storage);
+		}
+		// take items from other, other becomes empty. (both are locked)
+		void MoveFrom(DKSmallArray& other)
+		{
+			CriticalSection guard(other.lock);
+			if (other.data == other.InlineData())
+			{
+				Private::RelocateItems(data, other.data, other.count);
+				count = other.count;
+			}
+			else
+			{
+				data = other.data;
+				count = other.count;
+				capacity = other.capacity;
+				other.data = other.InlineData();
+				other.capacity = N;
+			}
+			other.count = 0;
+		}
+		void ReserveNL(size_t c)
+		{
+			if (c <= capacity)
+				return;
+
+			if (data != InlineData() && DKTriviallyRelocatable<VALUE>::Result)
+			{
+				data = (VALUE*)Allocator::Realloc(data, sizeof(VALUE) * c);
+			}
+			else
+			{
+				VALUE* p = (VALUE*)Allocator::Alloc(sizeof(VALUE) * c);
+				Private::RelocateItems(p, data, count);
+				if (data != InlineData())
+					Allocator::Free(data);
+				data = p;
+			}
+			capacity = c;
+		}
+		void ReserveItemCapsNL(size_t c)
+		{
+			if (c > 0 && capacity < c + count)
+			{
+				size_t minimum = c > N ? c : N;
+				ReserveNL(count + ((count/2) > minimum ? (count/2):minimum));
+			}
+		}
+
+		VALUE*	data;
+		size_t	count;
+		size_t	capacity;
+		typename std::aligned_storage<sizeof(VALUE) * N, alignof(VALUE)>::type storage;
+	};
+}
@@ -0,0 +1,343 @@
+//
+//  File: DKZipParallelArchiver.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <string.h>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKArray.h"
+#include "DKFile.h"
+#include "DKHash.h"
+#include "DKDateTime.h"
+#include "DKMutex.h"
+#include "DKCriticalSection.h"
+#include "DKMemory.h"
+#include "DKParallel.h"
+#include "DKDeflater.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKZipParallelArchiver
+// zip file writer, entries are compressed concurrently.
+//
+// compression (DKDeflater) and CRC are calculated without lock, only appending
+// compressed entry into file is serialized. Write() can be called from
+// multiple threads at once.
+// Write(entries, count) compresses entries with DKParallelFor, and appends
+// them in order of array as soon as each one is ready.
+//
+// entry is stored without compression if compressed size is not smaller.
+// stored entry is written from given data directly. (no copy)
+//
+// central directory is written by Finish() or destructor.
+//
+// Example:
+//  DKObject<DKZipParallelArchiver> zip = DKZipParallelArchiver::Create(L"out.zip");
+//  DKZipParallelArchiver::Entry entries[] = {
+//      {L"a.txt", textData, textLength, 9},
+//      {L"b.png", pngData, pngLength, 0},
+//  };
+//  zip->Write(entries, 2);
+//  zip->Finish();
+//
+// Note:
+//  Zip64 is not written, archive size and each entry should be less than
+//  4GB, and number of entries should be less than 65535.
+//  encryption and appending to existing archive are not supported,
+//  use DKZipArchiver.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKZipParallelArchiver
+	{
+	public:
+		struct Entry
+		{
+			DKString name;
+			const void* data;
+			size_t length;
+			int compressionLevel;	// 0 ~ 9 (0: no-compression)
+		};
+
+		~DKZipParallelArchiver(void)
+		{
+			Finish();
+		}
+
+		static DKObject<DKZipParallelArchiver> Create(const DKString& file)
+		{
+			DKObject<DKFile> f = DKFile::Create(file, DKFile::ModeOpenNew, DKFile::ModeShareExclusive);
+			if (f)
+				return DKOBJECT_NEW DKZipParallelArchiver(f, file);
+			return NULL;
+		}
+
+		// add file into archive. (thread-safe)
+		bool Write(const DKString& name, const void* data, size_t length, int compressionLevel = DKDeflater::DefaultLevel)
+		{
+			Compressed c;
+			if (!Compress(data, length, compressionLevel, c))
+				return false;
+			bool result = Append(name, c);
+			DKMemoryHeapFree(c.buffer);
+			return result;
+		}
+		// add files concurrently, returns number of entries written.
+		// entries are placed in archive in order of array.
+		size_t Write(const Entry* entries, size_t count)
+		{
+			if (count == 0)
+				return 0;
+			Compressed* items = (Compressed*)DKMemoryHeapAlloc(sizeof(Compressed) * count);
+			if (items == NULL)
+				return 0;
+			for (size_t i = 0; i < count; ++i)
+				items[i].ready = false;
+
+			DKMutex orderLock;
+			size_t next = 0;		// next entry to append
+			size_t written = 0;
+			bool appending = false;
+			DKParallelFor(0, count, [&](size_t i)
+			{
+				const Entry& e = entries[i];
+				Compressed& c = items[i];
+				bool compressed = Compress(e.data, e.length, e.compressionLevel, c);
+
+				orderLock.Lock();
+				c.ready = true;
+				c.failed = !compressed;
+				// only one thread appends at a time, others leave
+				// their entries to be appended by that thread.
+				if (!appending)
+				{
+					appending = true;
+					while (next < count && items[next].ready)
+					{
+						size_t index = next++;
+						orderLock.Unlock();
+						Compressed& item = items[index];
+						bool result = !item.failed && Append(entries[index].name, item);
+						DKMemoryHeapFree(item.buffer);
+						orderLock.Lock();
+						if (result)
+							written++;
+					}
+					appending = false;
+				}
+				orderLock.Unlock();
+			}, 1);
+
+			DKMemoryHeapFree(items);
+			return written;
+		}
+
+		// write central directory, archive cannot be modified after finished.
+		bool Finish(void)
+		{
+			DKCriticalSection<DKMutex> guard(lock);
+			if (file == NULL)
+				return false;
+
+			uint64_t dirOffset = offset;
+			bool result = true;
+			for (size_t i = 0; i < directory.Count() && result; ++i)
+			{
+				const DirectoryEntry& e = directory.Value(i);
+				unsigned char header[CentralDirHeaderSize] = {0};
+				Write32(header, CentralDirSignature);
+				Write16(header + 4, Version);
+				Write16(header + 6, Version);
+				memcpy(header + 8, e.header + 6, 24);	// flags ~ extra field length
+				Write32(header + 42, e.localHeader);
+				size_t nameLength = e.name.Bytes();
+				result = WriteFile(header, CentralDirHeaderSize) && WriteFile((const DKUniChar8*)e.name, nameLength);
+			}
+			uint64_t dirSize = offset - dirOffset;
+			if (result && offset <= 0xffffffff)
+			{
+				unsigned char eocd[EndOfCentralDirSize] = {0};
+				Write32(eocd, EndOfCentralDirSignature);
+				Write16(eocd + 8, (unsigned int)directory.Count());
+				Write16(eocd + 10, (unsigned int)directory.Count());
+				Write32(eocd + 12, (uint32_t)dirSize);
+				Write32(eocd + 16, (uint32_t)dirOffset);
+				result = WriteFile(eocd, EndOfCentralDirSize);
+			}
+			else
+				result = false;
+			file = NULL;
+			directory.Clear();
+			return result;
+		}
+
+		size_t NumberOfEntries(void) const
+		{
+			DKCriticalSection<DKMutex> guard(lock);
+			return directory.Count();
+		}
+		const DKString& GetArchiveName(void) const		{return filename;}
+
+	private:
+		enum
+		{
+			LocalHeaderSignature = 0x04034b50,
+			CentralDirSignature = 0x02014b50,
+			EndOfCentralDirSignature = 0x06054b50,
+			LocalHeaderSize = 30,
+			CentralDirHeaderSize = 46,
+			EndOfCentralDirSize = 22,
+			Version = 20,
+			MaxEntries = 0xffff,
+		};
+		struct Compressed
+		{
+			const void* data;		// content to write, buffer or source data.
+			size_t size;
+			unsigned char* buffer;	// compressed data, NULL if stored.
+			size_t length;			// uncompressed length
+			uint32_t crc;
+			unsigned int method;	// 0: stored, 8: deflated
+			int level;
+			bool ready;
+			bool failed;
+		};
+		struct DirectoryEntry
+		{
+			DKStringU8 name;
+			unsigned char header[LocalHeaderSize];
+			uint32_t localHeader;
+		};
+
+		DKZipParallelArchiver(DKFile* f, const DKString& name)
+			: file(f), filename(name), offset(0)
+		{
+		}
+
+		static void Write16(unsigned char* p, unsigned int v)
+		{
+			p[0] = (unsigned char)(v);
+			p[1] = (unsigned char)(v >> 8);
+		}
+		static void Write32(unsigned char* p, uint32_t v)
+		{
+			p[0] = (unsigned char)(v);
+			p[1] = (unsigned char)(v >> 8);
+			p[2] = (unsigned char)(v >> 16);
+			p[3] = (unsigned char)(v >> 24);
+		}
+
+		static bool Compress(const void* data, size_t length, int level, Compressed& c)
+		{
+			c.data = data;
+			c.size = length;
+			c.buffer = NULL;
+			c.length = length;
+			c.crc = 0;
+			c.method = 0;
+			c.level = Clamp(level, 0, 9);
+			if (length > 0xffffffff || (data == NULL && length > 0))
+				return false;
+			if (length > 0)
+				c.crc = DKHashCRC32(data, length).digest[0];
+
+			if (c.level > 0 && length > 0)
+			{
+				size_t bound = DKDeflater::Bound(length);
+				c.buffer = (unsigned char*)DKMemoryHeapAlloc(bound);
+				if (c.buffer == NULL)
+					return false;
+				size_t size = DKDeflater::Deflate(data, length, c.buffer, bound, c.level);
+				if (size > 0 && size < length)
+				{
+					c.data = c.buffer;
+					c.size = size;
+					c.method = 8;
+				}
+				else
+				{
+					DKMemoryHeapFree(c.buffer);
+					c.buffer = NULL;
+				}
+			}
+			return true;
+		}
+		bool WriteFile(const void* p, size_t s)
+		{
+			if (s == 0)
+				return true;
+			if (file->Write(p, s) != s)
+				return false;
+			offset += s;
+			return true;
+		}
+		// append local file header and data. (serialized)
+		bool Append(const DKString& name, const Compressed& c)
+		{
+			DKStringU8 nameU8((const DKUniCharW*)name);
+			size_t nameLength = nameU8.Bytes();
+			if (nameLength == 0 || nameLength > 0xffff)
+				return false;
+
+			unsigned int flags = 0x0800;	// UTF-8 name
+			if (c.method == 8)
+			{
+				if (c.level >= 8)
+					flags |= 2;		// maximum
+				else if (c.level == 2)
+					flags |= 4;		// fast
+				else if (c.level == 1)
+					flags |= 6;		// super fast
+			}
+			DKDateTime::Component t;
+			DKDateTime::Now().GetLocalComponent(t);
+			unsigned int dosTime = (t.hour << 11) | (t.minute << 5) | (t.second / 2);
+			unsigned int dosDate = (Clamp<int>(t.year - 1980, 0, 127) << 9) | (t.month << 5) | t.day;
+
+			DirectoryEntry e;
+			e.name = nameU8;
+			memset(e.header, 0, LocalHeaderSize);
+			Write32(e.header, LocalHeaderSignature);
+			Write16(e.header + 4, Version);
+			Write16(e.header + 6, flags);
+			Write16(e.header + 8, c.method);
+			Write16(e.header + 10, dosTime);
+			Write16(e.header + 12, dosDate);
+			Write32(e.header + 14, c.crc);
+			Write32(e.header + 18, (uint32_t)c.size);
+			Write32(e.header + 22, (uint32_t)c.length);
+			Write16(e.header + 26, (unsigned int)nameLength);
+
+			DKCriticalSection<DKMutex> guard(lock);
+			if (file == NULL || directory.Count() >= MaxEntries)
+				return false;
+			if (offset + LocalHeaderSize + nameLength + c.size > 0xffffffff)
+				return false;
+			e.localHeader = (uint32_t)offset;
+			if (WriteFile(e.header, LocalHeaderSize) &&
+				WriteFile((const DKUniChar8*)nameU8, nameLength) &&
+				WriteFile(c.data, c.size))
+			{
+				directory.Add(e);
+				return true;
+			}
+			// file is broken, cannot write anymore.
+			file = NULL;
+			return false;
+		}
+
+		DKObject<DKFile> file;		// NULL if finished
+		DKString filename;
+		uint64_t offset;
+		DKArray<DirectoryEntry> directory;
+		DKMutex lock;
+
+		DKZipParallelArchiver(const DKZipParallelArchiver&);
+		DKZipParallelArchiver& operator = (const DKZipParallelArchiver&);
+	};
+}
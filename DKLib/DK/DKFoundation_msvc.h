@@ -8,7 +8,12 @@
 
 // basic object templates and memory management.
 #include "DKFoundation_msvc/DKMemory.h"
+#include "DKFoundation_msvc/DKMemoryPool.h"
+#include "DKFoundation_msvc/DKMemoryStatistics.h"
+#include "DKFoundation_msvc/DKMemoryHugePage.h"
+#include "DKFoundation_msvc/DKArena.h"
 #include "DKFoundation_msvc/DKObject.h"
+#include "DKFoundation_msvc/DKSharedObject.h"
 #include "DKFoundation_msvc/DKAllocator.h"
 #include "DKFoundation_msvc/DKTypeInfo.h"
 #include "DKFoundation_msvc/DKTypeList.h"
@@ -22,6 +27,7 @@
 
 // data collections
 #include "DKFoundation_msvc/DKArray.h"
+#include "DKFoundation_msvc/DKSmallArray.h"
 #include "DKFoundation_msvc/DKCircularQueue.h"
 #include "DKFoundation_msvc/DKList.h"
 #include "DKFoundation_msvc/DKMap.h"
@@ -31,10 +37,14 @@
 #include "DKFoundation_msvc/DKStaticArray.h"
 #include "DKFoundation_msvc/DKTuple.h"
 #include "DKFoundation_msvc/DKQueue.h"
+#include "DKFoundation_msvc/DKConcurrentQueue.h"
 
 // hash, UUID
 #include "DKFoundation_msvc/DKHash.h"
 #include "DKFoundation_msvc/DKUUID.h"
+#include "DKFoundation_msvc/DKHashTable.h"
+#include "DKFoundation_msvc/DKHashMap.h"
+#include "DKFoundation_msvc/DKHashSet.h"
 
 // thread, mutex, synchronization objects.
 #include "DKFoundation_msvc/DKAtomicNumber32.h"
@@ -47,7 +57,10 @@
 #include "DKFoundation_msvc/DKSharedLock.h"
 #include "DKFoundation_msvc/DKSpinLock.h"
 #include "DKFoundation_msvc/DKThread.h"
+#include "DKFoundation_msvc/DKThreadLocal.h"
 #include "DKFoundation_msvc/DKCondition.h"
+#include "DKFoundation_msvc/DKAdaptiveLock.h"
+#include "DKFoundation_msvc/DKShardedFence.h"
 
 // stream, file, buffer, directory (file-system)
 #include "DKFoundation_msvc/DKData.h"
@@ -55,11 +68,18 @@
 #include "DKFoundation_msvc/DKDataStream.h"
 #include "DKFoundation_msvc/DKBuffer.h"
 #include "DKFoundation_msvc/DKBufferStream.h"
+#include "DKFoundation_msvc/DKDataSlice.h"
+#include "DKFoundation_msvc/DKDataChain.h"
 #include "DKFoundation_msvc/DKDirectory.h"
 #include "DKFoundation_msvc/DKFile.h"
 #include "DKFoundation_msvc/DKFileMap.h"
 #include "DKFoundation_msvc/DKZipArchiver.h"
 #include "DKFoundation_msvc/DKZipUnarchiver.h"
+#include "DKFoundation_msvc/DKDeflater.h"
+#include "DKFoundation_msvc/DKInflater.h"
+#include "DKFoundation_msvc/DKZipMappedUnarchiver.h"
+#include "DKFoundation_msvc/DKZipParallelArchiver.h"
+#include "DKFoundation_msvc/DKCompressor.h"
 
 // XML
 #include "DKFoundation_msvc/DKXMLParser.h"
@@ -80,12 +100,21 @@
 // run-loop, operation queue, message-handler
 #include "DKFoundation_msvc/DKMessageQueue.h"
 #include "DKFoundation_msvc/DKOperationQueue.h"
+#include "DKFoundation_msvc/DKParallel.h"
+#include "DKFoundation_msvc/DKWorkStealingQueue.h"
+#include "DKFoundation_msvc/DKTaskGraph.h"
+#include "DKFoundation_msvc/DKFuture.h"
+#include "DKFoundation_msvc/DKAsyncIO.h"
+#include "DKFoundation_msvc/DKCoroutine.h"
 #include "DKFoundation_msvc/DKRunLoop.h"
 #include "DKFoundation_msvc/DKRunLoopTimer.h"
+#include "DKFoundation_msvc/DKTimerWheel.h"
 
 // etc
 #include "DKFoundation_msvc/DKEndianness.h"
 #include "DKFoundation_msvc/DKError.h"
 #include "DKFoundation_msvc/DKLog.h"
+#include "DKFoundation_msvc/DKBufferedLog.h"
+#include "DKFoundation_msvc/DKTrace.h"
 #include "DKFoundation_msvc/DKUtils.h"
 
@@ -0,0 +1,444 @@
+//
+//  File: DKAdaptiveLock.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include <thread>
+#include <climits>
+#include <cerrno>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKCondition.h"
+
+#ifdef DKLIB_LINUX
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// DKAdaptiveLock, DKAdaptiveSharedLock, DKAdaptiveCondition
+// spin-then-park locks.
+//
+// lock is acquired with atomic operation when not contended. if contended,
+// thread spins with exponential backoff (pause instruction) for a while,
+// and parks (sleeps in kernel) if lock is not released yet. unlocking thread
+// wakes parked threads only if there are.
+// no spinning on single processor system.
+//
+// threads are parked with futex on Linux, and with condition table
+// (hashed by address) on other platforms.
+//
+// DKAdaptiveLock: replacement of DKSpinLock, DKMutex.
+// DKAdaptiveSharedLock: replacement of DKSharedLock, writer preferred.
+// DKAdaptiveCondition: replacement of DKCondition, has own DKAdaptiveLock.
+//
+// interfaces are same as replaced classes, can be used with
+// DKCriticalSection, DKAdaptiveSharedLockReadOnlySection.
+//
+// Note:
+//  recursive locking is not supported.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		enum
+		{
+			AdaptiveLockSpinCount = 16,		// backoff steps before parking
+			AdaptiveLockMaxBackoff = 64,	// max pause instructions per step
+		};
+
+		inline void CpuRelax(void)
+		{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+			_mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+			__builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+			__asm__ __volatile__("yield");
+#endif
+		}
+		// 0: not checked yet, 1: single processor, 2: multi processor
+		template <int N> struct AdaptiveLockProcessors
+		{
+			static std::atomic<int> type;
+		};
+		template <int N> std::atomic<int> AdaptiveLockProcessors<N>::type(0);
+
+		inline bool AdaptiveLockShouldSpin(void)
+		{
+			// checked on first use, threads may store same value at once.
+			int type = AdaptiveLockProcessors<0>::type.load(std::memory_order_relaxed);
+			if (type == 0)
+			{
+				type = std::thread::hardware_concurrency() > 1 ? 2 : 1;
+				AdaptiveLockProcessors<0>::type.store(type, std::memory_order_relaxed);
+			}
+			return type == 2;
+		}
+		// spin with backoff, returns false when spin count exceeded.
+		struct AdaptiveLockBackoff
+		{
+			AdaptiveLockBackoff(void) : count(0), pause(1)
+			{
+				if (!AdaptiveLockShouldSpin())
+					count = AdaptiveLockSpinCount;
+			}
+			bool Spin(void)
+			{
+				if (count >= AdaptiveLockSpinCount)
+					return false;
+				for (int i = 0; i < pause; ++i)
+					CpuRelax();
+				if (pause < AdaptiveLockMaxBackoff)
+					pause = pause * 2;
+				count++;
+				return true;
+			}
+			int count;
+			int pause;
+		};
+
+#ifdef DKLIB_LINUX
+		static_assert(sizeof(std::atomic<int>) == sizeof(int), "std::atomic<int> cannot be used with futex!");
+
+		// wait while value of addr is expected, can be woken spuriously.
+		// returns false if timed out. (negative timeout for infinite)
+		inline bool ParkWait(const std::atomic<int>* addr, int expected, double timeout = -1.0)
+		{
+			struct timespec ts;
+			struct timespec* pts = NULL;
+			if (timeout >= 0.0)
+			{
+				ts.tv_sec = static_cast<time_t>(timeout);
+				ts.tv_nsec = static_cast<long>((timeout - static_cast<double>(ts.tv_sec)) * 1000000000.0);
+				pts = &ts;
+			}
+			long r = syscall(SYS_futex, reinterpret_cast<const int*>(addr), FUTEX_WAIT_PRIVATE, expected, pts, NULL, 0);
+			return !(r == -1 && errno == ETIMEDOUT);
+		}
+		inline void ParkWake(const std::atomic<int>* addr, int count)
+		{
+			syscall(SYS_futex, reinterpret_cast<const int*>(addr), FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+		}
+#else
+		// parking threads with conditions, hashed by address.
+		// table is created on first use and never destroyed, locks can be
+		// used while other global objects being constructed or destroyed.
+		template <int N> struct ParkingTable
+		{
+			enum {NumBuckets = 64};
+			struct Buckets
+			{
+				DKCondition cond[NumBuckets];
+			};
+			static std::atomic<Buckets*> buckets;
+
+			// returns NULL if table cannot be allocated.
+			static DKCondition* Bucket(const void* addr)
+			{
+				Buckets* table = buckets.load(std::memory_order_acquire);
+				if (table == NULL)
+				{
+					void* mem = DKMemoryHeapAlloc(sizeof(Buckets));
+					if (mem == NULL)
+						return NULL;
+					Buckets* newTable = new(mem) Buckets();
+					if (buckets.compare_exchange_strong(table, newTable, std::memory_order_acq_rel))
+						table = newTable;
+					else
+					{
+						newTable->~Buckets();
+						DKMemoryHeapFree(newTable);
+					}
+				}
+				uintptr_t h = reinterpret_cast<uintptr_t>(addr);
+				h = (h >> 4) ^ (h >> 10);
+				return &table->cond[h % NumBuckets];
+			}
+		};
+		template <int N> std::atomic<typename ParkingTable<N>::Buckets*> ParkingTable<N>::buckets(NULL);
+
+		inline bool ParkWait(const std::atomic<int>* addr, int expected, double timeout = -1.0)
+		{
+			DKCondition* bucket = ParkingTable<0>::Bucket(addr);
+			if (bucket == NULL)
+			{
+				// cannot park, return as spurious wake-up.
+				std::this_thread::yield();
+				return true;
+			}
+			bool result = true;
+			DKCondition& cond = *bucket;
+			cond.Lock();
+			if (addr->load() == expected)
+			{
+				if (timeout >= 0.0)
+					result = cond.WaitTimeout(timeout);
+				else
+					cond.Wait();
+			}
+			cond.Unlock();
+			return result;
+		}
+		inline void ParkWake(const std::atomic<int>* addr, int)
+		{
+			// bucket can be shared by other addresses, wake all.
+			DKCondition* bucket = ParkingTable<0>::Bucket(addr);
+			if (bucket == NULL)
+				return;		// no thread could park.
+			DKCondition& cond = *bucket;
+			cond.Lock();
+			cond.Broadcast();
+			cond.Unlock();
+		}
+#endif
+	}
+
+	class DKAdaptiveLock
+	{
+	public:
+		DKAdaptiveLock(void) : state(Unlocked)
+		{
+		}
+		~DKAdaptiveLock(void)
+		{
+			DKASSERT_DEBUG(state.load() == Unlocked);
+		}
+		void Lock(void) const
+		{
+			int s = Unlocked;
+			if (state.compare_exchange_strong(s, Locked, std::memory_order_acquire))
+				return;
+
+			Private::AdaptiveLockBackoff backoff;
+			while (s != Contended && backoff.Spin())
+			{
+				s = state.load(std::memory_order_relaxed);
+				if (s == Unlocked && state.compare_exchange_weak(s, Locked, std::memory_order_acquire))
+					return;
+			}
+			// mark contended and park. (lock acquired as contended)
+			while (state.exchange(Contended, std::memory_order_acquire) != Unlocked)
+				Private::ParkWait(&state, Contended);
+		}
+		bool TryLock(void) const
+		{
+			int s = Unlocked;
+			return state.compare_exchange_strong(s, Locked, std::memory_order_acquire);
+		}
+		void Unlock(void) const
+		{
+			if (state.exchange(Unlocked, std::memory_order_release) == Contended)
+				Private::ParkWake(&state, 1);
+		}
+
+	private:
+		enum {Unlocked = 0, Locked, Contended};
+		mutable std::atomic<int> state;
+
+		DKAdaptiveLock(const DKAdaptiveLock&);
+		DKAdaptiveLock& operator = (const DKAdaptiveLock&);
+	};
+
+	class DKAdaptiveSharedLock
+	{
+	public:
+		DKAdaptiveSharedLock(void) : state(0)
+		{
+		}
+		~DKAdaptiveSharedLock(void)
+		{
+			DKASSERT_DEBUG((state.load() & (WriterLocked | ReaderMask)) == 0);
+		}
+		void LockShared(void) const
+		{
+			Private::AdaptiveLockBackoff backoff;
+			for (;;)
+			{
+				int s = state.load(std::memory_order_relaxed);
+				if ((s & (WriterLocked | WriterWaiting)) == 0)
+				{
+					if (state.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+						return;
+					continue;
+				}
+				if (!backoff.Spin())
+					Park(s);
+			}
+		}
+		bool TryLockShared(void) const
+		{
+			int s = state.load(std::memory_order_relaxed);
+			while ((s & (WriterLocked | WriterWaiting)) == 0)
+			{
+				if (state.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+					return true;
+			}
+			return false;
+		}
+		void UnlockShared(void) const
+		{
+			int s = state.fetch_sub(1, std::memory_order_release);
+			DKASSERT_DEBUG((s & ReaderMask) > 0);
+			if ((s & ReaderMask) == 1 && (s & Parked))
+				WakeAll();
+		}
+		void Lock(void) const
+		{
+			Private::AdaptiveLockBackoff backoff;
+			for (;;)
+			{
+				int s = state.load(std::memory_order_relaxed);
+				if ((s & (WriterLocked | ReaderMask)) == 0)
+				{
+					if (state.compare_exchange_weak(s, (s | WriterLocked) & ~WriterWaiting, std::memory_order_acquire))
+						return;
+					continue;
+				}
+				// block new readers.
+				if ((s & WriterWaiting) == 0)
+				{
+					if (!state.compare_exchange_weak(s, s | WriterWaiting, std::memory_order_relaxed))
+						continue;
+					s = s | WriterWaiting;
+				}
+				if (!backoff.Spin())
+					Park(s);
+			}
+		}
+		bool TryLock(void) const
+		{
+			int s = state.load(std::memory_order_relaxed);
+			while ((s & (WriterLocked | ReaderMask)) == 0)
+			{
+				if (state.compare_exchange_weak(s, (s | WriterLocked) & ~WriterWaiting, std::memory_order_acquire))
+					return true;
+			}
+			return false;
+		}
+		void Unlock(void) const
+		{
+			int s = state.fetch_and(~WriterLocked, std::memory_order_release);
+			DKASSERT_DEBUG(s & WriterLocked);
+			if (s & Parked)
+				WakeAll();
+		}
+
+	private:
+		enum
+		{
+			WriterLocked = 1 << 30,
+			WriterWaiting = 1 << 29,
+			Parked = 1 << 28,
+			ReaderMask = Parked - 1,
+		};
+		// sleep until state changed.
+		void Park(int s) const
+		{
+			if ((s & Parked) == 0)
+			{
+				if (!state.compare_exchange_strong(s, s | Parked, std::memory_order_relaxed))
+					return;
+				s = s | Parked;
+			}
+			Private::ParkWait(&state, s);
+		}
+		void WakeAll(void) const
+		{
+			if (state.fetch_and(~Parked, std::memory_order_relaxed) & Parked)
+				Private::ParkWake(&state, INT_MAX);
+		}
+
+		mutable std::atomic<int> state;
+
+		DKAdaptiveSharedLock(const DKAdaptiveSharedLock&);
+		DKAdaptiveSharedLock& operator = (const DKAdaptiveSharedLock&);
+	};
+
+	// context scope based helper class.
+	// use DKCriticalSecton for exclusive lock.
+	class DKAdaptiveSharedLockReadOnlySection
+	{
+	public:
+		DKAdaptiveSharedLockReadOnlySection(const DKAdaptiveSharedLock& sl) : lock(sl) { lock.LockShared(); }
+		~DKAdaptiveSharedLockReadOnlySection(void) { lock.UnlockShared(); }
+
+	private:
+		DKAdaptiveSharedLockReadOnlySection(const DKAdaptiveSharedLockReadOnlySection&);
+		DKAdaptiveSharedLockReadOnlySection& operator = (const DKAdaptiveSharedLockReadOnlySection&);
+		const DKAdaptiveSharedLock& lock;
+	};
+
+	class DKAdaptiveCondition
+	{
+	public:
+		DKAdaptiveCondition(void) : sequence(0), waiters(0)
+		{
+		}
+		// lock should be acquired before calling Wait, WaitTimeout.
+		void Wait(void) const
+		{
+			waiters.fetch_add(1);
+			int seq = sequence.load();
+			lock.Unlock();
+			Private::ParkWait(&sequence, seq);
+			waiters.fetch_sub(1);
+			lock.Lock();
+		}
+		// returns false if timed out.
+		bool WaitTimeout(double t) const
+		{
+			waiters.fetch_add(1);
+			int seq = sequence.load();
+			lock.Unlock();
+			bool result = Private::ParkWait(&sequence, seq, Max(t, 0.0));
+			waiters.fetch_sub(1);
+			lock.Lock();
+			return result;
+		}
+		void Signal(void) const
+		{
+			sequence.fetch_add(1);
+			if (waiters.load() > 0)
+				Private::ParkWake(&sequence, 1);
+		}
+		void Broadcast(void) const
+		{
+			sequence.fetch_add(1);
+			if (waiters.load() > 0)
+				Private::ParkWake(&sequence, INT_MAX);
+		}
+		void Lock(void) const
+		{
+			lock.Lock();
+		}
+		bool TryLock(void) const
+		{
+			return lock.TryLock();
+		}
+		void Unlock(void) const
+		{
+			lock.Unlock();
+		}
+
+	private:
+		DKAdaptiveLock lock;
+		mutable std::atomic<int> sequence;
+		mutable std::atomic<int> waiters;
+
+		DKAdaptiveCondition(const DKAdaptiveCondition&);
+		DKAdaptiveCondition& operator = (const DKAdaptiveCondition&);
+	};
+}
@@ -35,6 +35,9 @@
 //
 //  If you have to obtain element's pointer or reference, beware of thread-safety.
 //  CopyValue() function is always thread-safe.
+//
+//  Items are relocated by memmove if DKTriviallyRelocatable<VALUE> is true,
+//  otherwise items are moved by move-constructor. (see DKTypeTraits.h)
 ////////////////////////////////////////////////////////////////////////////////
 
 namespace DKFoundation
@@ -147,6 +150,22 @@ namespace DKFoundation
 			::new(&data[count]) VALUE(value);
 			return count++;
 		}
+		// append one item to tail, item will be moved.
+		Index Add(VALUE&& value)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(1);
+			::new(&data[count]) VALUE(static_cast<VALUE&&>(value));
+			return count++;
+		}
+		// construct one item at tail with arguments.
+		template <typename... Args> Index EmplaceBack(Args&&... args)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(1);
+			::new(&data[count]) VALUE(std::forward<Args>(args)...);
+			return count++;
+		}
 		// append 's' length of value to tail.
 		Index Add(const VALUE* value, size_t s)
 		{
@@ -194,11 +213,29 @@ namespace DKFoundation
 			if (pos > count)
 				pos = count;
 			if (pos < count)
-				memmove(&data[pos+1], &data[pos], sizeof(VALUE) * (count - pos));
+				Private::RelocateItems(&data[pos+1], &data[pos], count - pos);
 			::new(&data[pos]) VALUE(value);
 			count++;
 			return pos;
 		}
+		// insert one value into position 'pos', value will be moved.
+		Index Insert(VALUE&& value, Index pos)
+		{
+			return Emplace(pos, static_cast<VALUE&&>(value));
+		}
+		// construct one item at position 'pos' with arguments.
+		template <typename... Args> Index Emplace(Index pos, Args&&... args)
+		{
+			CriticalSection guard(lock);
+			ReserveItemCapsNL(1);
+			if (pos > count)
+				pos = count;
+			if (pos < count)
+				Private::RelocateItems(&data[pos+1], &data[pos], count - pos);
+			::new(&data[pos]) VALUE(std::forward<Args>(args)...);
+			count++;
+			return pos;
+		}
 		// insert 's' length of value into position 'pos'.
 		Index Insert(const VALUE* value, size_t s, Index pos)
 		{
@@ -207,7 +244,7 @@ namespace DKFoundation
 			if (pos > count)
 				pos = count;
 			if (pos < count)
-				memmove(&data[pos+s], &data[pos], sizeof(VALUE) * (count - pos));
+				Private::RelocateItems(&data[pos+s], &data[pos], count - pos);
 			for (Index i = 0; i < s; i++)
 				::new(&data[pos+i]) VALUE(value[i]);
 			count += s;
@@ -221,7 +258,7 @@ namespace DKFoundation
 			if (pos > count)
 				pos = count;
 			if (pos < count)
-				memmove(&data[pos+s], &data[pos], sizeof(VALUE) * (count - pos));
+				Private::RelocateItems(&data[pos+s], &data[pos], count - pos);
 			for (Index i = 0; i < s; i++)
 				::new(&data[pos+i]) VALUE(value);
 			count += s;
@@ -236,7 +273,7 @@ namespace DKFoundation
 			if (pos > count)
 				pos = count;
 			if (pos < count)
-				memmove(&data[pos+s], &data[pos], sizeof(VALUE) * (count - pos));
+				Private::RelocateItems(&data[pos+s], &data[pos], count - pos);
 			for (const VALUE& v : il)
 			{
 				::new(&data[pos]) VALUE(v);
@@ -253,7 +290,7 @@ namespace DKFoundation
 			{
 				data[pos].~VALUE();
 				if (count - pos > 1)
-					memmove(&data[pos], &data[pos+1], sizeof(VALUE) * (count-pos-1));
+					Private::RelocateItems(&data[pos], &data[pos+1], count-pos-1);
 				count--;
 			}
 			return count;
@@ -268,7 +305,7 @@ namespace DKFoundation
 				for (; i < count - pos && i < c; i++)
 					data[pos+i].~VALUE();
 				if (i > 0)
-					memmove(&data[pos], &data[pos+i], sizeof(VALUE) * (count-pos-i));
+					Private::RelocateItems(&data[pos], &data[pos+i], count-pos-i);
 				count -= i;
 			}
 			return count;
@@ -286,6 +323,11 @@ namespace DKFoundation
 			CriticalSection guard(lock);
 			return count;
 		}
+		// array should be locked from outside.
+		size_t CountNoLock(void) const
+		{
+			return count;
+		}
 		size_t Capacity(void) const
 		{
 			CriticalSection guard(lock);
@@ -590,10 +632,18 @@ namespace DKFoundation
 			if (c <= capacity)
 				return;
 
-			if (data)
+			if (data == NULL)
+				data = (VALUE*)Allocator::Alloc(sizeof(VALUE) * c);
+			else if (DKTriviallyRelocatable<VALUE>::Result)
 				data = (VALUE*)Allocator::Realloc(data, sizeof(VALUE) * c);
 			else
-				data = (VALUE*)Allocator::Alloc(sizeof(VALUE) * c);
+			{
+				// items should be moved by move-constructor.
+				VALUE* p = (VALUE*)Allocator::Alloc(sizeof(VALUE) * c);
+				Private::RelocateItems(p, data, count);
+				Allocator::Free(data);
+				data = p;
+			}
 
 			capacity = c;
 		}
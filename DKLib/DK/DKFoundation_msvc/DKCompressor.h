@@ -0,0 +1,1020 @@
+//
+//  File: DKCompressor.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include <string.h>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKMemory.h"
+#include "DKArray.h"
+#include "DKSpinLock.h"
+#include "DKCriticalSection.h"
+#include "DKData.h"
+#include "DKBuffer.h"
+#include "DKStream.h"
+#include "DKHash.h"
+#include "DKParallel.h"
+#include "DKDeflater.h"
+#include "DKInflater.h"
+
+#ifdef DKLIB_ZSTD_ENABLED
+#include <zstd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// DKCompressor
+// block compression with pluggable codecs, and framed data format.
+//
+// built-in codecs:
+//  MethodLZ4: LZ4 block format, fastest decompression. (level 1 ~ 9)
+//  MethodDeflate: raw deflate with DKDeflater, DKInflater. (level 1 ~ 9)
+//  MethodZstd: Zstandard, if DKLIB_ZSTD_ENABLED is defined. (level 1 ~ 22)
+//              (requires zstd.h and libzstd to be linked)
+// other codecs can be registered with RegisterCodec().
+//
+// compressed data is framed, frame header has codec, dictionary id and
+// content length. Decompress() detects codec from frame header, data without
+// frame header is decompressed with DKBuffer::Decompress(). (legacy format)
+// content is split into independent blocks, blocks are compressed and
+// decompressed concurrently. (DKParallelFor)
+// block which cannot be compressed is stored as is.
+//
+// Dictionary: content shared by compressor and decompressor, improves
+// compression of small data. (LZ4, Zstd only)
+// decompressor should have same dictionary, (identified by hash of content)
+//
+// streaming: Compress(input, output), Decompress(input, output) processes
+// streams block by block, memory usage is bounded by block size.
+//
+// Example:
+//  DKCompressor lz4(DKCompressor::MethodLZ4);
+//  DKObject<DKBuffer> packed = lz4.Compress(data);
+//  DKObject<DKBuffer> unpacked = DKCompressor::Decompress(packed);
+//
+//  DKObject<DKCompressor::Dictionary> dict = DKCompressor::Dictionary::Create(samples);
+//  DKCompressor zstd(DKCompressor::MethodZstd, 9, dict);
+//  zstd.Compress(fileStream, socketStream);
+//
+// Note:
+//  frame format:
+//   header: 'DKCF', method, dictionary id, block size, flags, content length
+//   blocks: uncompressed size, compressed size, [checksum], data
+//   end: uncompressed size = 0
+//  all values are little-endian.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKCompressor
+	{
+	public:
+		enum Method : uint32_t
+		{
+			MethodLZ4		= 'LZ4B',
+			MethodDeflate	= 'DFLT',
+			MethodZstd		= 'ZSTD',
+		};
+		enum : int
+		{
+			DefaultLevel = -1,			// codec default level
+		};
+		enum : size_t
+		{
+			DefaultBlockSize = 0x40000,
+			MaxBlockSize = 0x4000000,
+		};
+
+		class Dictionary
+		{
+		public:
+			Dictionary(const void* p, size_t len) : id(0)
+			{
+				if (p && len > 0)
+				{
+					content.Add(reinterpret_cast<const unsigned char*>(p), len);
+					id = (uint32_t)DKHashXX64(p, len);
+					if (id == 0)
+						id = 1;
+				}
+			}
+			static DKObject<Dictionary> Create(const DKData* data)
+			{
+				DKObject<Dictionary> dict = NULL;
+				if (data)
+				{
+					const void* p = data->LockShared();
+					if (p)
+						dict = DKOBJECT_NEW Dictionary(p, data->Length());
+					data->UnlockShared();
+				}
+				return dict;
+			}
+			uint32_t Id(void) const					{return id;}	// 0 if empty
+			const unsigned char* Content(void) const	{return content;}
+			size_t Length(void) const				{return content.Count();}
+
+		private:
+			DKArray<unsigned char> content;
+			uint32_t id;
+		};
+
+		// codec interface, should be thread-safe.
+		class Codec
+		{
+		public:
+			virtual ~Codec(void) {}
+			// maximum compressed size of block.
+			virtual size_t Bound(size_t length) const = 0;
+			// returns compressed size, 0 if failed.
+			virtual size_t Compress(const void* input, size_t inputLength, void* output, size_t outputSize, int level, const Dictionary* dict) const = 0;
+			// decode exactly outputLength bytes, returns false if failed.
+			virtual bool Decompress(const void* input, size_t inputLength, void* output, size_t outputLength, const Dictionary* dict) const = 0;
+			virtual bool IsDictionarySupported(void) const = 0;
+		};
+
+		// register codec for method, returns false if method is registered.
+		// registered codec cannot be removed.
+		static bool RegisterCodec(uint32_t method, Codec* codec)
+		{
+			Registry* reg = GetRegistry();
+			return codec && reg ? reg->Register(method, codec) : false;
+		}
+		static Codec* FindCodec(uint32_t method)
+		{
+			Registry* reg = GetRegistry();
+			return reg ? reg->Find(method) : NULL;
+		}
+
+		struct FrameInfo
+		{
+			uint32_t method;
+			uint32_t dictionaryId;		// 0 if not used.
+			size_t blockSize;
+			uint64_t contentLength;		// (uint64_t)-1 if unknown.
+			bool checksum;
+		};
+
+		explicit DKCompressor(uint32_t method = MethodLZ4, int level = DefaultLevel, Dictionary* dict = NULL, size_t blockSize = DefaultBlockSize)
+			: method(method), level(level), dictionary(dict), blockSize(Clamp<size_t>(blockSize, 0x1000, MaxBlockSize)), checksum(false)
+		{
+		}
+		~DKCompressor(void)
+		{
+		}
+
+		// verify each block with checksum while decompressing. (XXH64)
+		void SetChecksumEnabled(bool enable)		{checksum = enable;}
+		bool IsChecksumEnabled(void) const			{return checksum;}
+		uint32_t CompressionMethod(void) const		{return method;}
+		int CompressionLevel(void) const			{return level;}
+		Dictionary* CompressionDictionary(void)		{return dictionary;}
+		size_t BlockSize(void) const				{return blockSize;}
+
+		// compress into framed data.
+		DKObject<DKBuffer> Compress(const void* p, size_t len, DKAllocator& alloc = DKAllocator::DefaultAllocator()) const
+		{
+			const Codec* codec = FindCodec(method);
+			if (codec == NULL || (p == NULL && len > 0))
+				return NULL;
+
+			size_t numBlocks = (len + blockSize - 1) / blockSize;
+			size_t slotSize = BlockHeaderSize + ChecksumSize + Max(codec->Bound(blockSize), blockSize);
+			unsigned char* temp = NULL;
+			if (numBlocks > 0)
+			{
+				temp = (unsigned char*)DKMemoryHeapAlloc(slotSize * numBlocks);
+				if (temp == NULL)
+					return NULL;
+			}
+			size_t* sizes = NULL;
+			if (numBlocks > 0)
+				sizes = (size_t*)DKMemoryHeapAlloc(sizeof(size_t) * numBlocks);
+
+			size_t total = 0;
+			if (numBlocks == 0 || sizes)
+			{
+				const unsigned char* input = reinterpret_cast<const unsigned char*>(p);
+				DKParallelFor(0, numBlocks, [&](size_t i)
+				{
+					size_t offset = i * blockSize;
+					sizes[i] = EncodeBlock(codec, input + offset, Min(blockSize, len - offset), temp + i * slotSize, slotSize);
+				}, 1);
+				total = FrameHeaderSize + BlockHeaderSize;
+				for (size_t i = 0; i < numBlocks; ++i)
+					total += sizes[i];
+			}
+
+			DKObject<DKBuffer> buffer = NULL;
+			if (total > 0)
+			{
+				buffer = DKBuffer::Create(NULL, total, alloc);
+				unsigned char* out = buffer ? (unsigned char*)buffer->LockExclusive() : NULL;
+				if (out)
+				{
+					size_t pos = WriteFrameHeader(codec, out, len);
+					for (size_t i = 0; i < numBlocks; ++i)
+					{
+						memcpy(out + pos, temp + i * slotSize, sizes[i]);
+						pos += sizes[i];
+					}
+					memset(out + pos, 0, BlockHeaderSize);		// end of frame
+				}
+				if (buffer)
+					buffer->UnlockExclusive();
+				if (out == NULL)
+					buffer = NULL;
+			}
+			if (sizes)
+				DKMemoryHeapFree(sizes);
+			if (temp)
+				DKMemoryHeapFree(temp);
+			return buffer;
+		}
+		DKObject<DKBuffer> Compress(const DKData* data, DKAllocator& alloc = DKAllocator::DefaultAllocator()) const
+		{
+			DKObject<DKBuffer> buffer = NULL;
+			if (data)
+			{
+				const void* p = data->LockShared();
+				buffer = Compress(p, data->Length(), alloc);
+				data->UnlockShared();
+			}
+			return buffer;
+		}
+		// compress input stream into output stream. (whole remaining input)
+		// blocks of each batch are compressed concurrently.
+		bool Compress(DKStream* input, DKStream* output) const
+		{
+			const Codec* codec = FindCodec(method);
+			if (codec == NULL || input == NULL || output == NULL || !input->IsReadable() || !output->IsWritable())
+				return false;
+
+			uint64_t contentLength = input->IsSeekable() ? (uint64_t)input->RemainLength() : (uint64_t)-1;
+			unsigned char header[FrameHeaderSize];
+			WriteFrameHeader(codec, header, contentLength);
+			if (output->Write(header, FrameHeaderSize) != FrameHeaderSize)
+				return false;
+
+			size_t batch = Private::Parallel::NumThreads();
+			size_t slotSize = BlockHeaderSize + ChecksumSize + Max(codec->Bound(blockSize), blockSize);
+			unsigned char* in = (unsigned char*)DKMemoryHeapAlloc(blockSize * batch);
+			unsigned char* out = (unsigned char*)DKMemoryHeapAlloc(slotSize * batch);
+			size_t* sizes = (size_t*)DKMemoryHeapAlloc(sizeof(size_t) * batch);
+			bool result = in && out && sizes;
+			uint64_t processed = 0;
+			while (result)
+			{
+				size_t length = 0;
+				while (length < blockSize * batch)
+				{
+					size_t n = input->Read(in + length, blockSize * batch - length);
+					if (n == 0 || n == (size_t)-1)
+						break;
+					length += n;
+				}
+				if (length == 0)
+					break;
+				processed += length;
+
+				size_t numBlocks = (length + blockSize - 1) / blockSize;
+				DKParallelFor(0, numBlocks, [&](size_t i)
+				{
+					size_t offset = i * blockSize;
+					sizes[i] = EncodeBlock(codec, in + offset, Min(blockSize, length - offset), out + i * slotSize, slotSize);
+				}, 1);
+				for (size_t i = 0; i < numBlocks && result; ++i)
+					result = sizes[i] > 0 && output->Write(out + i * slotSize, sizes[i]) == sizes[i];
+				if (length < blockSize * batch)
+					break;
+			}
+			if (sizes)
+				DKMemoryHeapFree(sizes);
+			if (out)
+				DKMemoryHeapFree(out);
+			if (in)
+				DKMemoryHeapFree(in);
+
+			if (result && contentLength != (uint64_t)-1 && contentLength != processed)
+				result = false;
+			if (result)
+			{
+				unsigned char end[BlockHeaderSize] = {0};
+				result = output->Write(end, BlockHeaderSize) == BlockHeaderSize;
+			}
+			return result;
+		}
+
+		// true if data begins with frame header.
+		static bool GetFrameInfo(const void* p, size_t len, FrameInfo& info)
+		{
+			const unsigned char* h = reinterpret_cast<const unsigned char*>(p);
+			if (h == NULL || len < FrameHeaderSize || memcmp(h, "DKCF", 4) != 0)
+				return false;
+			info.method = Read32(h + 4);
+			info.dictionaryId = Read32(h + 8);
+			info.blockSize = Read32(h + 12);
+			info.checksum = (Read32(h + 16) & FlagChecksum) != 0;
+			info.contentLength = Read64(h + 20);
+			return info.blockSize > 0 && info.blockSize <= MaxBlockSize;
+		}
+		static bool IsCompressed(const void* p, size_t len)
+		{
+			FrameInfo info;
+			return GetFrameInfo(p, len, info);
+		}
+
+		// decompress framed data, blocks are decompressed concurrently.
+		// data without frame header is decompressed with DKBuffer::Decompress.
+		static DKObject<DKBuffer> Decompress(const void* p, size_t len, const Dictionary* dict = NULL, DKAllocator& alloc = DKAllocator::DefaultAllocator())
+		{
+			FrameInfo info;
+			if (!GetFrameInfo(p, len, info))
+				return DKBuffer::Decompress(p, len, alloc);
+			const Codec* codec = FindCodec(info.method);
+			if (codec == NULL || !IsDictionaryMatched(info, dict))
+				return NULL;
+
+			// locate blocks.
+			struct Block
+			{
+				const unsigned char* data;
+				size_t compressedSize;
+				size_t length;
+				uint64_t offset;
+				uint32_t checksum;
+				bool stored;
+			};
+			DKArray<Block> blocks;
+			const unsigned char* begin = reinterpret_cast<const unsigned char*>(p);
+			size_t pos = FrameHeaderSize;
+			uint64_t total = 0;
+			while (true)
+			{
+				Block b;
+				size_t next = ReadBlockHeader(info, begin + pos, len - pos, b.length, b.compressedSize, b.stored, b.checksum);
+				if (next == 0)
+					return NULL;
+				pos += next;
+				if (b.length == 0)
+					break;
+				if (b.compressedSize > len - pos)
+					return NULL;
+				b.data = begin + pos;
+				b.offset = total;
+				pos += b.compressedSize;
+				total += b.length;
+				blocks.Add(b);
+			}
+			if ((info.contentLength != (uint64_t)-1 && info.contentLength != total) || total != (size_t)total)
+				return NULL;
+
+			if (total == 0)		// empty content, not an error.
+				return DKOBJECT_NEW DKBuffer(alloc);
+			DKObject<DKBuffer> buffer = DKBuffer::Create(NULL, (size_t)total, alloc);
+			if (buffer == NULL)
+				return NULL;
+			DKAtomicNumber32 failed = 0;
+			unsigned char* out = (unsigned char*)buffer->LockExclusive();
+			if (out)
+			{
+				DKParallelFor(0, blocks.Count(), [&](size_t i)
+				{
+					const Block& b = blocks.Value(i);
+					if (!DecodeBlock(codec, info, dict, b.data, b.compressedSize, b.stored, b.checksum, out + b.offset, b.length))
+						failed = 1;
+				}, 1);
+			}
+			else
+				failed = 1;
+			buffer->UnlockExclusive();
+			if (failed != 0)
+				return NULL;
+			return buffer;
+		}
+		static DKObject<DKBuffer> Decompress(const DKData* data, const Dictionary* dict = NULL, DKAllocator& alloc = DKAllocator::DefaultAllocator())
+		{
+			DKObject<DKBuffer> buffer = NULL;
+			if (data)
+			{
+				const void* p = data->LockShared();
+				buffer = Decompress(p, data->Length(), dict, alloc);
+				data->UnlockShared();
+			}
+			return buffer;
+		}
+		// decompress framed data from input stream into output stream.
+		static bool Decompress(DKStream* input, DKStream* output, const Dictionary* dict = NULL)
+		{
+			if (input == NULL || output == NULL || !input->IsReadable() || !output->IsWritable())
+				return false;
+			unsigned char header[FrameHeaderSize];
+			FrameInfo info;
+			if (ReadStream(input, header, FrameHeaderSize) != FrameHeaderSize || !GetFrameInfo(header, FrameHeaderSize, info))
+				return false;
+			const Codec* codec = FindCodec(info.method);
+			if (codec == NULL || !IsDictionaryMatched(info, dict))
+				return false;
+
+			size_t inputSize = Max(codec->Bound(info.blockSize), info.blockSize);
+			unsigned char* in = (unsigned char*)DKMemoryHeapAlloc(inputSize + BlockHeaderSize + ChecksumSize);
+			unsigned char* out = (unsigned char*)DKMemoryHeapAlloc(info.blockSize);
+			bool result = in && out;
+			uint64_t total = 0;
+			while (result)
+			{
+				size_t headerSize = BlockHeaderSize + (info.checksum ? (size_t)ChecksumSize : 0);
+				if (ReadStream(input, in, BlockHeaderSize) != BlockHeaderSize)
+				{
+					result = false;
+					break;
+				}
+				if (Read32(in) != 0 && headerSize > BlockHeaderSize && ReadStream(input, in + BlockHeaderSize, ChecksumSize) != ChecksumSize)
+				{
+					result = false;
+					break;
+				}
+				size_t length, compressedSize;
+				bool stored;
+				uint32_t check;
+				if (ReadBlockHeader(info, in, headerSize, length, compressedSize, stored, check) == 0)
+				{
+					result = false;
+					break;
+				}
+				if (length == 0)
+					break;
+				result = compressedSize <= inputSize &&
+					ReadStream(input, in, compressedSize) == compressedSize &&
+					DecodeBlock(codec, info, dict, in, compressedSize, stored, check, out, length) &&
+					output->Write(out, length) == length;
+				total += length;
+			}
+			if (out)
+				DKMemoryHeapFree(out);
+			if (in)
+				DKMemoryHeapFree(in);
+			return result && (info.contentLength == (uint64_t)-1 || info.contentLength == total);
+		}
+
+	private:
+		enum
+		{
+			FrameHeaderSize = 28,
+			BlockHeaderSize = 8,
+			ChecksumSize = 4,
+			FlagChecksum = 1,
+			StoredBlockFlag = 0x80000000,
+		};
+		uint32_t method;
+		int level;
+		DKObject<Dictionary> dictionary;
+		size_t blockSize;
+		bool checksum;
+
+		static void Write32(unsigned char* p, uint32_t v)
+		{
+			p[0] = (unsigned char)(v);
+			p[1] = (unsigned char)(v >> 8);
+			p[2] = (unsigned char)(v >> 16);
+			p[3] = (unsigned char)(v >> 24);
+		}
+		static uint32_t Read32(const unsigned char* p)
+		{
+			return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+		static uint64_t Read64(const unsigned char* p)
+		{
+			return (uint64_t)Read32(p) | ((uint64_t)Read32(p + 4) << 32);
+		}
+		static size_t ReadStream(DKStream* s, void* p, size_t len)
+		{
+			size_t total = 0;
+			while (total < len)
+			{
+				size_t n = s->Read(reinterpret_cast<unsigned char*>(p) + total, len - total);
+				if (n == 0 || n == (size_t)-1)
+					break;
+				total += n;
+			}
+			return total;
+		}
+		static uint32_t BlockChecksum(const void* p, size_t len)
+		{
+			return (uint32_t)DKHashXX64(p, len);
+		}
+		static bool IsDictionaryMatched(const FrameInfo& info, const Dictionary* dict)
+		{
+			return info.dictionaryId == 0 || (dict && dict->Id() == info.dictionaryId);
+		}
+		const Dictionary* UsedDictionary(const Codec* codec) const
+		{
+			if (dictionary && dictionary->Id() != 0 && codec->IsDictionarySupported())
+				return dictionary.Ptr();
+			return NULL;
+		}
+
+		size_t WriteFrameHeader(const Codec* codec, unsigned char* p, uint64_t contentLength) const
+		{
+			const Dictionary* dict = UsedDictionary(codec);
+			memcpy(p, "DKCF", 4);
+			Write32(p + 4, method);
+			Write32(p + 8, dict ? dict->Id() : 0);
+			Write32(p + 12, (uint32_t)blockSize);
+			Write32(p + 16, checksum ? (uint32_t)FlagChecksum : 0);
+			Write32(p + 20, (uint32_t)contentLength);
+			Write32(p + 24, (uint32_t)(contentLength >> 32));
+			return FrameHeaderSize;
+		}
+		// encode block with header, returns size including block header.
+		size_t EncodeBlock(const Codec* codec, const unsigned char* input, size_t length, unsigned char* output, size_t outputSize) const
+		{
+			size_t headerSize = BlockHeaderSize + (checksum ? (size_t)ChecksumSize : 0);
+			size_t compressed = codec->Compress(input, length, output + headerSize, outputSize - headerSize, level, UsedDictionary(codec));
+			bool stored = compressed == 0 || compressed >= length;
+			if (stored)
+			{
+				memcpy(output + headerSize, input, length);
+				compressed = length;
+			}
+			Write32(output, (uint32_t)length);
+			Write32(output + 4, (uint32_t)compressed | (stored ? (uint32_t)StoredBlockFlag : 0));
+			if (checksum)
+				Write32(output + BlockHeaderSize, BlockChecksum(input, length));
+			return headerSize + compressed;
+		}
+		// read block header, returns header size, 0 if invalid.
+		static size_t ReadBlockHeader(const FrameInfo& info, const unsigned char* p, size_t available, size_t& length, size_t& compressedSize, bool& stored, uint32_t& check)
+		{
+			if (available < BlockHeaderSize)
+				return 0;
+			length = Read32(p);
+			if (length == 0)
+				return BlockHeaderSize;		// end of frame
+			uint32_t c = Read32(p + 4);
+			stored = (c & StoredBlockFlag) != 0;
+			compressedSize = c & ~(uint32_t)StoredBlockFlag;
+			size_t headerSize = BlockHeaderSize + (info.checksum ? (size_t)ChecksumSize : 0);
+			check = info.checksum && available >= headerSize ? Read32(p + BlockHeaderSize) : 0;
+			if (length > info.blockSize || available < headerSize || (stored && compressedSize != length))
+				return 0;
+			return headerSize;
+		}
+		static bool DecodeBlock(const Codec* codec, const FrameInfo& info, const Dictionary* dict, const unsigned char* input, size_t compressedSize, bool stored, uint32_t check, unsigned char* output, size_t length)
+		{
+			if (stored)
+				memcpy(output, input, length);
+			else if (!codec->Decompress(input, compressedSize, output, length, info.dictionaryId ? dict : NULL))
+				return false;
+			return !info.checksum || BlockChecksum(output, length) == check;
+		}
+
+		////////////////////////////////////////////////////////////////////////////////
+		// LZ4 block format codec.
+		class LZ4Codec : public Codec
+		{
+		public:
+			enum
+			{
+				MinMatch = 4,
+				LastLiterals = 5,
+				MatchFindLimit = 12,
+				MaxDistance = 0xffff,
+				HashBits = 16,		// hash chain
+				FastHashBits = 12,	// level 1
+				HashSize = 1 << HashBits,
+			};
+			size_t Bound(size_t length) const
+			{
+				return length + length / 255 + 16;
+			}
+			bool IsDictionarySupported(void) const	{return true;}
+
+			// level 1 is greedy with single probe (with skipping), higher levels
+			// search hash chain deeper.
+			size_t Compress(const void* input, size_t inputLength, void* output, size_t outputSize, int level, const Dictionary* dict) const
+			{
+				level = level < 0 ? 1 : Clamp(level, 1, 9);
+				size_t dictLength = dict ? Min<size_t>(dict->Length(), MaxDistance) : 0;
+
+				// dictionary is placed before input, as prefix.
+				size_t headSize = sizeof(uint32_t) * (level > 1 ? HashSize : (1 << FastHashBits));
+				size_t chainSize = level > 1 ? sizeof(uint16_t) * HashSize : 0;
+				size_t workSize = headSize + chainSize + (dictLength ? dictLength + inputLength : 0);
+				unsigned char* work = (unsigned char*)DKMemoryHeapAlloc(workSize);
+				if (work == NULL)
+					return 0;
+				uint32_t* head = reinterpret_cast<uint32_t*>(work);
+				uint16_t* chain = level > 1 ? reinterpret_cast<uint16_t*>(work + headSize) : NULL;
+				const unsigned char* base = reinterpret_cast<const unsigned char*>(input);
+				if (dictLength)
+				{
+					unsigned char* prefix = work + headSize + chainSize;
+					memcpy(prefix, dict->Content() + dict->Length() - dictLength, dictLength);
+					memcpy(prefix + dictLength, input, inputLength);
+					base = prefix;
+				}
+				memset(head, 0, headSize);
+				size_t result = Encode(base, dictLength, dictLength + inputLength, reinterpret_cast<unsigned char*>(output), outputSize, head, chain, level);
+				DKMemoryHeapFree(work);
+				return result;
+			}
+			bool Decompress(const void* input, size_t inputLength, void* output, size_t outputLength, const Dictionary* dict) const
+			{
+				const unsigned char* ip = reinterpret_cast<const unsigned char*>(input);
+				const unsigned char* const iend = ip + inputLength;
+				unsigned char* const out = reinterpret_cast<unsigned char*>(output);
+				unsigned char* op = out;
+				unsigned char* const oend = out + outputLength;
+				const unsigned char* dictEnd = dict ? dict->Content() + dict->Length() : NULL;
+				size_t dictLength = dict ? dict->Length() : 0;
+
+				while (ip < iend)
+				{
+					unsigned int token = *ip++;
+					size_t literals = token >> 4;
+					if (literals < 15 && iend - ip >= 18 && oend - op >= 40)
+					{
+						// short literals, not a last sequence. (wild copy)
+						memcpy(op, ip, 16);
+						op += literals;
+						ip += literals;
+					}
+					else
+					{
+						if (literals == 15)
+						{
+							unsigned int b;
+							do {
+								if (ip >= iend)
+									return false;
+								b = *ip++;
+								literals += b;
+							} while (b == 255);
+						}
+						if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op))
+							return false;
+						memcpy(op, ip, literals);
+						op += literals;
+						ip += literals;
+						if (ip == iend)
+							break;		// last sequence
+						if (iend - ip < 2)
+							return false;
+					}
+
+					size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+					ip += 2;
+					size_t length = token & 15;
+					if (length < 15 && offset >= 8 && offset <= (size_t)(op - out) && oend - op >= 24)
+					{
+						// short match, up to 18 bytes.
+						const unsigned char* match = op - offset;
+						memcpy(op, match, 8);
+						memcpy(op + 8, match + 8, 8);
+						memcpy(op + 16, match + 16, 8);
+						op += length + MinMatch;
+						continue;
+					}
+					if (length == 15)
+					{
+						unsigned int b;
+						do {
+							if (ip >= iend)
+								return false;
+							b = *ip++;
+							length += b;
+						} while (b == 255);
+					}
+					length += MinMatch;
+					if (offset == 0 || length > (size_t)(oend - op))
+						return false;
+
+					size_t produced = op - out;
+					if (offset > produced)
+					{
+						// match begins in dictionary.
+						size_t back = offset - produced;
+						if (back > dictLength)
+							return false;
+						size_t n = Min(back, length);
+						memcpy(op, dictEnd - back, n);
+						op += n;
+						length -= n;
+					}
+					const unsigned char* match = op - offset;
+					if (offset >= 8 && oend - op >= (ptrdiff_t)(length + 8))
+					{
+						for (size_t i = 0; i < length; i += 8)
+							memcpy(op + i, match + i, 8);
+					}
+					else
+					{
+						for (size_t i = 0; i < length; ++i)
+							op[i] = match[i];
+					}
+					op += length;
+				}
+				return op == oend && ip == iend;
+			}
+
+		private:
+			static uint32_t Read32(const unsigned char* p)
+			{
+				uint32_t v;
+				memcpy(&v, p, 4);
+				return v;
+			}
+			// length of common prefix, compares 8 bytes at once.
+			static size_t MatchLength(const unsigned char* a, const unsigned char* b, size_t limit)
+			{
+				size_t length = MinMatch;
+				while (length + 8 <= limit)
+				{
+					uint64_t x, y;
+					memcpy(&x, a + length, 8);
+					memcpy(&y, b + length, 8);
+					if (x != y)
+						break;
+					length += 8;
+				}
+				while (length < limit && a[length] == b[length])
+					length++;
+				return length;
+			}
+			static unsigned int Hash(const unsigned char* p, unsigned int bits)
+			{
+				return (Read32(p) * 2654435761U) >> (32 - bits);
+			}
+			static bool WriteLength(unsigned char*& op, const unsigned char* oend, size_t length)
+			{
+				while (length >= 255)
+				{
+					if (op >= oend)
+						return false;
+					*op++ = 255;
+					length -= 255;
+				}
+				if (op >= oend)
+					return false;
+				*op++ = (unsigned char)length;
+				return true;
+			}
+			static bool WriteSequence(unsigned char*& op, const unsigned char* oend, const unsigned char* literals, size_t numLiterals, size_t offset, size_t matchLength)
+			{
+				if ((size_t)(oend - op) < numLiterals + numLiterals / 255 + 4)
+					return false;
+				unsigned char* token = op++;
+				unsigned int t = (unsigned int)Min<size_t>(numLiterals, 15) << 4;
+				if (numLiterals >= 15 && !WriteLength(op, oend, numLiterals - 15))
+					return false;
+				if (numLiterals > 0)
+					memcpy(op, literals, numLiterals);
+				op += numLiterals;
+				if (matchLength > 0)
+				{
+					if (oend - op < 2)
+						return false;
+					op[0] = (unsigned char)offset;
+					op[1] = (unsigned char)(offset >> 8);
+					op += 2;
+					size_t ml = matchLength - MinMatch;
+					t |= (unsigned int)Min<size_t>(ml, 15);
+					if (ml >= 15 && !WriteLength(op, oend, ml - 15))
+						return false;
+				}
+				*token = (unsigned char)t;
+				return true;
+			}
+			static void Insert(const unsigned char* base, size_t pos, uint32_t* head, uint16_t* chain)
+			{
+				Insert(pos, Hash(base + pos, chain ? HashBits : FastHashBits), head, chain);
+			}
+			static void Insert(size_t pos, unsigned int h, uint32_t* head, uint16_t* chain)
+			{
+				if (chain)
+				{
+					size_t delta = head[h] ? pos - (head[h] - 1) : 0;
+					chain[pos & (HashSize - 1)] = (uint16_t)(delta > MaxDistance ? 0 : delta);
+				}
+				head[h] = (uint32_t)pos + 1;
+			}
+			// encode base[start, end), base[0, start) is dictionary.
+			static size_t Encode(const unsigned char* base, size_t start, size_t end, unsigned char* output, size_t outputSize, uint32_t* head, uint16_t* chain, int level)
+			{
+				unsigned char* op = output;
+				const unsigned char* oend = output + outputSize;
+				size_t anchor = start;
+				if (end - start > MatchFindLimit)
+				{
+					const size_t matchLimit = end - LastLiterals;		// match should end before
+					const size_t findLimit = end - MatchFindLimit;		// match should start before
+					const unsigned int maxAttempts = 1U << (level - 1);
+
+					for (size_t pos = start >= MaxDistance ? start - MaxDistance : 0; pos + MinMatch <= start; ++pos)
+						Insert(base, pos, head, chain);
+
+					size_t pos = start;
+					unsigned int misses = 0;
+					while (pos < findLimit)
+					{
+						// find longest match.
+						size_t bestLength = 0;
+						size_t bestOffset = 0;
+						unsigned int hash = Hash(base + pos, chain ? HashBits : FastHashBits);
+						uint32_t candidate = head[hash];
+						uint32_t value = Read32(base + pos);
+						for (unsigned int attempt = 0; candidate > 0 && attempt < maxAttempts; ++attempt)
+						{
+							size_t c = candidate - 1;
+							if (pos - c > MaxDistance)
+								break;
+							if (Read32(base + c) == value)
+							{
+								size_t length = MatchLength(base + c, base + pos, matchLimit - pos);
+								if (length > bestLength)
+								{
+									bestLength = length;
+									bestOffset = pos - c;
+								}
+							}
+							if (chain == NULL)
+								break;
+							uint16_t delta = chain[c & (HashSize - 1)];
+							if (delta == 0 || delta > c)
+								break;
+							candidate = (uint32_t)(c - delta) + 1;
+						}
+						Insert(pos, hash, head, chain);
+
+						if (bestLength < MinMatch)
+						{
+							// skip faster in incompressible data. (level 1 only)
+							size_t step = chain ? 1 : 1 + (misses++ >> 6);
+							pos += step;
+							continue;
+						}
+						misses = 0;
+						// extend backward.
+						while (pos > anchor && pos - bestOffset > 0 && base[pos - 1] == base[pos - bestOffset - 1])
+						{
+							pos--;
+							bestLength++;
+						}
+						if (!WriteSequence(op, oend, base + anchor, pos - anchor, bestOffset, bestLength))
+							return 0;
+						size_t matchEnd = pos + bestLength;
+						if (chain)
+						{
+							for (size_t i = pos + 1; i < matchEnd && i + MinMatch <= end; ++i)
+								Insert(base, i, head, chain);
+						}
+						else if (matchEnd - 2 >= pos && matchEnd + 2 <= end)
+							Insert(base, matchEnd - 2, head, chain);
+						pos = matchEnd;
+						anchor = pos;
+					}
+				}
+				if (!WriteSequence(op, oend, base + anchor, end - anchor, 0, 0))
+					return 0;
+				return op - output;
+			}
+		};
+
+		////////////////////////////////////////////////////////////////////////////////
+		// raw deflate codec (DKDeflater, DKInflater)
+		class DeflateCodec : public Codec
+		{
+		public:
+			size_t Bound(size_t length) const				{return DKDeflater::Bound(length);}
+			bool IsDictionarySupported(void) const			{return false;}
+			size_t Compress(const void* input, size_t inputLength, void* output, size_t outputSize, int level, const Dictionary*) const
+			{
+				return DKDeflater::Deflate(input, inputLength, output, outputSize, level < 0 ? (int)DKDeflater::DefaultLevel : Clamp(level, 1, 9));
+			}
+			bool Decompress(const void* input, size_t inputLength, void* output, size_t outputLength, const Dictionary*) const
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(DKInflater));
+				if (mem == NULL)
+					return false;
+				DKInflater* inflater = new(mem) DKInflater(input, inputLength);
+				size_t decoded = inflater->Inflate(output, outputLength);
+				bool result = decoded == outputLength && !inflater->IsError();
+				inflater->~DKInflater();
+				DKMemoryHeapFree(inflater);
+				return result;
+			}
+		};
+
+#ifdef DKLIB_ZSTD_ENABLED
+		////////////////////////////////////////////////////////////////////////////////
+		// Zstandard codec (libzstd)
+		class ZstdCodec : public Codec
+		{
+		public:
+			size_t Bound(size_t length) const				{return ZSTD_compressBound(length);}
+			bool IsDictionarySupported(void) const			{return true;}
+			size_t Compress(const void* input, size_t inputLength, void* output, size_t outputSize, int level, const Dictionary* dict) const
+			{
+				ZSTD_CCtx* ctx = ZSTD_createCCtx();
+				if (ctx == NULL)
+					return 0;
+				level = level < 0 ? ZSTD_CLEVEL_DEFAULT : Clamp(level, 1, ZSTD_maxCLevel());
+				size_t result = ZSTD_compress_usingDict(ctx, output, outputSize, input, inputLength,
+														dict ? dict->Content() : NULL, dict ? dict->Length() : 0, level);
+				ZSTD_freeCCtx(ctx);
+				return ZSTD_isError(result) ? 0 : result;
+			}
+			bool Decompress(const void* input, size_t inputLength, void* output, size_t outputLength, const Dictionary* dict) const
+			{
+				ZSTD_DCtx* ctx = ZSTD_createDCtx();
+				if (ctx == NULL)
+					return false;
+				size_t result = ZSTD_decompress_usingDict(ctx, output, outputLength, input, inputLength,
+														  dict ? dict->Content() : NULL, dict ? dict->Length() : 0);
+				ZSTD_freeDCtx(ctx);
+				return !ZSTD_isError(result) && result == outputLength;
+			}
+		};
+#endif
+
+		////////////////////////////////////////////////////////////////////////////////
+		// codec registry, built-in codecs are registered when created.
+		class Registry
+		{
+		public:
+			Registry(void)
+			{
+				Register(MethodLZ4, DKOBJECT_NEW LZ4Codec());
+				Register(MethodDeflate, DKOBJECT_NEW DeflateCodec());
+#ifdef DKLIB_ZSTD_ENABLED
+				Register(MethodZstd, DKOBJECT_NEW ZstdCodec());
+#endif
+			}
+			bool Register(uint32_t method, Codec* codec)
+			{
+				DKCriticalSection<DKSpinLock> guard(lock);
+				for (size_t i = 0; i < codecs.Count(); ++i)
+				{
+					if (codecs.Value(i).method == method)
+						return false;
+				}
+				Entry e = {method, codec};
+				codecs.Add(e);
+				return true;
+			}
+			Codec* Find(uint32_t method) const
+			{
+				DKCriticalSection<DKSpinLock> guard(lock);
+				for (size_t i = 0; i < codecs.Count(); ++i)
+				{
+					if (codecs.Value(i).method == method)
+						return const_cast<Codec*>(codecs.Value(i).codec.Ptr());
+				}
+				return NULL;
+			}
+		private:
+			struct Entry
+			{
+				uint32_t method;
+				DKObject<Codec> codec;
+			};
+			DKArray<Entry> codecs;
+			DKSpinLock lock;
+		};
+		template <int N> struct RegistryHolder
+		{
+			static std::atomic<Registry*> instance;
+		};
+		// registry is never destroyed, can be used while other global
+		// objects being destroyed.
+		static Registry* GetRegistry(void)
+		{
+			Registry* reg = RegistryHolder<0>::instance.load(std::memory_order_acquire);
+			if (reg == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(Registry));
+				if (mem == NULL)
+					return NULL;
+				Registry* newReg = new(mem) Registry();
+				if (RegistryHolder<0>::instance.compare_exchange_strong(reg, newReg, std::memory_order_acq_rel))
+					reg = newReg;
+				else
+				{
+					newReg->~Registry();
+					DKMemoryHeapFree(newReg);
+				}
+			}
+			return reg;
+		}
+
+		DKCompressor(const DKCompressor&);
+		DKCompressor& operator = (const DKCompressor&);
+	};
+	template <int N> std::atomic<DKCompressor::Registry*> DKCompressor::RegistryHolder<N>::instance(NULL);
+}
@@ -0,0 +1,295 @@
+//
+//  File: DKDataChain.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <string.h>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKData.h"
+#include "DKDataSlice.h"
+#include "DKBuffer.h"
+#include "DKStream.h"
+#include "DKArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKDataChain
+// sequence of data segments, used as one logical data without copying.
+// (scatter/gather composition)
+//
+// segments are retained by chain, range of data can be added as DKDataSlice.
+// CopyTo gathers content of range into contiguous buffer,
+// CopyFrom scatters buffer into writable segments.
+// EnumerateSegments calls function with locked segment pointers, can be
+// used to write chain to stream or socket without intermediate buffer.
+//
+// Flatten returns one contiguous data, returns segment itself (no copy) if
+// range is in one segment.
+//
+// DKDataChainStream: read-only, seekable stream of chain.
+// (can be used with DKSerializer::Deserialize, etc.)
+//
+// Example:
+//  DKDataChain chain;
+//  chain.Append(header);
+//  chain.Append(mappedFile, 128, 4096);
+//  chain.EnumerateSegments([&](const void* p, size_t n) {stream->Write(p, n);});
+//  DKDataChainStream cs(chain);
+//  serializer->Deserialize(&cs, NULL);
+//
+// Note:
+//  length of segment should not be changed after appended.
+//  chain is not thread-safe, should not be modified while other threads
+//  reading. (segments are locked individually while accessing)
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKDataChain
+	{
+	public:
+		DKDataChain(void) : length(0)
+		{
+		}
+		DKDataChain(DKData* data) : length(0)
+		{
+			Append(data);
+		}
+		~DKDataChain(void)
+		{
+		}
+
+		// append whole data.
+		void Append(DKData* data)
+		{
+			size_t len = data ? data->Length() : 0;
+			if (len > 0)
+			{
+				Entry seg = {data, length, len};
+				segments.Add(seg);
+				length += len;
+			}
+		}
+		// append range of data, as DKDataSlice. (retains data)
+		// slice should be writable (not readonly) to be used with CopyFrom.
+		void Append(DKData* data, size_t offset, size_t len, bool readonly = true)
+		{
+			if (data)
+			{
+				if (offset == 0 && len >= data->Length())
+					Append(data);
+				else
+					Append(DKDataSlice::Create(data, offset, len, readonly).SafeCast<DKData>());
+			}
+		}
+		void Append(const DKDataChain& chain)
+		{
+			segments.Reserve(segments.Count() + chain.segments.Count());
+			for (size_t i = 0; i < chain.segments.Count(); ++i)
+				Append(const_cast<DKData*>(chain.segments.Value(i).data.Ptr()));
+		}
+		void Clear(void)
+		{
+			segments.Clear();
+			length = 0;
+		}
+
+		size_t Length(void) const					{return length;}
+		size_t NumberOfSegments(void) const			{return segments.Count();}
+		DKData* Segment(size_t index)				{return segments.Value(index).data;}
+		const DKData* Segment(size_t index) const	{return segments.Value(index).data;}
+
+		// chain of range, segments are sliced. (no copy)
+		DKDataChain SubChain(size_t offset, size_t len) const
+		{
+			DKDataChain chain;
+			EnumerateRange(offset, len, [&chain](DKData* data, size_t pos, size_t n) -> bool
+			{
+				chain.Append(data, pos, n);
+				return true;
+			});
+			return chain;
+		}
+		// contiguous data of range.
+		// returns segment or slice of segment if range is in one segment,
+		// otherwise content copied into DKBuffer.
+		DKObject<DKData> Flatten(size_t offset = 0, size_t len = (size_t)-1, DKAllocator& alloc = DKAllocator::DefaultAllocator()) const
+		{
+			if (offset >= length)
+				return NULL;
+			len = Min(len, length - offset);
+
+			size_t index = SegmentIndex(offset);
+			const Entry& seg = segments.Value(index);
+			if (offset + len <= seg.offset + seg.length)
+			{
+				if (offset == seg.offset && len == seg.length)
+					return seg.data;
+				return DKDataSlice::Create(const_cast<DKData*>(seg.data.Ptr()), offset - seg.offset, len).SafeCast<DKData>();
+			}
+			DKObject<DKBuffer> buffer = DKBuffer::Create(NULL, len, alloc);
+			if (buffer)
+			{
+				void* p = buffer->LockExclusive();
+				CopyTo(offset, p, len);
+				buffer->UnlockExclusive();
+			}
+			return buffer.SafeCast<DKData>();
+		}
+
+		// gather: copy range into buffer, returns bytes copied.
+		size_t CopyTo(size_t offset, void* buffer, size_t size) const
+		{
+			char* dst = reinterpret_cast<char*>(buffer);
+			size_t copied = 0;
+			EnumerateRange(offset, size, [&](DKData* data, size_t pos, size_t n) -> bool
+			{
+				const char* p = reinterpret_cast<const char*>(data->LockShared());
+				if (p)
+				{
+					memcpy(dst + copied, p + pos, n);
+					copied += n;
+				}
+				data->UnlockShared();
+				return p != NULL;
+			});
+			return copied;
+		}
+		// scatter: copy buffer into range, returns bytes copied.
+		// stops at read-only segment.
+		size_t CopyFrom(size_t offset, const void* buffer, size_t size)
+		{
+			const char* src = reinterpret_cast<const char*>(buffer);
+			size_t copied = 0;
+			EnumerateRange(offset, size, [&](DKData* data, size_t pos, size_t n) -> bool
+			{
+				if (!data->IsWritable())
+					return false;
+				char* p = reinterpret_cast<char*>(data->LockExclusive());
+				if (p)
+				{
+					memcpy(p + pos, src + copied, n);
+					copied += n;
+				}
+				data->UnlockExclusive();
+				return p != NULL;
+			});
+			return copied;
+		}
+		// call func(const void*, size_t) for each part of range, in order.
+		// each segment is locked (shared) while func is called.
+		template <typename Func> void EnumerateSegments(Func&& func, size_t offset = 0, size_t len = (size_t)-1) const
+		{
+			EnumerateRange(offset, len, [&func](DKData* data, size_t pos, size_t n) -> bool
+			{
+				const char* p = reinterpret_cast<const char*>(data->LockShared());
+				if (p)
+					func(static_cast<const void*>(p + pos), n);
+				data->UnlockShared();
+				return p != NULL;
+			});
+		}
+		bool WriteToStream(DKStream* stream) const
+		{
+			if (stream == NULL || !stream->IsWritable())
+				return false;
+			size_t written = 0;
+			EnumerateSegments([&](const void* p, size_t n)
+			{
+				written += stream->Write(p, n);
+			});
+			return written == length;
+		}
+
+	private:
+		struct Entry
+		{
+			DKObject<DKData> data;
+			size_t offset;		// offset in chain
+			size_t length;		// length when appended
+		};
+		// index of segment containing offset. (offset < length)
+		size_t SegmentIndex(size_t offset) const
+		{
+			size_t begin = 0;
+			size_t end = segments.Count();
+			while (end - begin > 1)
+			{
+				size_t mid = (begin + end) / 2;
+				if (segments.Value(mid).offset <= offset)
+					begin = mid;
+				else
+					end = mid;
+			}
+			return begin;
+		}
+		// call func(data, offsetInData, length) for each segment overlapping range.
+		// stops if func returns false.
+		template <typename Func> void EnumerateRange(size_t offset, size_t len, Func&& func) const
+		{
+			if (offset >= length)
+				return;
+			len = Min(len, length - offset);
+			for (size_t i = SegmentIndex(offset); len > 0 && i < segments.Count(); ++i)
+			{
+				const Entry& seg = segments.Value(i);
+				size_t pos = offset - seg.offset;
+				size_t n = Min(len, seg.length - pos);
+				if (!func(const_cast<DKData*>(seg.data.Ptr()), pos, n))
+					break;
+				offset += n;
+				len -= n;
+			}
+		}
+
+		DKArray<Entry> segments;
+		size_t length;
+	};
+
+	class DKDataChainStream : public DKStream
+	{
+	public:
+		DKDataChainStream(void) : offset(0)
+		{
+		}
+		DKDataChainStream(const DKDataChain& c) : chain(c), offset(0)
+		{
+		}
+		~DKDataChainStream(void)
+		{
+		}
+
+		Position SetPos(Position p)
+		{
+			offset = (size_t)Clamp<Position>(p, 0, (Position)chain.Length());
+			return offset;
+		}
+		Position GetPos(void) const			{return offset;}
+		Position RemainLength(void) const	{return chain.Length() - offset;}
+		Position TotalLength(void) const	{return chain.Length();}
+
+		size_t Read(void* p, size_t s)
+		{
+			size_t n = chain.CopyTo(offset, p, s);
+			offset += n;
+			return n;
+		}
+		size_t Write(const void*, size_t)		{return 0;}	// read-only
+
+		bool IsReadable(void) const		{return true;}
+		bool IsSeekable(void) const		{return true;}
+		bool IsWritable(void) const		{return false;}
+
+		const DKDataChain& Chain(void) const	{return chain;}
+
+	private:
+		DKDataChain chain;
+		size_t offset;
+
+		DKDataChainStream(const DKDataChainStream&);
+		DKDataChainStream& operator = (const DKDataChainStream&);
+	};
+}
@@ -0,0 +1,119 @@
+//
+//  File: DKDataSlice.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKData.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKDataSlice
+// window (offset, length) of parent data, without copying content.
+// parent data (mapped file, buffer or zip entry) is retained by slice.
+//
+// locking slice locks parent. read-only slice locks parent with shared lock,
+// writable slice locks parent with exclusive lock. (even for LockShared)
+// slice of slice references original parent directly.
+//
+// slice can be used for any functions taking DKData, such as DKDataStream,
+// DKTexture2D::Create, DKSerializer::Deserialize.
+//
+// Example:
+//  DKObject<DKData> file = DKFileMap::Open(path, 0, false);
+//  DKObject<DKDataSlice> header = DKDataSlice::Create(file, 0, 64);
+//  DKObject<DKDataSlice> body = DKDataSlice::Create(file, 64, file->Length() - 64);
+//  DKDataStream stream(body);
+//
+// Note:
+//  range exceeding parent is clipped, returns NULL if offset is out of range.
+//  slice keeps parent data alive, small slice of large data holds all.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKDataSlice : public DKData
+	{
+	public:
+		~DKDataSlice(void)
+		{
+		}
+
+		static DKObject<DKDataSlice> Create(DKData* parent, size_t offset, size_t length, bool readonly = true)
+		{
+			if (parent == NULL)
+				return NULL;
+
+			DKDataSlice* slice = dynamic_cast<DKDataSlice*>(parent);
+			if (slice)
+			{
+				if (offset > slice->length)
+					return NULL;
+				length = Min(length, slice->length - offset);
+				offset += slice->offset;
+				readonly = readonly || slice->readonly;
+				parent = slice->parent;
+			}
+			else
+			{
+				size_t parentLength = parent->Length();
+				if (offset > parentLength)
+					return NULL;
+				length = Min(length, parentLength - offset);
+			}
+			return DKOBJECT_NEW DKDataSlice(parent, offset, length, readonly);
+		}
+		// sub-slice, offset is relative to this slice.
+		DKObject<DKDataSlice> Slice(size_t offset, size_t length) const
+		{
+			return Create(const_cast<DKDataSlice*>(this), offset, length, readonly);
+		}
+
+		size_t Length(void) const			{return length;}
+		size_t Offset(void) const			{return offset;}
+		DKData* Parent(void)				{return parent;}
+		const DKData* Parent(void) const	{return parent;}
+
+		bool IsReadable(void) const			{return parent->IsReadable();}
+		bool IsWritable(void) const			{return !readonly && parent->IsWritable();}
+		bool IsExcutable(void) const		{return parent->IsExcutable();}
+
+	protected:
+		void* LockContent(void)
+		{
+			char* p = NULL;
+			if (readonly)
+				p = reinterpret_cast<char*>(const_cast<void*>(parent->LockShared()));
+			else
+				p = reinterpret_cast<char*>(parent->LockExclusive());
+			// UnlockContent will be called even if failed.
+			if (p)
+				return p + offset;
+			return NULL;
+		}
+		void UnlockContent(void)
+		{
+			if (readonly)
+				parent->UnlockShared();
+			else
+				parent->UnlockExclusive();
+		}
+
+	private:
+		DKDataSlice(DKData* p, size_t o, size_t len, bool r)
+			: parent(p), offset(o), length(len), readonly(r)
+		{
+		}
+
+		DKObject<DKData> parent;
+		const size_t offset;
+		const size_t length;
+		const bool readonly;
+
+		DKDataSlice(const DKDataSlice&);
+		DKDataSlice& operator = (const DKDataSlice&);
+	};
+}
@@ -72,6 +72,87 @@ namespace DKFoundation
 	DKLIB_API DKHashResult384 DKHashSHA384(const void* p, size_t len);		// SHA2 (SHA-384)
 	DKLIB_API DKHashResult512 DKHashSHA512(const void* p, size_t len);		// SHA2 (SHA-512)
 
+	// non-cryptographic fast hash (XXH64), for hash-table or checksum.
+	// result depends on byte-order of system.
+	inline uint64_t DKHashXX64(const void* p, size_t len, uint64_t seed = 0)
+	{
+		struct XX64
+		{
+			static uint64_t Rotl(uint64_t x, int r)		{return (x << r) | (x >> (64 - r));}
+			static uint64_t Read64(const unsigned char* p)	{uint64_t v; memcpy(&v, p, 8); return v;}
+			static uint32_t Read32(const unsigned char* p)	{uint32_t v; memcpy(&v, p, 4); return v;}
+			static uint64_t Round(uint64_t acc, uint64_t input)
+			{
+				acc += input * 14029467366897019727ULL;
+				return Rotl(acc, 31) * 11400714785074694791ULL;
+			}
+			static uint64_t Merge(uint64_t acc, uint64_t val)
+			{
+				acc ^= Round(0, val);
+				return acc * 11400714785074694791ULL + 9650029242287828579ULL;
+			}
+		};
+		const uint64_t prime1 = 11400714785074694791ULL;
+		const uint64_t prime2 = 14029467366897019727ULL;
+		const uint64_t prime3 = 1609587929392839161ULL;
+		const uint64_t prime4 = 9650029242287828579ULL;
+		const uint64_t prime5 = 2870177450012600261ULL;
+
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(p);
+		const unsigned char* end = data + len;
+		uint64_t h;
+		if (len >= 32)
+		{
+			uint64_t v1 = seed + prime1 + prime2;
+			uint64_t v2 = seed + prime2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - prime1;
+			const unsigned char* limit = end - 32;
+			do
+			{
+				v1 = XX64::Round(v1, XX64::Read64(data));
+				v2 = XX64::Round(v2, XX64::Read64(data + 8));
+				v3 = XX64::Round(v3, XX64::Read64(data + 16));
+				v4 = XX64::Round(v4, XX64::Read64(data + 24));
+				data += 32;
+			} while (data <= limit);
+
+			h = XX64::Rotl(v1, 1) + XX64::Rotl(v2, 7) + XX64::Rotl(v3, 12) + XX64::Rotl(v4, 18);
+			h = XX64::Merge(h, v1);
+			h = XX64::Merge(h, v2);
+			h = XX64::Merge(h, v3);
+			h = XX64::Merge(h, v4);
+		}
+		else
+		{
+			h = seed + prime5;
+		}
+		h += static_cast<uint64_t>(len);
+
+		for (; data + 8 <= end; data += 8)
+		{
+			h ^= XX64::Round(0, XX64::Read64(data));
+			h = XX64::Rotl(h, 27) * prime1 + prime4;
+		}
+		if (data + 4 <= end)
+		{
+			h ^= static_cast<uint64_t>(XX64::Read32(data)) * prime1;
+			h = XX64::Rotl(h, 23) * prime2 + prime3;
+			data += 4;
+		}
+		for (; data < end; ++data)
+		{
+			h ^= (*data) * prime5;
+			h = XX64::Rotl(h, 11) * prime1;
+		}
+		h ^= h >> 33;
+		h *= prime2;
+		h ^= h >> 29;
+		h *= prime3;
+		h ^= h >> 32;
+		return h;
+	}
+
 
 	class DKLIB_API DKHash
 	{
@@ -0,0 +1,227 @@
+//
+//  File: DKHashSet.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <initializer_list>
+#include "../DKInclude.h"
+#include "DKHashTable.h"
+#include "DKDummyLock.h"
+#include "DKCriticalSection.h"
+#include "DKTypeTraits.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKHashSet
+// a set container class. using DKHashTable (see DKHashTable.h) internally.
+// interface is same as DKSet, except enumeration order is not sorted.
+//
+// VALUE: value type
+// LOCK: thread-lock type
+// HASH: value hash function, values are compared by operator ==
+//
+// Contains(), Remove() accepts other types which HASH can accept and
+// comparable with VALUE.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	template <typename VALUE, typename LOCK = DKDummyLock, typename HASH = DKHashTableHash<VALUE>, typename ALLOC = DKMemoryDefaultAllocator>
+	class DKHashSet
+	{
+	public:
+		typedef VALUE													Value;
+		typedef LOCK													Lock;
+		typedef HASH													Hash;
+		typedef ALLOC													Allocator;
+		typedef DKCriticalSection<Lock>									CriticalSection;
+		typedef DKTypeTraits<Value>										ValueTraits;
+
+		struct KeyHash
+		{
+			template <typename K> uint64_t operator () (const K& k) const
+			{
+				return hash(k);
+			}
+			Hash hash;
+		};
+		struct KeyEquality
+		{
+			template <typename K> bool operator () (const Value& lhs, const K& k) const
+			{
+				return lhs == k;
+			}
+		};
+		typedef DKHashTable<Value, Value, Hash, KeyHash, KeyEquality, KeyEquality, DKTreeValueCopy<VALUE>, Allocator>	Container;
+
+		// lock is public. allow object being locked manually.
+		// ContainsNoLock(), CountNoLock() is available when object has been locked.
+		Lock	lock;
+
+		DKHashSet(void)
+		{
+		}
+		DKHashSet(DKHashSet&& s)
+			: container(static_cast<Container&&>(s.container))
+		{
+		}
+		DKHashSet(const DKHashSet& s)
+		{
+			CriticalSection guard(s.lock);
+			container = s.container;
+		}
+		DKHashSet(const Value* v, size_t n)
+		{
+			container.Reserve(n);
+			for (size_t i = 0; i < n; ++i)
+				container.Insert(v[i]);
+		}
+		DKHashSet(std::initializer_list<Value> il)
+		{
+			container.Reserve(il.size());
+			for (const Value& v : il)
+				container.Insert(v);
+		}
+		~DKHashSet(void)
+		{
+		}
+		void Insert(const Value& v)
+		{
+			CriticalSection guard(lock);
+			container.Insert(v);
+		}
+		void Insert(const Value* v, size_t n)
+		{
+			CriticalSection guard(lock);
+			container.Reserve(container.Count() + n);
+			for (size_t i = 0; i < n; ++i)
+				container.Insert(v[i]);
+		}
+		void Insert(std::initializer_list<Value> il)
+		{
+			CriticalSection guard(lock);
+			for (const Value& v : il)
+				container.Insert(v);
+		}
+		template <typename L, typename H, typename A> DKHashSet& Union(const DKHashSet<VALUE,L,H,A>& s)
+		{
+			CriticalSection guard(lock);
+			s.Enumerate([this](const VALUE& val) { container.Insert(val); });
+			return *this;
+		}
+		template <typename L, typename H, typename A> DKHashSet& Intersect(const DKHashSet<VALUE,L,H,A>& s)
+		{
+			CriticalSection guard(lock);
+			Container result;
+			container.Enumerate([&s, &result](const VALUE& val, bool*)
+			{
+				if (s.Contains(val))
+					result.Insert(val);
+			});
+			container = static_cast<Container&&>(result);
+			return *this;
+		}
+		template <typename K> void Remove(const K& v)
+		{
+			CriticalSection guard(lock);
+			container.Remove(v);
+		}
+		void Remove(std::initializer_list<Value> il)
+		{
+			CriticalSection guard(lock);
+			for (const Value& v : il)
+				container.Remove(v);
+		}
+		void Clear(void)
+		{
+			CriticalSection guard(lock);
+			container.Clear();
+		}
+		// allocate space for n items.
+		void Reserve(size_t n)
+		{
+			CriticalSection guard(lock);
+			container.Reserve(n);
+		}
+		template <typename K> bool Contains(const K& v) const
+		{
+			CriticalSection guard(lock);
+			return container.Find(v) != NULL;
+		}
+		template <typename K> bool ContainsNoLock(const K& v) const
+		{
+			return container.Find(v) != NULL;
+		}
+		bool IsEmpty(void) const
+		{
+			CriticalSection guard(lock);
+			return container.Count() == 0;
+		}
+		size_t Count(void) const
+		{
+			CriticalSection guard(lock);
+			return container.Count();
+		}
+		size_t CountNoLock(void) const
+		{
+			return container.Count();
+		}
+		DKHashSet& operator = (DKHashSet&& s)
+		{
+			if (this != &s)
+			{
+				CriticalSection guard(lock);
+				container = static_cast<Container&&>(s.container);
+			}
+			return *this;
+		}
+		DKHashSet& operator = (const DKHashSet& s)
+		{
+			if (this != &s)
+			{
+				CriticalSection guardOther(s.lock);
+				CriticalSection guardSelf(lock);
+
+				container = s.container;
+			}
+			return *this;
+		}
+		DKHashSet& operator = (std::initializer_list<Value> il)
+		{
+			CriticalSection guard(lock);
+			container.Clear();
+			for (const Value& v : il)
+				container.Insert(v);
+			return *this;
+		}
+		// lambda enumerator (const VALUE&) or (const VALUE&, bool*) are allowed.
+		// enumerating objects are READ-ONLY. values cannot be modified.
+		// enumeration order is not specified.
+		template <typename T> void Enumerate(T&& enumerator) const
+		{
+			using Func = typename DKFunctionType<T&&>::Signature;
+			enum {ValidatePType1 = Func::template CanInvokeWithParameterTypes<const VALUE&>::Result};
+			enum {ValidatePType2 = Func::template CanInvokeWithParameterTypes<const VALUE&, bool*>::Result};
+			static_assert(ValidatePType1 || ValidatePType2, "enumerator's parameter is not compatible with (const VALUE&) or (const VALUE&,bool*)");
+
+			Enumerate(std::forward<T>(enumerator), typename Func::ParameterNumber());
+		}
+	private:
+		// lambda enumerator (const VALUE&)
+		template <typename T> void Enumerate(T&& enumerator, DKNumber<1>) const
+		{
+			CriticalSection guard(lock);
+			container.Enumerate([&enumerator](const VALUE& val, bool*) {enumerator(val);});
+		}
+		// lambda enumerator (const VALUE&, bool*)
+		template <typename T> void Enumerate(T&& enumerator, DKNumber<2>) const
+		{
+			CriticalSection guard(lock);
+			container.Enumerate(enumerator);
+		}
+
+		Container container;
+	};
+}
@@ -0,0 +1,403 @@
+//
+//  File: DKHashTable.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <wchar.h>
+#include "../DKInclude.h"
+#include "DKTypeTraits.h"
+#include "DKFunction.h"
+#include "DKAVLTree.h"
+#include "DKString.h"
+#include "DKUUID.h"
+#include "DKHash.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKHashTable
+// open-addressing hash table template implementation. (Robin-Hood hashing)
+//
+// table is flat array of slots, each slot has hash value and pointer to
+// value node. lookup compares hash values in slots first, value node is
+// accessed only when hash is matched.
+// removal uses backward-shift, no tombstones.
+//
+// VALUE: value-type
+// KEY: key-type for searching
+// HASHV: value hash function or function object.
+// HASHK: key hash function or function object. (searching only)
+// EQV: value to value equality function or function object.
+// EQK: value to key equality function or function object. (searching only)
+// COPY: copy value function or function object.
+//   (used when Update() called, You can ignore this type if you don't call Update)
+//
+// HASHK, EQK can have overloaded operator for other key types, Find(),
+// Remove() can be called with those types. (heterogeneous lookup)
+// ex: DKHashTableHash<DKString> accepts 'const DKUniCharW*' also.
+//
+// Note:
+//  value's pointer will not be changed after rehashing.
+//  You can save pointer if you wish.
+//  enumeration order is not specified.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	// default hash function, uses binary representation of value.
+	// you need specialization for types which has pointer or padding.
+	template <typename VALUE> struct DKHashTableHash
+	{
+		uint64_t operator () (const VALUE& v) const
+		{
+			return DKHashXX64(&v, sizeof(VALUE));
+		}
+	};
+	template <> struct DKHashTableHash<DKString>
+	{
+		uint64_t operator () (const DKString& str) const
+		{
+			const DKUniCharW* s = str;
+			return DKHashXX64(s, s ? str.Length() * sizeof(DKUniCharW) : 0);
+		}
+		uint64_t operator () (const DKUniCharW* s) const
+		{
+			return DKHashXX64(s, s ? wcslen(s) * sizeof(DKUniCharW) : 0);
+		}
+	};
+	template <> struct DKHashTableHash<DKUUID>
+	{
+		uint64_t operator () (const DKUUID& uuid) const
+		{
+			return DKHashXX64(&uuid, sizeof(DKUUID));
+		}
+	};
+	template <typename VALUE, typename KEY> struct DKHashTableEquality
+	{
+		bool operator () (const VALUE& lhs, const KEY& rhs) const
+		{
+			return lhs == rhs;
+		}
+	};
+
+	template <
+		typename VALUE,										// value-type
+		typename KEY,										// key-type
+		typename HASHV = DKHashTableHash<VALUE>,			// value hash
+		typename HASHK = DKHashTableHash<KEY>,				// key hash
+		typename EQV = DKHashTableEquality<VALUE, VALUE>,	// value equality
+		typename EQK = DKHashTableEquality<VALUE, KEY>,		// value-key equality
+		typename COPY = DKTreeValueCopy<VALUE>,				// value copy
+		typename ALLOC = DKMemoryDefaultAllocator			// memory allocator
+	>
+	class DKHashTable
+	{
+	public:
+		typedef VALUE				Value;
+		typedef KEY					Key;
+		typedef HASHV				ValueHash;
+		typedef HASHK				KeyHash;
+		typedef EQV					ValueEquality;
+		typedef EQK					KeyEquality;
+		typedef COPY				ValueCopy;
+		typedef ALLOC				Allocator;
+
+		typedef DKTypeTraits<Value>		ValueTraits;
+
+		enum {MinimumCapacity = 16};
+
+		DKHashTable(void)
+			: slots(NULL), capacity(0), count(0)
+		{
+		}
+		DKHashTable(DKHashTable&& table)
+			: slots(table.slots), capacity(table.capacity), count(table.count)
+		{
+			table.slots = NULL;
+			table.capacity = 0;
+			table.count = 0;
+		}
+		DKHashTable(const DKHashTable& table)
+			: slots(NULL), capacity(0), count(0)
+		{
+			CopyFrom(table);
+		}
+		~DKHashTable(void)
+		{
+			Clear();
+			if (slots)
+				Allocator::Free(slots);
+		}
+		// Update: insertion if not exist or overwrite if exists.
+		const Value* Update(const Value& v)
+		{
+			bool created = false;
+			Value* p = SetValue(v, &created);
+			if (p && !created)
+				valueCopyFunc(*p, v);
+			return p;
+		}
+		// Insert: insert if not exist or fail if exists.
+		//  returns NULL if function failed. (already exists)
+		const Value* Insert(const Value& v)
+		{
+			bool created = false;
+			Value* p = SetValue(v, &created);
+			if (created)
+				return p;
+			return NULL;
+		}
+		template <typename K> bool Remove(const K& k)
+		{
+			size_t index;
+			if (!FindSlot(k, static_cast<size_t>(keyHashFunc(k)), keyEqualityFunc, &index))
+				return false;
+
+			DeleteValue(slots[index].value);
+			// backward shift, until empty slot or slot at home position.
+			size_t mask = capacity - 1;
+			size_t next = (index + 1) & mask;
+			while (slots[next].value && Distance(next) > 0)
+			{
+				slots[index] = slots[next];
+				index = next;
+				next = (next + 1) & mask;
+			}
+			slots[index].value = NULL;
+			count--;
+			return true;
+		}
+		void Clear(void)
+		{
+			for (size_t i = 0; i < capacity && count > 0; ++i)
+			{
+				if (slots[i].value)
+				{
+					DeleteValue(slots[i].value);
+					slots[i].value = NULL;
+					count--;
+				}
+			}
+			count = 0;
+		}
+		template <typename K> const Value* Find(const K& k) const
+		{
+			size_t index;
+			if (FindSlot(k, static_cast<size_t>(keyHashFunc(k)), keyEqualityFunc, &index))
+				return slots[index].value;
+			return NULL;
+		}
+		size_t Count(void) const
+		{
+			return count;
+		}
+		// number of slots allocated. (power of 2)
+		size_t Capacity(void) const
+		{
+			return capacity;
+		}
+		// allocate slots for n items, prevent rehashing while inserting.
+		void Reserve(size_t n)
+		{
+			size_t c = MinimumCapacity;
+			while (MaxLoad(c) < n)
+				c = c * 2;
+			if (c > capacity)
+				Rehash(c);
+		}
+		DKHashTable& operator = (DKHashTable&& table)
+		{
+			if (this != &table)
+			{
+				Clear();
+				if (slots)
+					Allocator::Free(slots);
+
+				slots = table.slots;
+				capacity = table.capacity;
+				count = table.count;
+				table.slots = NULL;
+				table.capacity = 0;
+				table.count = 0;
+			}
+			return *this;
+		}
+		DKHashTable& operator = (const DKHashTable& table)
+		{
+			if (this == &table)	return *this;
+
+			Clear();
+			CopyFrom(table);
+			return *this;
+		}
+		// lambda enumerator (VALUE&, bool*)
+		template <typename T> void Enumerate(T&& enumerator)
+		{
+			static_assert(DKFunctionType<T&&>::Signature::template CanInvokeWithParameterTypes<VALUE&, bool*>::Result,
+						  "enumerator's parameter is not compatible with (VALUE&, bool*)");
+
+			bool stop = false;
+			for (size_t i = 0; i < capacity && !stop; ++i)
+			{
+				if (slots[i].value)
+					enumerator(*slots[i].value, &stop);
+			}
+		}
+		// lambda enumerator (const VALUE&, bool*)
+		template <typename T> void Enumerate(T&& enumerator) const
+		{
+			static_assert(DKFunctionType<T&&>::Signature::template CanInvokeWithParameterTypes<const VALUE&, bool*>::Result,
+						  "enumerator's parameter is not compatible with (const VALUE&, bool*)");
+
+			bool stop = false;
+			for (size_t i = 0; i < capacity && !stop; ++i)
+			{
+				if (slots[i].value)
+					enumerator(static_cast<const VALUE&>(*slots[i].value), &stop);
+			}
+		}
+
+	private:
+		struct Slot
+		{
+			size_t hash;
+			Value* value;	// NULL for empty slot.
+		};
+
+		static size_t MaxLoad(size_t c)
+		{
+			return c - (c >> 3);	// 87.5%
+		}
+		// distance from home position.
+		size_t Distance(size_t index) const
+		{
+			return (index - (slots[index].hash & (capacity - 1))) & (capacity - 1);
+		}
+		template <typename K, typename EQ> bool FindSlot(const K& k, size_t hash, const EQ& equal, size_t* index) const
+		{
+			if (count == 0)
+				return false;
+
+			size_t mask = capacity - 1;
+			size_t i = hash & mask;
+			for (size_t dist = 0; slots[i].value; ++dist)
+			{
+				// key cannot be placed after richer slot.
+				if (Distance(i) < dist)
+					return false;
+				if (slots[i].hash == hash && equal(*slots[i].value, k))
+				{
+					*index = i;
+					return true;
+				}
+				i = (i + 1) & mask;
+			}
+			return false;
+		}
+		Value* SetValue(const Value& v, bool* created)
+		{
+			size_t hash = static_cast<size_t>(valueHashFunc(v));
+			size_t index;
+			if (FindSlot(v, hash, valueEqualityFunc, &index))
+			{
+				*created = false;
+				return slots[index].value;
+			}
+			if (count + 1 > MaxLoad(capacity))
+			{
+				if (!Rehash(capacity > 0 ? capacity * 2 : MinimumCapacity))
+					return NULL;
+			}
+			void* p = Allocator::Alloc(sizeof(Value));
+			if (p == NULL)
+				return NULL;
+			Value* value = new(p) Value(v);
+			Slot slot = {hash, value};
+			InsertSlot(slot);
+			count++;
+			*created = true;
+			return value;
+		}
+		// insert slot into table, swap with richer slot. (Robin-Hood)
+		void InsertSlot(Slot slot)
+		{
+			size_t mask = capacity - 1;
+			size_t i = slot.hash & mask;
+			for (size_t dist = 0; slots[i].value; ++dist)
+			{
+				size_t d = Distance(i);
+				if (d < dist)
+				{
+					Slot tmp = slots[i];
+					slots[i] = slot;
+					slot = tmp;
+					dist = d;
+				}
+				i = (i + 1) & mask;
+			}
+			slots[i] = slot;
+		}
+		bool Rehash(size_t c)
+		{
+			DKASSERT_DEBUG((c & (c - 1)) == 0);
+			DKASSERT_DEBUG(MaxLoad(c) >= count);
+
+			Slot* newSlots = static_cast<Slot*>(Allocator::Alloc(sizeof(Slot) * c));
+			if (newSlots == NULL)
+				return false;
+			memset(newSlots, 0, sizeof(Slot) * c);
+
+			Slot* oldSlots = slots;
+			size_t oldCapacity = capacity;
+			slots = newSlots;
+			capacity = c;
+			for (size_t i = 0; i < oldCapacity; ++i)
+			{
+				if (oldSlots[i].value)
+					InsertSlot(oldSlots[i]);
+			}
+			if (oldSlots)
+				Allocator::Free(oldSlots);
+			return true;
+		}
+		void CopyFrom(const DKHashTable& table)
+		{
+			if (table.count == 0)
+				return;
+			if (capacity < table.capacity)
+			{
+				if (!Rehash(table.capacity))
+					return;
+			}
+			for (size_t i = 0; i < table.capacity; ++i)
+			{
+				if (table.slots[i].value)
+				{
+					void* p = Allocator::Alloc(sizeof(Value));
+					if (p == NULL)
+						return;
+					Slot slot = {table.slots[i].hash, new(p) Value(*table.slots[i].value)};
+					InsertSlot(slot);
+					count++;
+				}
+			}
+		}
+		static void DeleteValue(Value* v)
+		{
+			v->~Value();
+			Allocator::Free(v);
+		}
+
+		Slot*		slots;
+		size_t		capacity;
+		size_t		count;
+
+		ValueHash	valueHashFunc;
+		KeyHash		keyHashFunc;
+		ValueEquality	valueEqualityFunc;
+		KeyEquality	keyEqualityFunc;
+		ValueCopy	valueCopyFunc;
+	};
+}
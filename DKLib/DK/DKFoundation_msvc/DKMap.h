@@ -138,8 +138,7 @@ namespace DKFoundation
 		}
 		DKMap(std::initializer_list<Pair> il)
 		{
-			for (const Pair& p : il)
-				container.Insert(p);
+			container.Insert(il.begin(), il.size());
 		}
 		~DKMap(void)
 		{
@@ -157,8 +156,8 @@ namespace DKFoundation
 		}
 		void Update(const Pair* p, size_t size)
 		{
-			for (size_t i = 0; i < size; i++)
-				Update(p[i]);
+			CriticalSection guard(lock);
+			container.Update(p, size);
 		}
 		template <typename LK, typename T1, typename T2, typename T3>
 		void Update(const DKMap<KEY, VALUE, LK, T1, T2, T3>& m)
@@ -169,11 +168,20 @@ namespace DKFoundation
 				container.Update(pair);
 			});			
 		}
+		// same map type, merge trees directly.
+		void Update(const DKMap& m)
+		{
+			if (static_cast<const void*>(&m) != this)
+			{
+				// lock in order of address, other thread may merge in reverse.
+				DKOrderedCriticalSection<Lock, Lock> guard(lock, m.lock);
+				container.Union(m.container, true);
+			}
+		}
 		void Update(std::initializer_list<Pair> il)
 		{
 			CriticalSection guard(lock);
-			for (const Pair& p : il)
-				container.Update(p);
+			container.Update(il.begin(), il.size());
 		}
 		// Insert: insert item if key is not exist, fails otherwise.
 		bool Insert(const Pair& p)
@@ -187,11 +195,8 @@ namespace DKFoundation
 		}
 		size_t Insert(const Pair* p, size_t size)
 		{
-			size_t ret = 0;
-			for (size_t i = 0; i < size; i++)
-				if (Insert(p[i]))
-					ret++;
-			return ret;
+			CriticalSection guard(lock);
+			return container.Insert(p, size);
 		}
 		template <typename LK, typename T1, typename T2, typename T3>
 		size_t Insert(const DKMap<KEY, VALUE, LK, T1, T2, T3>& m)
@@ -205,16 +210,19 @@ namespace DKFoundation
 			});
 			return n;
 		}
+		// same map type, merge trees directly.
+		size_t Insert(const DKMap& m)
+		{
+			if (static_cast<const void*>(&m) == this)
+				return 0;
+			// lock in order of address, other thread may merge in reverse.
+			DKOrderedCriticalSection<Lock, Lock> guard(lock, m.lock);
+			return container.Union(m.container);
+		}
 		size_t Insert(std::initializer_list<Pair> il)
 		{
-			size_t n = 0;
 			CriticalSection guard(lock);
-			for (const Pair& p : il)
-			{
-				if (container.Insert(p) != NULL)
-					n++;
-			}
-			return n;
+			return container.Insert(il.begin(), il.size());
 		}
 		void Remove(const KEY& k)
 		{
@@ -287,8 +295,8 @@ namespace DKFoundation
 		{
 			if (this != &m)
 			{
-				CriticalSection guardOther(m.lock);
-				CriticalSection guardSelf(lock);
+				// lock in order of address, other thread may assign in reverse.
+				DKOrderedCriticalSection<Lock, Lock> guard(lock, m.lock);
 
 				container = m.container;
 			}
@@ -298,8 +306,7 @@ namespace DKFoundation
 		{
 			CriticalSection guard(lock);
 			container.Clear();
-			for (const Pair& p : il)
-				container.Insert(p);
+			container.Insert(il.begin(), il.size());
 			return *this;
 		}
 		// lambda enumerator (VALUE&) 또는 (VALUE&, bool*) 형식의 함수객체
@@ -388,5 +395,7 @@ namespace DKFoundation
 		}
 		
 		Container	container;
+
+		template <typename K, typename V, typename L, typename C, typename CP, typename A> friend class DKMap;
 	};
 }
@@ -0,0 +1,441 @@
+//
+//  File: DKMemoryHugePage.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKAllocator.h"
+#include "DKSpinLock.h"
+#include "DKCriticalSection.h"
+#include "DKMap.h"
+
+#ifdef _WIN32
+namespace DKFoundation { namespace Private {
+#ifdef _WIN64
+	typedef unsigned __int64 Win32SizeT;
+#else
+	typedef unsigned long Win32SizeT;
+#endif
+}}
+// virtual memory functions (kernel32), declared here to avoid <windows.h>
+extern "C"
+{
+	__declspec(dllimport) void* __stdcall VirtualAlloc(void*, DKFoundation::Private::Win32SizeT, unsigned long, unsigned long);
+	__declspec(dllimport) void* __stdcall VirtualAllocExNuma(void*, void*, DKFoundation::Private::Win32SizeT, unsigned long, unsigned long, unsigned long);
+	__declspec(dllimport) int __stdcall VirtualFree(void*, DKFoundation::Private::Win32SizeT, unsigned long);
+	__declspec(dllimport) void* __stdcall GetCurrentProcess(void);
+	__declspec(dllimport) DKFoundation::Private::Win32SizeT __stdcall GetLargePageMinimum(void);
+	__declspec(dllimport) unsigned long __stdcall GetCurrentProcessorNumber(void);
+	__declspec(dllimport) int __stdcall GetNumaProcessorNode(unsigned char, unsigned char*);
+}
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef DKLIB_LINUX
+#include <sys/syscall.h>
+#endif
+#ifdef DKLIB_APPLE_MACH
+#include <mach/vm_statistics.h>
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// DKMemoryHugePage
+// virtual memory allocation with huge-page (2MB) and NUMA node hints.
+// useful for large arrays (voxel blocks, staging buffers), reduces TLB misses.
+//
+// DKMemoryHugePage-Alloc/Realloc/Free functions allocate page-aligned memory
+// directly from system, with options.
+//  DKMemoryPageOptionHugePage: use huge pages (DKMemoryHugePageSize)
+//   Linux: MAP_HUGETLB (reserved huge pages), otherwise transparent huge
+//          pages with madvise(MADV_HUGEPAGE).
+//   Win32: MEM_LARGE_PAGES, requires SeLockMemoryPrivilege.
+//   OSX: VM_FLAGS_SUPERPAGE_SIZE_2MB (x86-64)
+//   falls back to normal pages if huge page is not available.
+//  DKMemoryPageOptionLocalNode: prefer NUMA node of calling thread.
+//   Linux: mbind(MPOL_PREFERRED), Win32: VirtualAllocExNuma.
+//   ignored on other platforms.
+//
+// DKMemoryPageAdvise applies options to existing pages (DKMemoryPageReserve,
+// DKMemoryVirtualAlloc, DKMemoryReservedAlloc), should be called before pages
+// are accessed. (Linux only, returns false if not supported)
+//
+// DKMemoryHPAllocator is allocator type for template classes.
+// DKMemoryHugePageAllocator is DKAllocator for DKObject::Alloc().
+//
+// Note:
+//  size of allocation is rounded up to page size. (or huge page size)
+//  small allocations should not use these functions.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	enum DKMemoryPageOption
+	{
+		DKMemoryPageOptionNone = 0,
+		DKMemoryPageOptionHugePage = 1 << 0,
+		DKMemoryPageOptionLocalNode = 1 << 1,
+		DKMemoryPageOptionDefault = DKMemoryPageOptionHugePage | DKMemoryPageOptionLocalNode,
+	};
+
+	namespace Private
+	{
+		class MemoryHugePage
+		{
+		public:
+			enum {DefaultHugePageSize = 0x200000};	// 2MB
+
+			static size_t HugePageSize(void)
+			{
+#ifdef _WIN32
+				size_t s = (size_t)::GetLargePageMinimum();
+				return s > 0 ? s : DefaultHugePageSize;
+#else
+				return DefaultHugePageSize;
+#endif
+			}
+			// NUMA node of calling thread, -1 if unknown.
+			static int CurrentNode(void)
+			{
+#if defined(_WIN32)
+				unsigned char node = 0;
+				if (::GetNumaProcessorNode((unsigned char)::GetCurrentProcessorNumber(), &node) && node != 0xff)
+					return node;
+#elif defined(DKLIB_LINUX) && defined(SYS_getcpu)
+				unsigned int cpu = 0, node = 0;
+				if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+					return (int)node;
+#endif
+				return -1;
+			}
+			static bool Advise(void* p, size_t s, int options)
+			{
+				bool result = false;
+#ifdef DKLIB_LINUX
+				if (p && s > 0)
+				{
+					result = true;
+					if (options & DKMemoryPageOptionHugePage)
+					{
+#ifdef MADV_HUGEPAGE
+						result = ::madvise(p, s, MADV_HUGEPAGE) == 0 && result;
+#else
+						result = false;
+#endif
+					}
+					if (options & DKMemoryPageOptionLocalNode)
+						result = BindToNode(p, s, CurrentNode()) && result;
+				}
+#endif
+				return result;
+			}
+
+			static void* Alloc(size_t s, int options)
+			{
+				if (s == 0)
+					return NULL;
+				Registry* reg = Registry::Instance();
+				if (reg == NULL)
+					return NULL;
+
+				Block block = {NULL, 0, s, options};
+				if (options & DKMemoryPageOptionHugePage)
+					block.base = MapHugePages(s, block.length, options);
+				if (block.base == NULL)
+				{
+					block.length = RoundUp(s, PageSize());
+					block.base = MapPages(block.length, options);
+				}
+				if (block.base)
+				{
+					DKCriticalSection<DKSpinLock> guard(reg->lock);
+					reg->blocks.Insert(block.base, block);
+				}
+				return block.base;
+			}
+			static void* Realloc(void* p, size_t s, int options)
+			{
+				if (p == NULL)
+					return Alloc(s, options);
+				if (s == 0)
+				{
+					Free(p);
+					return NULL;
+				}
+				Registry* reg = Registry::Instance();
+				if (reg == NULL)
+					return NULL;
+				Block block;
+				{
+					DKCriticalSection<DKSpinLock> guard(reg->lock);
+					BlockMap::Pair* pair = reg->blocks.Find(p);
+					if (pair == NULL)
+						return NULL;
+					if (s <= pair->value.length && pair->value.options == options)
+					{
+						pair->value.size = s;
+						return p;
+					}
+					block = pair->value;
+				}
+				void* p2 = Alloc(s, options);
+				if (p2)
+				{
+					memcpy(p2, p, Min(s, block.size));
+					Free(p);
+				}
+				return p2;
+			}
+			static void Free(void* p)
+			{
+				if (p == NULL)
+					return;
+				Registry* reg = Registry::Instance();
+				if (reg == NULL)
+					return;
+				Block block;
+				{
+					DKCriticalSection<DKSpinLock> guard(reg->lock);
+					BlockMap::Pair* pair = reg->blocks.Find(p);
+					if (pair == NULL)
+						return;
+					block = pair->value;
+					reg->blocks.Remove(p);
+				}
+#ifdef _WIN32
+				::VirtualFree(block.base, 0, MemRelease);
+#else
+				::munmap(block.base, block.length);
+#endif
+			}
+
+		private:
+			struct Block
+			{
+				void* base;
+				size_t length;		// mapped bytes
+				size_t size;		// requested bytes
+				int options;
+			};
+			typedef DKMap<void*, Block> BlockMap;
+			// map of allocated blocks, created on first use and never
+			// destroyed. (blocks can be freed by global objects)
+			struct Registry
+			{
+				BlockMap blocks;
+				DKSpinLock lock;
+
+				static Registry* Instance(void)
+				{
+					Registry* reg = RegistryHolder<0>::instance.load(std::memory_order_acquire);
+					if (reg == NULL)
+					{
+						void* mem = DKMemoryHeapAlloc(sizeof(Registry));
+						if (mem == NULL)
+							return NULL;
+						Registry* newReg = new(mem) Registry();
+						if (RegistryHolder<0>::instance.compare_exchange_strong(reg, newReg, std::memory_order_acq_rel))
+							reg = newReg;
+						else
+						{
+							newReg->~Registry();
+							DKMemoryHeapFree(newReg);
+						}
+					}
+					return reg;
+				}
+			};
+			template <int N> struct RegistryHolder
+			{
+				static std::atomic<Registry*> instance;
+			};
+#ifdef _WIN32
+			enum : unsigned long
+			{
+				MemCommit = 0x1000,
+				MemReserve = 0x2000,
+				MemRelease = 0x8000,
+				MemLargePages = 0x20000000,
+				PageReadWrite = 0x04,
+			};
+#endif
+
+			static size_t RoundUp(size_t s, size_t unit)
+			{
+				return (s + unit - 1) / unit * unit;
+			}
+			static size_t PageSize(void)
+			{
+				return DKMemoryPageSize();
+			}
+			static bool BindToNode(void* p, size_t s, int node)
+			{
+#if defined(DKLIB_LINUX) && defined(SYS_mbind)
+				if (node >= 0 && node < 1024)
+				{
+					const int mpolPreferred = 1;		// MPOL_PREFERRED
+					unsigned long mask[1024 / (sizeof(unsigned long) * 8)] = {0};
+					mask[node / (sizeof(unsigned long) * 8)] = 1UL << (node % (sizeof(unsigned long) * 8));
+					return syscall(SYS_mbind, p, s, mpolPreferred, mask, sizeof(mask) * 8 + 1, 0) == 0;
+				}
+#endif
+				return false;
+			}
+			// allocate normal pages.
+			static void* MapPages(size_t length, int options)
+			{
+#ifdef _WIN32
+				if (options & DKMemoryPageOptionLocalNode)
+				{
+					int node = CurrentNode();
+					if (node >= 0)
+					{
+						void* p = ::VirtualAllocExNuma(::GetCurrentProcess(), NULL, length, MemReserve | MemCommit, PageReadWrite, (unsigned long)node);
+						if (p)
+							return p;
+					}
+				}
+				return ::VirtualAlloc(NULL, length, MemReserve | MemCommit, PageReadWrite);
+#else
+				void* p = ::mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+				if (p == MAP_FAILED)
+					return NULL;
+				if (options & DKMemoryPageOptionLocalNode)
+					BindToNode(p, length, CurrentNode());
+				return p;
+#endif
+			}
+			// allocate huge pages, NULL if not available.
+			static void* MapHugePages(size_t s, size_t& length, int options)
+			{
+				size_t hugePageSize = HugePageSize();
+				length = RoundUp(s, hugePageSize);
+#if defined(_WIN32)
+				// large pages can not be allocated with NUMA node hint.
+				(void)options;
+				return ::VirtualAlloc(NULL, length, MemReserve | MemCommit | MemLargePages, PageReadWrite);
+#elif defined(DKLIB_LINUX)
+				void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+				// reserved huge pages. (vm.nr_hugepages)
+				p = ::mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+#endif
+#ifdef MADV_HUGEPAGE
+				if (p == MAP_FAILED)
+				{
+					// transparent huge pages, map aligned region.
+					size_t mapped = length + hugePageSize;
+					char* m = reinterpret_cast<char*>(::mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0));
+					if (m != MAP_FAILED)
+					{
+						char* aligned = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(m), hugePageSize));
+						if (aligned > m)
+							::munmap(m, aligned - m);
+						if (aligned + length < m + mapped)
+							::munmap(aligned + length, (m + mapped) - (aligned + length));
+						::madvise(aligned, length, MADV_HUGEPAGE);
+						p = aligned;
+					}
+				}
+#endif
+				if (p != MAP_FAILED)
+				{
+					// NUMA policy should be applied before pages are touched.
+					if (options & DKMemoryPageOptionLocalNode)
+						BindToNode(p, length, CurrentNode());
+					return p;
+				}
+				return NULL;
+#elif defined(DKLIB_APPLE_OSX) && defined(VM_FLAGS_SUPERPAGE_SIZE_2MB)
+				(void)options;
+				void* p = ::mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, VM_FLAGS_SUPERPAGE_SIZE_2MB, 0);
+				return p != MAP_FAILED ? p : NULL;
+#else
+				(void)options;
+				return NULL;
+#endif
+			}
+		};
+		template <int N> std::atomic<MemoryHugePage::Registry*> MemoryHugePage::RegistryHolder<N>::instance(NULL);
+	}
+
+	// huge page memory
+	inline void* DKMemoryHugePageAlloc(size_t s, int options = DKMemoryPageOptionDefault)
+	{
+		return Private::MemoryHugePage::Alloc(s, options);
+	}
+	inline void* DKMemoryHugePageRealloc(void* p, size_t s, int options = DKMemoryPageOptionDefault)
+	{
+		return Private::MemoryHugePage::Realloc(p, s, options);
+	}
+	inline void DKMemoryHugePageFree(void* p)
+	{
+		Private::MemoryHugePage::Free(p);
+	}
+	inline size_t DKMemoryHugePageSize(void)
+	{
+		return Private::MemoryHugePage::HugePageSize();
+	}
+	// apply options to pages already allocated. (Linux only)
+	inline bool DKMemoryPageAdvise(void* p, size_t s, int options)
+	{
+		return Private::MemoryHugePage::Advise(p, s, options);
+	}
+	// NUMA node of calling thread, -1 if unknown.
+	inline int DKMemoryNumaNode(void)
+	{
+		return Private::MemoryHugePage::CurrentNode();
+	}
+
+	// allocator type for template classes.
+	struct DKMemoryHPAllocator
+	{
+		enum {location = DKMemoryLocationVirtual};
+		static void* Alloc(size_t s)			{return DKMemoryHugePageAlloc(s);}
+		static void* Realloc(void* p, size_t s)	{return DKMemoryHugePageRealloc(p, s);}
+		static void Free(void* p)				{DKMemoryHugePageFree(p);}
+	};
+
+	// DKAllocator for huge page memory.
+	class DKMemoryHugePageAllocator : public DKAllocator
+	{
+	public:
+		void* Alloc(size_t s)					{return DKMemoryHugePageAlloc(s);}
+		void Dealloc(void* p)					{DKMemoryHugePageFree(p);}
+		DKMemoryLocation Location(void) const	{return DKMemoryLocationVirtual;}
+
+		// shared instance, never destroyed.
+		static DKAllocator& Instance(void)
+		{
+			DKMemoryHugePageAllocator* alloc = InstanceHolder<0>::instance.load(std::memory_order_acquire);
+			if (alloc == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(DKMemoryHugePageAllocator));
+				if (mem == NULL)
+					DKERROR_THROW("Out of memory");
+				DKMemoryHugePageAllocator* newAlloc = new(mem) DKMemoryHugePageAllocator();
+				if (InstanceHolder<0>::instance.compare_exchange_strong(alloc, newAlloc, std::memory_order_acq_rel))
+					alloc = newAlloc;
+				else
+				{
+					newAlloc->~DKMemoryHugePageAllocator();
+					DKMemoryHeapFree(newAlloc);
+				}
+			}
+			return *alloc;
+		}
+
+	private:
+		template <int N> struct InstanceHolder
+		{
+			static std::atomic<DKMemoryHugePageAllocator*> instance;
+		};
+	};
+	template <int N> std::atomic<DKMemoryHugePageAllocator*> DKMemoryHugePageAllocator::InstanceHolder<N>::instance(NULL);
+}
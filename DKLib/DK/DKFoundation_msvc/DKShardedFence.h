@@ -0,0 +1,205 @@
+//
+//  File: DKShardedFence.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include "../DKInclude.h"
+#include "DKMemory.h"
+#include "DKThread.h"
+#include "DKAdaptiveLock.h"
+#include "DKSmallArray.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKShardedFence
+// a locking object with key, like DKFence.
+// can not be used with DKCriticalSection together.
+//
+// keys are distributed to shards by hash of address, each shard has own
+// lock and key table. fences with different keys never touch same shard
+// unless keys are hashed to same shard, and even then they do not block
+// each other. (shard lock is held only while updating key table)
+//
+// fence can be exclusive (ModeExclusive, default) or shared (ModeShared).
+// shared fences with same key can be acquired by threads concurrently,
+// exclusive fence blocks other threads using same key.
+// (mode is not a bool, DKFence's second parameter has different meaning)
+// fences are recursive, a thread can acquire fence of key which is already
+// acquired by itself. (but shared fence cannot be upgraded to exclusive)
+//
+// Usage:
+//  {
+//       DKShardedFence fence(this);  // locking with key(this)
+//       .. mutually exclusive below scope ..
+//
+//  } // unlock automatically while fence object being destructed.
+//
+//  {
+//       DKShardedFence fence(this, DKShardedFence::ModeShared);  // shared locking with key(this)
+//       .. read-only below scope ..
+//  }
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKShardedFence
+	{
+	public:
+		enum Mode
+		{
+			ModeExclusive = 0,
+			ModeShared,
+		};
+		// anything can be a key, but should be unique.
+		DKShardedFence(const void* k, Mode mode = ModeExclusive) : key(k), shared(mode == ModeShared)
+		{
+			Shard& shard = ShardForKey(key);
+			DKThread::ThreadId tid = DKThread::CurrentThreadId();
+
+			shard.cond.Lock();
+			for (;;)
+			{
+				Entry* entry = shard.Find(key);
+				if (entry == NULL)
+				{
+					Entry e = {key, tid, 0, 0, 0};
+					entry = &shard.entries.Value(shard.entries.Add(e));
+				}
+				bool owned = entry->exclusive > 0 && entry->owner == tid;
+				if (shared)
+				{
+					if (entry->exclusive == 0 || owned)
+					{
+						entry->shared++;
+						break;
+					}
+				}
+				else
+				{
+					if (owned || (entry->exclusive == 0 && entry->shared == 0))
+					{
+						entry->owner = tid;
+						entry->exclusive++;
+						break;
+					}
+				}
+				entry->waiters++;
+				shard.cond.Wait();
+				shard.Find(key)->waiters--;
+			}
+			shard.cond.Unlock();
+		}
+		~DKShardedFence(void)
+		{
+			Shard& shard = ShardForKey(key);
+
+			shard.cond.Lock();
+			Entry* entry = shard.Find(key);
+			DKASSERT_DEBUG(entry != NULL);
+			bool released;
+			if (shared)
+			{
+				DKASSERT_DEBUG(entry->shared > 0);
+				released = --entry->shared == 0 && entry->exclusive == 0;
+			}
+			else
+			{
+				DKASSERT_DEBUG(entry->exclusive > 0 && entry->owner == DKThread::CurrentThreadId());
+				released = --entry->exclusive == 0 && entry->shared == 0;
+			}
+			if (released)
+			{
+				if (entry->waiters > 0)
+					shard.cond.Broadcast();
+				else
+					shard.Remove(entry);
+			}
+			shard.cond.Unlock();
+		}
+
+	private:
+		enum {NumShards = 64, CacheLineSize = 64};
+
+		struct Entry
+		{
+			const void* key;
+			DKThread::ThreadId owner;	// thread has exclusive fence
+			size_t exclusive;			// recursion count of owner
+			size_t shared;
+			size_t waiters;
+		};
+		// each shard takes its own cache lines, to avoid false sharing.
+		struct __declspec(align(64)) Shard
+		{
+			DKAdaptiveCondition cond;
+			DKSmallArray<Entry, 4> entries;
+
+			Entry* Find(const void* key)
+			{
+				for (Entry& e : entries)
+				{
+					if (e.key == key)
+						return &e;
+				}
+				return NULL;
+			}
+			void Remove(Entry* e)
+			{
+				size_t index = e - &entries.Value(0);
+				size_t last = entries.Count() - 1;
+				if (index != last)
+					entries.Value(index) = entries.Value(last);
+				entries.Remove(last);
+			}
+		};
+		static_assert(sizeof(Shard) % CacheLineSize == 0, "Shard should be aligned to cache line");
+		struct ShardTable
+		{
+			Shard shards[NumShards];
+		};
+		// table is created on first use and never destroyed, fences can be
+		// used while other global objects being constructed or destroyed.
+		template <int N> struct ShardTableHolder
+		{
+			static std::atomic<ShardTable*> table;
+		};
+		static ShardTable* Table(void)
+		{
+			ShardTable* table = ShardTableHolder<0>::table.load(std::memory_order_acquire);
+			if (table == NULL)
+			{
+				// heap memory is not aligned to cache line, align manually.
+				void* mem = DKMemoryHeapAlloc(sizeof(ShardTable) + CacheLineSize);
+				if (mem == NULL)
+					DKERROR_THROW("Out of memory");
+				uintptr_t addr = (reinterpret_cast<uintptr_t>(mem) + CacheLineSize - 1) & ~static_cast<uintptr_t>(CacheLineSize - 1);
+				ShardTable* newTable = new(reinterpret_cast<void*>(addr)) ShardTable();
+				if (ShardTableHolder<0>::table.compare_exchange_strong(table, newTable, std::memory_order_acq_rel))
+					table = newTable;
+				else
+				{
+					newTable->~ShardTable();
+					DKMemoryHeapFree(mem);
+				}
+			}
+			return table;
+		}
+		static Shard& ShardForKey(const void* key)
+		{
+			uintptr_t h = reinterpret_cast<uintptr_t>(key);
+			h = (h >> 4) * 0x9E3779B1U;
+			return Table()->shards[(h >> 8) % NumShards];
+		}
+
+		const void* key;
+		const bool shared;
+
+		DKShardedFence(const DKShardedFence&);
+		DKShardedFence& operator = (const DKShardedFence&);
+	};
+	template <int N> std::atomic<DKShardedFence::ShardTable*> DKShardedFence::ShardTableHolder<N>::table(NULL);
+}
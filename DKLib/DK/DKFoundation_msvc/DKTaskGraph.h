@@ -0,0 +1,250 @@
+//
+//  File: DKTaskGraph.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include <atomic>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKOperation.h"
+#include "DKCondition.h"
+#include "DKArray.h"
+#include "DKMemory.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKTaskGraph
+// a dependency graph of operations (DAG), executed by operation queue.
+//
+// each node has an operation and nodes which should be done before it.
+// when graph submitted, nodes without dependency are posted to queue,
+// other nodes are posted when all predecessors are done.
+// one of successors which became ready is performed on same thread
+// without posting. (continuation)
+//
+// graph can be submitted repeatedly. (ex: once per frame)
+// graph cannot be modified while running.
+//
+// QUEUE can be any type which has Post(DKOperation*).
+// (DKOperationQueue, DKWorkStealingQueue)
+//
+// Example:
+//  DKTaskGraph graph;
+//  auto anim = graph.Add(animOp);
+//  auto kinematic = graph.Add(kinematicOp);
+//  auto physics = graph.Add(physicsOp);
+//  graph.AddDependency(kinematic, anim);	// kinematic after anim
+//  graph.AddDependency(physics, kinematic);
+//  ...
+//  graph.Run(queue);	// submit and wait.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKTaskGraph
+	{
+	public:
+		typedef size_t Node;
+		static const Node invalidNode = (size_t)-1;
+
+		DKTaskGraph(void)
+			: remaining(0), finished(true), queue(NULL), postFunc(NULL)
+		{
+		}
+		~DKTaskGraph(void)
+		{
+			Wait();
+			Clear();
+		}
+		// add node, returns node handle.
+		Node Add(DKOperation* operation)
+		{
+			DKASSERT_DEBUG(!IsRunning());
+			void* mem = DKMemoryHeapAlloc(sizeof(NodeData));
+			if (mem == NULL)
+				DKERROR_THROW("Out of memory");
+			NodeData* node = new(mem) NodeData();
+			node->operation = operation;
+			node->runner = DKOBJECT_NEW NodeOperation(this, nodes.Count());
+			node->numDependencies = 0;
+			node->pending = 0;
+			return nodes.Add(node);
+		}
+		// node will be performed after 'dependency' has been done.
+		void AddDependency(Node node, Node dependency)
+		{
+			DKASSERT_DEBUG(!IsRunning());
+			DKASSERT_DEBUG(node < nodes.Count() && dependency < nodes.Count());
+			DKASSERT_DEBUG(node != dependency);
+
+			nodes.Value(dependency)->successors.Add(node);
+			nodes.Value(node)->numDependencies++;
+		}
+		// remove all nodes.
+		void Clear(void)
+		{
+			DKASSERT_DEBUG(!IsRunning());
+			for (NodeData* node : nodes)
+			{
+				node->~NodeData();
+				DKMemoryHeapFree(node);
+			}
+			nodes.Clear();
+		}
+		size_t NumberOfNodes(void) const
+		{
+			return nodes.Count();
+		}
+		// returns false if graph has cycle.
+		bool Validate(void) const
+		{
+			size_t numNodes = nodes.Count();
+			DKArray<size_t> inDegree((size_t)0, numNodes);
+			DKArray<Node> ready;
+			ready.Reserve(numNodes);
+			for (Node i = 0; i < numNodes; ++i)
+			{
+				inDegree.Value(i) = nodes.Value(i)->numDependencies;
+				if (inDegree.Value(i) == 0)
+					ready.Add(i);
+			}
+			size_t visited = 0;
+			while (visited < ready.Count())
+			{
+				const NodeData* node = nodes.Value(ready.Value(visited++));
+				for (Node s : node->successors)
+				{
+					if (--inDegree.Value(s) == 0)
+						ready.Add(s);
+				}
+			}
+			return visited == numNodes;
+		}
+		// post nodes to queue, returns immediately.
+		// returns false if graph is running or graph has cycle.
+		template <typename QUEUE> bool Submit(QUEUE& q)
+		{
+			if (!Validate())
+				return false;
+			if (nodes.Count() == 0)
+				return true;
+
+			completionCond.Lock();
+			bool running = !finished;
+			finished = false;
+			completionCond.Unlock();
+			if (running)
+				return false;
+
+			queue = &q;
+			postFunc = &PostOperation<QUEUE>;
+			for (NodeData* node : nodes)
+				node->pending.store(node->numDependencies, std::memory_order_relaxed);
+			remaining.store(nodes.Count());
+
+			for (NodeData* node : nodes)
+			{
+				if (node->numDependencies == 0)
+					postFunc(queue, node->runner);
+			}
+			return true;
+		}
+		// wait until all nodes are done.
+		void Wait(void) const
+		{
+			completionCond.Lock();
+			while (!finished)
+				completionCond.Wait();
+			completionCond.Unlock();
+		}
+		// submit and wait.
+		template <typename QUEUE> bool Run(QUEUE& q)
+		{
+			if (Submit(q))
+			{
+				Wait();
+				return true;
+			}
+			return false;
+		}
+		bool IsRunning(void) const
+		{
+			completionCond.Lock();
+			bool running = !finished;
+			completionCond.Unlock();
+			return running;
+		}
+
+	private:
+		class NodeOperation : public DKOperation
+		{
+		public:
+			NodeOperation(DKTaskGraph* g, Node n) : graph(g), node(n) {}
+			void Perform(void) const
+			{
+				graph->PerformNode(node);
+			}
+		private:
+			DKTaskGraph* graph;
+			Node node;
+		};
+		struct NodeData
+		{
+			DKObject<DKOperation> operation;
+			DKObject<DKOperation> runner;
+			DKArray<Node> successors;
+			size_t numDependencies;
+			std::atomic<size_t> pending;
+		};
+		template <typename QUEUE> static void PostOperation(void* q, DKOperation* op)
+		{
+			static_cast<QUEUE*>(q)->Post(op);
+		}
+		void PerformNode(Node index)
+		{
+			while (index != invalidNode)
+			{
+				NodeData* node = nodes.Value(index);
+				if (node->operation)
+					node->operation->Perform();
+
+				// perform first ready successor on this thread, post others.
+				Node next = invalidNode;
+				for (Node s : node->successors)
+				{
+					NodeData* succ = nodes.Value(s);
+					if (succ->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					{
+						if (next == invalidNode)
+							next = s;
+						else
+							postFunc(queue, succ->runner);
+					}
+				}
+				if (remaining.fetch_sub(1) == 1)
+				{
+					// graph can be destroyed after unlocked.
+					completionCond.Lock();
+					finished = true;
+					completionCond.Broadcast();
+					completionCond.Unlock();
+					return;
+				}
+				index = next;
+			}
+		}
+
+		DKArray<NodeData*> nodes;
+		std::atomic<size_t> remaining;
+		bool finished;		// protected by completionCond
+		void* queue;
+		void (*postFunc)(void*, DKOperation*);
+		DKCondition completionCond;
+
+		DKTaskGraph(const DKTaskGraph&);
+		DKTaskGraph& operator = (const DKTaskGraph&);
+	};
+}
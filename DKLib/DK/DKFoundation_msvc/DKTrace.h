@@ -0,0 +1,490 @@
+//
+//  File: DKTrace.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2014 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <stdarg.h>
+#include <string.h>
+#include <atomic>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKStringU8.h"
+#include "DKTimer.h"
+#include "DKThread.h"
+#include "DKThreadLocal.h"
+#include "DKSpinLock.h"
+#include "DKCriticalSection.h"
+#include "DKOperation.h"
+#include "DKStream.h"
+#include "DKFile.h"
+#include "DKMemory.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// DKTracer
+// low-overhead scoped-zone tracing, records events into per-thread buffers.
+// recorded events can be exported as Chrome trace-event JSON format.
+// (open with chrome://tracing or any compatible viewer)
+//
+// zones are recorded only while recording. (Start ~ Stop)
+// if not recording, zone costs one atomic load.
+// each thread records to own buffer without locking, events beyond
+// capacity of buffer are discarded. (DroppedEvents)
+// name of zone must be string literal or static string. (pointer is stored)
+//
+// Export() should be called after Stop(), and Start() should not be called
+// while exporting. events of terminated threads are exported also, until
+// next recording session begins.
+//
+// define DKLIB_TRACE_DISABLED to remove DKTRACE_ macros at compile time.
+//
+// Example:
+//  DKTracer::Start();
+//  {
+//      DKTRACE_ZONE("Frame");
+//      {
+//          DKTRACE_ZONE("Update");
+//          scene->Update(dt, tick);
+//      }
+//      DKTRACE_COUNTER("Objects", scene->NumberOfObjects());
+//  }
+//  DKTracer::Stop();
+//  DKTracer::ExportToFile(L"trace.json");
+//
+// Note:
+//  operations posted to DKOperationQueue or DKRunLoop can be traced with
+//  DKTraceOperation(name, op), which wraps operation with zone.
+////////////////////////////////////////////////////////////////////////////////
+
+namespace DKFoundation
+{
+	class DKTracer
+	{
+	public:
+		enum {DefaultEventsPerThread = 0x10000};
+
+		// begin new recording session, discards all events recorded before.
+		static void Start(size_t eventsPerThread = DefaultEventsPerThread)
+		{
+			Registry& reg = Registry::Instance();
+			DKCriticalSection<DKSpinLock> guard(reg.lock);
+			reg.recording.store(false, std::memory_order_relaxed);
+
+			// release buffers of terminated threads.
+			ThreadBuffer** link = &reg.buffers;
+			while (*link)
+			{
+				ThreadBuffer* buffer = *link;
+				if (buffer->orphaned.load(std::memory_order_acquire))
+				{
+					*link = buffer->next;
+					buffer->~ThreadBuffer();
+					DKMemoryHeapFree(buffer);
+				}
+				else
+					link = &buffer->next;
+			}
+			reg.capacity = eventsPerThread > 0 ? eventsPerThread : 1;
+			reg.baseTick = DKTimer::SystemTick();
+			reg.session.fetch_add(1, std::memory_order_release);
+			reg.recording.store(true, std::memory_order_release);
+		}
+		static void Stop(void)
+		{
+			Registry* reg = Registry::InstanceNoCreate();
+			if (reg)
+				reg->recording.store(false, std::memory_order_release);
+		}
+		static bool IsRecording(void)
+		{
+			Registry* reg = Registry::InstanceNoCreate();
+			return reg && reg->recording.load(std::memory_order_relaxed);
+		}
+
+		// name of calling thread, shown on trace viewer.
+		static void SetThreadName(const char* name)
+		{
+			ThreadBuffer* buffer = CurrentThreadBuffer();
+			if (buffer)
+			{
+				strncpy(buffer->name, name, sizeof(buffer->name) - 1);
+				buffer->name[sizeof(buffer->name) - 1] = 0;
+			}
+		}
+
+		// record events manually. (use DKTraceZone or DKTRACE_ macros)
+		static void RecordZone(const char* name, DKTimer::Tick begin, DKTimer::Tick end)
+		{
+			if (IsRecording())
+				Record(EventZone, name, begin, end - begin);
+		}
+		static void RecordInstant(const char* name)
+		{
+			if (IsRecording())
+				Record(EventInstant, name, DKTimer::SystemTick(), 0);
+		}
+		static void RecordCounter(const char* name, long long value)
+		{
+			if (IsRecording())
+				Record(EventCounter, name, DKTimer::SystemTick(), (unsigned long long)value);
+		}
+
+		// number of events discarded in current session. (buffer was full)
+		static size_t DroppedEvents(void)
+		{
+			Registry& reg = Registry::Instance();
+			DKCriticalSection<DKSpinLock> guard(reg.lock);
+			unsigned int session = reg.session.load(std::memory_order_acquire);
+			size_t dropped = 0;
+			for (ThreadBuffer* buffer = reg.buffers; buffer; buffer = buffer->next)
+			{
+				if (buffer->session == session)
+					dropped += buffer->dropped.load(std::memory_order_relaxed);
+			}
+			return dropped;
+		}
+
+		// write Chrome trace-event JSON to stream.
+		static bool Export(DKStream* stream)
+		{
+			if (stream == NULL || !stream->IsWritable())
+				return false;
+
+			Registry& reg = Registry::Instance();
+			DKCriticalSection<DKSpinLock> guard(reg.lock);
+			unsigned int session = reg.session.load(std::memory_order_acquire);
+			double tickToMicroseconds = 1000000.0 / (double)DKTimer::SystemTickFrequency();
+
+			JSONWriter writer(stream);
+			writer.Write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+			bool first = true;
+			for (ThreadBuffer* buffer = reg.buffers; buffer; buffer = buffer->next)
+			{
+				if (buffer->session != session || buffer->events == NULL)
+					continue;
+
+				unsigned long long tid = buffer->threadId;
+				if (buffer->name[0])
+				{
+					writer.Format("%s\n{\"ph\":\"M\",\"pid\":1,\"tid\":%llu,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",", tid);
+					writer.WriteString(buffer->name);
+					writer.Write("}}");
+					first = false;
+				}
+
+				size_t count = buffer->count.load(std::memory_order_acquire);
+				for (size_t i = 0; i < count; ++i)
+				{
+					const Event& e = buffer->events[i];
+					double ts = (double)(long long)(e.tick - reg.baseTick) * tickToMicroseconds;
+					switch (e.type)
+					{
+					case EventZone:
+						writer.Format("%s\n{\"ph\":\"X\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+							first ? "" : ",", tid, ts, (double)e.value * tickToMicroseconds);
+						break;
+					case EventInstant:
+						writer.Format("%s\n{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f,\"name\":",
+							first ? "" : ",", tid, ts);
+						break;
+					case EventCounter:
+						writer.Format("%s\n{\"ph\":\"C\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f,\"args\":{\"value\":%lld},\"name\":",
+							first ? "" : ",", tid, ts, (long long)e.value);
+						break;
+					}
+					writer.WriteString(e.name);
+					writer.Write("}");
+					first = false;
+				}
+			}
+			writer.Write("\n]}\n");
+			return writer.Flush();
+		}
+		static bool ExportToFile(const DKString& path)
+		{
+			DKObject<DKFile> file = DKFile::Create(path, DKFile::ModeOpenNew, DKFile::ModeShareExclusive);
+			if (file)
+				return Export(file);
+			return false;
+		}
+
+	private:
+		enum EventType
+		{
+			EventZone = 0,		// value: duration
+			EventInstant,
+			EventCounter,		// value: counter value
+		};
+		struct Event
+		{
+			const char* name;
+			DKTimer::Tick tick;
+			unsigned long long value;
+			EventType type;
+		};
+		// events are written by owner thread only, read by exporter.
+		// buffer is owned by registry, released after owner thread terminated.
+		struct ThreadBuffer
+		{
+			ThreadBuffer(void)
+				: events(NULL), capacity(0), count(0), dropped(0), session(0), orphaned(false), next(NULL)
+			{
+				threadId = (unsigned long long)DKThread::CurrentThreadId();
+				name[0] = 0;
+			}
+			~ThreadBuffer(void)
+			{
+				if (events)
+					DKMemoryHeapFree(events);
+			}
+			Event* events;
+			size_t capacity;
+			std::atomic<size_t> count;
+			std::atomic<size_t> dropped;
+			unsigned int session;		// session of recorded events
+			std::atomic<bool> orphaned;	// owner thread terminated
+			unsigned long long threadId;
+			char name[64];
+			ThreadBuffer* next;
+		};
+		struct ThreadContext
+		{
+			ThreadContext(void) : buffer(NULL) {}
+			~ThreadContext(void)
+			{
+				if (buffer)
+					buffer->orphaned.store(true, std::memory_order_release);
+			}
+			ThreadBuffer* buffer;
+		};
+		struct Registry
+		{
+			std::atomic<bool> recording;
+			std::atomic<unsigned int> session;
+			DKTimer::Tick baseTick;
+			size_t capacity;
+			ThreadBuffer* buffers;
+			DKSpinLock lock;
+			DKThreadLocal<ThreadContext> context;
+
+			Registry(void) : recording(false), session(0), baseTick(0), capacity(DefaultEventsPerThread), buffers(NULL) {}
+			// registry is created on first use and never destroyed,
+			// zones can be recorded while global objects being destroyed.
+			static Registry& Instance(void)
+			{
+				Registry* reg = Holder<0>::registry.load(std::memory_order_acquire);
+				if (reg == NULL)
+				{
+					void* mem = DKMemoryHeapAlloc(sizeof(Registry));
+					if (mem == NULL)
+						DKERROR_THROW("Out of memory");
+					Registry* newReg = new(mem) Registry();
+					if (Holder<0>::registry.compare_exchange_strong(reg, newReg, std::memory_order_acq_rel))
+						reg = newReg;
+					else
+					{
+						newReg->~Registry();
+						DKMemoryHeapFree(newReg);
+					}
+				}
+				return *reg;
+			}
+			static Registry* InstanceNoCreate(void)
+			{
+				return Holder<0>::registry.load(std::memory_order_acquire);
+			}
+		};
+		template <int N> struct Holder
+		{
+			static std::atomic<Registry*> registry;
+		};
+		// buffered JSON output.
+		class JSONWriter
+		{
+		public:
+			JSONWriter(DKStream* s) : stream(s), length(0), failed(false) {}
+			void Write(const char* str)
+			{
+				Write(str, strlen(str));
+			}
+			void Write(const char* str, size_t len)
+			{
+				while (len > 0)
+				{
+					if (length == sizeof(buffer))
+						Flush();
+					size_t n = Min(len, sizeof(buffer) - length);
+					memcpy(&buffer[length], str, n);
+					length += n;
+					str += n;
+					len -= n;
+				}
+			}
+			void Format(const char* fmt, ...)
+			{
+				va_list ap;
+				va_start(ap, fmt);
+				DKStringU8 str = DKStringU8::FormatV(fmt, ap);
+				va_end(ap);
+				Write((const char*)str, str.Bytes());
+			}
+			void WriteString(const char* str)
+			{
+				Write("\"", 1);
+				if (str)
+				{
+					for (const char* p = str; *p; ++p)
+					{
+						unsigned char c = (unsigned char)*p;
+						if (c == '"' || c == '\\')
+						{
+							char esc[2] = {'\\', (char)c};
+							Write(esc, 2);
+						}
+						else if (c < 0x20)
+						{
+							static const char hex[] = "0123456789abcdef";
+							char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+							Write(esc, 6);
+						}
+						else
+							Write(p, 1);
+					}
+				}
+				Write("\"", 1);
+			}
+			bool Flush(void)
+			{
+				if (length > 0 && !failed)
+					failed = stream->Write(buffer, length) != length;
+				length = 0;
+				return !failed;
+			}
+		private:
+			DKStream* stream;
+			char buffer[0x4000];
+			size_t length;
+			bool failed;
+		};
+
+		static ThreadBuffer* CurrentThreadBuffer(void)
+		{
+			Registry& reg = Registry::Instance();
+			ThreadContext* ctxt = reg.context.Value();
+			if (ctxt == NULL)
+				return NULL;
+			if (ctxt->buffer == NULL)
+			{
+				void* mem = DKMemoryHeapAlloc(sizeof(ThreadBuffer));
+				if (mem == NULL)
+					return NULL;
+				ThreadBuffer* buffer = new(mem) ThreadBuffer();
+				DKCriticalSection<DKSpinLock> guard(reg.lock);
+				buffer->next = reg.buffers;
+				reg.buffers = buffer;
+				ctxt->buffer = buffer;
+			}
+			return ctxt->buffer;
+		}
+		static void Record(EventType type, const char* name, DKTimer::Tick tick, unsigned long long value)
+		{
+			Registry& reg = Registry::Instance();
+			ThreadBuffer* buffer = CurrentThreadBuffer();
+			if (buffer == NULL)
+				return;
+			unsigned int session = reg.session.load(std::memory_order_acquire);
+			if (buffer->session != session)
+			{
+				// new session started, reset buffer.
+				DKCriticalSection<DKSpinLock> guard(reg.lock);
+				if (buffer->capacity != reg.capacity)
+				{
+					if (buffer->events)
+						DKMemoryHeapFree(buffer->events);
+					buffer->events = reinterpret_cast<Event*>(DKMemoryHeapAlloc(sizeof(Event) * reg.capacity));
+					buffer->capacity = buffer->events ? reg.capacity : 0;
+				}
+				buffer->count.store(0, std::memory_order_relaxed);
+				buffer->dropped.store(0, std::memory_order_relaxed);
+				buffer->session = session;
+			}
+			size_t index = buffer->count.load(std::memory_order_relaxed);
+			if (index < buffer->capacity)
+			{
+				Event& e = buffer->events[index];
+				e.name = name;
+				e.tick = tick;
+				e.value = value;
+				e.type = type;
+				buffer->count.store(index + 1, std::memory_order_release);
+			}
+			else
+				buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+	};
+	template <int N> std::atomic<DKTracer::Registry*> DKTracer::Holder<N>::registry(NULL);
+
+	// scoped zone, records duration of scope.
+	class DKTraceZone
+	{
+	public:
+		DKTraceZone(const char* n) : name(n), begin(0)
+		{
+			if (DKTracer::IsRecording())
+				begin = DKTimer::SystemTick();
+		}
+		~DKTraceZone(void)
+		{
+			if (begin)
+				DKTracer::RecordZone(name, begin, DKTimer::SystemTick());
+		}
+	private:
+		const char* name;
+		DKTimer::Tick begin;
+
+		DKTraceZone(const DKTraceZone&);
+		DKTraceZone& operator = (const DKTraceZone&);
+	};
+
+	namespace Private
+	{
+		class TracedOperation : public DKOperation
+		{
+		public:
+			TracedOperation(const char* n, DKOperation* op) : name(n), operation(op) {}
+			void Perform(void) const
+			{
+				DKTraceZone zone(name);
+				operation->Perform();
+			}
+		private:
+			const char* name;
+			DKObject<DKOperation> operation;
+		};
+	}
+	// wrap operation with zone.
+	inline DKObject<DKOperation> DKTraceOperation(const char* name, DKOperation* op)
+	{
+		if (op)
+			return DKOBJECT_NEW Private::TracedOperation(name, op);
+		return NULL;
+	}
+}
+
+#ifdef DKLIB_TRACE_DISABLED
+#define DKTRACE_ZONE(name)				(void)0
+#define DKTRACE_FUNCTION()				(void)0
+#define DKTRACE_INSTANT(name)			(void)0
+#define DKTRACE_COUNTER(name, value)	(void)0
+#else
+#define DKTRACE_CONCAT_(a, b)			a##b
+#define DKTRACE_CONCAT(a, b)			DKTRACE_CONCAT_(a, b)
+#define DKTRACE_ZONE(name)				DKFoundation::DKTraceZone DKTRACE_CONCAT(_dkTraceZone, __LINE__)(name)
+#define DKTRACE_FUNCTION()				DKTRACE_ZONE(__FUNCTION__)
+#define DKTRACE_INSTANT(name)			DKFoundation::DKTracer::RecordInstant(name)
+#define DKTRACE_COUNTER(name, value)	DKFoundation::DKTracer::RecordCounter(name, (long long)(value))
+#endif
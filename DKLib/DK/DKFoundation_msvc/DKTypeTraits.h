@@ -281,4 +281,15 @@ namespace DKFoundation
 		enum {IsMemberPointer			= MemberPointerTraits<UnqualifiedReferredType>::Result || IsMemberFunctionPointer};
 		enum {IsPointer					= PointerTraits<UnqualifiedReferredType>::Result || IsFunctionPointer};
 	};
+
+	// DKTriviallyRelocatable
+	// object can be moved to other address by memcpy or memmove, without
+	// calling move-constructor and destructor.
+	// containers (DKArray, DKQueue, DKStaticArray) relocate items with memmove
+	// if Result is true, otherwise items are moved by move-constructor.
+	// specialize this template for types which does not refer own address.
+	template <typename T> struct DKTriviallyRelocatable
+	{
+		enum {Result = DKTypeTraitsCppExt<T>::HasTrivialCopy && DKTypeTraitsCppExt<T>::HasTrivialDestructor};
+	};
 }
@@ -87,6 +87,8 @@ namespace DKFramework
 		//     uncompressed binary format. (faster loading)
 		// - SerializeFormCompressedBinary:
 		//     compressed binary format. (smallest, faster than xml)
+		//     to choose codec (LZ4, Zstd, etc), use Serialize(DKCompressor)
+		//     and DeserializeCompressed(). (see DKCompressor.h)
 		enum SerializeForm : int
 		{
 			SerializeFormXML				= '_XML',
@@ -173,6 +175,45 @@ namespace DKFramework
 		static bool RestoreObject(DKFoundation::DKStream* s, DKResourceLoader* p, Selector* sel);
 		static bool RestoreObject(const DKFoundation::DKData* d, DKResourceLoader* p, Selector* sel);
 
+		// compressed binary with codec of compressor.
+		// (SerializeFormBinary data in DKCompressor frame)
+		DKFoundation::DKObject<DKFoundation::DKData> Serialize(const DKFoundation::DKCompressor& compressor) const
+		{
+			DKFoundation::DKObject<DKFoundation::DKData> data = Serialize(SerializeFormBinary);
+			if (data)
+				return compressor.Compress(data).SafeCast<DKFoundation::DKData>();
+			return NULL;
+		}
+		size_t Serialize(const DKFoundation::DKCompressor& compressor, DKFoundation::DKStream* output) const
+		{
+			DKFoundation::DKObject<DKFoundation::DKData> data = output ? Serialize(compressor) : NULL;
+			size_t written = 0;
+			if (data)
+			{
+				const void* p = data->LockShared();
+				if (p)
+					written = output->Write(p, data->Length());
+				data->UnlockShared();
+			}
+			return written;
+		}
+		// data compressed by DKCompressor is decompressed before deserialize,
+		// other forms are deserialized as is.
+		bool DeserializeCompressed(const DKFoundation::DKData* d, DKResourceLoader* p, const DKFoundation::DKCompressor::Dictionary* dict = NULL) const
+		{
+			DKFoundation::DKObject<DKFoundation::DKData> data = Uncompressed(d, dict);
+			if (data)
+				return Deserialize(data.Ptr(), p);
+			return false;
+		}
+		static bool RestoreCompressedObject(const DKFoundation::DKData* d, DKResourceLoader* p, Selector* sel, const DKFoundation::DKCompressor::Dictionary* dict = NULL)
+		{
+			DKFoundation::DKObject<DKFoundation::DKData> data = Uncompressed(d, dict);
+			if (data)
+				return RestoreObject(data.Ptr(), p, sel);
+			return false;
+		}
+
 	private:
 		struct VariantEntity;
 		struct SerializerEntity;
@@ -247,6 +288,17 @@ namespace DKFramework
 		bool DeserializeXMLOperations(const DKFoundation::DKXMLElement* e, DKFoundation::DKArray<DKFoundation::DKObject<DeserializerEntity>>& entities, DKResourceLoader* pool) const;
 		bool DeserializeBinaryOperations(DKFoundation::DKStream* s, DKFoundation::DKArray<DKFoundation::DKObject<DeserializerEntity>>& entities, DKResourceLoader* pool) const;
 		size_t SerializeBinary(SerializeForm sf, DKFoundation::DKStream* output) const;
+		static DKFoundation::DKObject<DKFoundation::DKData> Uncompressed(const DKFoundation::DKData* d, const DKFoundation::DKCompressor::Dictionary* dict)
+		{
+			if (d == NULL)
+				return NULL;
+			const void* p = d->LockShared();
+			bool framed = DKFoundation::DKCompressor::IsCompressed(p, d->Length());
+			d->UnlockShared();
+			if (framed)
+				return DKFoundation::DKCompressor::Decompress(d, dict).SafeCast<DKFoundation::DKData>();
+			return const_cast<DKFoundation::DKData*>(d);
+		}
 		bool DeserializeBinary(DKFoundation::DKStream* s, DKResourceLoader* p) const;
 		static bool DeserializeBinary(DKFoundation::DKStream* s, DKResourceLoader* p, Selector* sel);
 		